@@ -7,6 +7,9 @@ using namespace ankerl;
 #include <PipeMemoryArenas.h>
 #include <PipeTime.h>
 
+#include <format>
+#include <thread>
+
 
 void RunArenasBenchmarks()
 {
@@ -42,6 +45,15 @@ void RunArenasBenchmarks()
 			});
 		}
 
+		{
+			p::VirtualLinearArena arenat;
+			p::Arena& arena{arenat};
+			consecutiveAlloc.run("VirtualLinearArena", [&arena]
+			{
+				ankerl::nanobench::doNotOptimizeAway(arena.Alloc(16));
+			});
+		}
+
 		{
 			p::MultiLinearArena arenat{};
 			p::Arena& arena{arenat};
@@ -51,6 +63,24 @@ void RunArenasBenchmarks()
 			});
 		}
 
+		{
+			p::TPoolArena<16> arenat;
+			p::Arena& arena{arenat};
+			consecutiveAlloc.run("PoolArena", [&arena]
+			{
+				ankerl::nanobench::doNotOptimizeAway(arena.Alloc(16));
+			});
+		}
+
+		{
+			p::MultiPoolArena arenat;
+			p::Arena& arena{arenat};
+			consecutiveAlloc.run("MultiPoolArena", [&arena]
+			{
+				ankerl::nanobench::doNotOptimizeAway(arena.Alloc(16));
+			});
+		}
+
 		{
 			p::BestFitArena arenat{100 * p::Memory::MB};
 			p::Arena& arena{arenat};
@@ -68,6 +98,15 @@ void RunArenasBenchmarks()
 				arena.Alloc(16);
 			});
 		}
+
+		{
+			p::TLSFArena arenat;
+			p::Arena& arena{arenat};
+			consecutiveAlloc.run("TLSFArena", [&arena]
+			{
+				ankerl::nanobench::doNotOptimizeAway(arena.Alloc(16));
+			});
+		}
 	}
 
 	{
@@ -163,6 +202,50 @@ void RunArenasBenchmarks()
 			}
 		}
 
+		{
+			p::TPoolArena<16> arenat;
+			p::Arena& arena{arenat};
+			p::TArray<void*> allocated;
+			allocated.Reserve(50000);
+			for (p::u32 i = 0; i < 50000; ++i)
+			{
+				allocated.Add(arena.Alloc(16));
+			}
+
+			p::i32 i = 0;
+			consecutiveFree.run("PoolArena", [&arena, &i, &allocated]
+			{
+				arena.Free(allocated[i], 16);
+				++i;
+			});
+			for (; i < allocated.Size(); ++i)
+			{
+				arena.Free(allocated[i], 16);
+			}
+		}
+
+		{
+			p::MultiPoolArena arenat;
+			p::Arena& arena{arenat};
+			p::TArray<void*> allocated;
+			allocated.Reserve(50000);
+			for (p::u32 i = 0; i < 50000; ++i)
+			{
+				allocated.Add(arena.Alloc(16));
+			}
+
+			p::i32 i = 0;
+			consecutiveFree.run("MultiPoolArena", [&arena, &i, &allocated]
+			{
+				arena.Free(allocated[i], 16);
+				++i;
+			});
+			for (; i < allocated.Size(); ++i)
+			{
+				arena.Free(allocated[i], 16);
+			}
+		}
+
 		{
 			p::BestFitArena arenat{100 * p::Memory::MB};
 			p::Arena& arena{arenat};
@@ -206,6 +289,28 @@ void RunArenasBenchmarks()
 				arena.Free(allocated[i], 16);
 			}
 		}
+
+		{
+			p::TLSFArena arenat;
+			p::Arena& arena{arenat};
+			p::TArray<void*> allocated;
+			allocated.Reserve(50000);
+			for (p::u32 i = 0; i < 50000; ++i)
+			{
+				allocated.Add(arena.Alloc(16));
+			}
+
+			p::i32 i = 0;
+			consecutiveFree.run("TLSFArena", [&arena, &i, &allocated]
+			{
+				arena.Free(allocated[i], 16);
+				++i;
+			});
+			for (; i < allocated.Size(); ++i)
+			{
+				arena.Free(allocated[i], 16);
+			}
+		}
 	}
 
 	{
@@ -264,6 +369,23 @@ void RunArenasBenchmarks()
 			});
 		}
 
+		{
+			p::VirtualLinearArena arenat;
+			p::Arena& arena{arenat};
+			allocSequence.run("VirtualLinearArena", [&arena]
+			{
+				void* p  = arena.Alloc(16);
+				void* p2 = arena.Alloc(21);
+				arena.Free(p, 16);
+				void* p3 = arena.Alloc(8);
+				arena.Free(p3, 8);
+				ankerl::nanobench::doNotOptimizeAway(p);
+				ankerl::nanobench::doNotOptimizeAway(p2);
+				ankerl::nanobench::doNotOptimizeAway(p3);
+				arena.Free(p2, 21);
+			});
+		}
+
 		{
 			p::MultiLinearArena arenat;
 			p::Arena& arena{arenat};
@@ -314,6 +436,23 @@ void RunArenasBenchmarks()
 				arena.Free(p2, 21);
 			});
 		}
+
+		{
+			p::TLSFArena arenat;
+			p::Arena& arena{arenat};
+			allocSequence.run("TLSFArena", [&arena]
+			{
+				void* p  = arena.Alloc(16);
+				void* p2 = arena.Alloc(21);
+				arena.Free(p, 16);
+				void* p3 = arena.Alloc(8);
+				arena.Free(p3, 8);
+				ankerl::nanobench::doNotOptimizeAway(p);
+				ankerl::nanobench::doNotOptimizeAway(p2);
+				ankerl::nanobench::doNotOptimizeAway(p3);
+				arena.Free(p2, 21);
+			});
+		}
 	}
 
 	{
@@ -524,6 +663,171 @@ void RunArenasBenchmarks()
 				arena.Free(p, 16);
 			}
 		}
+
+		{
+			p::TLSFArena arenat;
+			p::Arena& arena{arenat};
+			p::TArray<void*> allocated;
+			allocated.Reserve(50000);
+			for (p::u32 i = 0; i < 25000; ++i)
+			{
+				allocated.Add(arena.Alloc(16));
+			}
+
+			ankerl::nanobench::Rng rng(122);
+			randomSequence.run("TLSFArena", [&arena, &rng, &allocated]
+			{
+				if (rng() & 1U)
+				{
+					void* ptr = arena.Alloc(16);
+					ankerl::nanobench::doNotOptimizeAway(ptr);
+					allocated.Add(ptr);
+				}
+				else
+				{
+					p::u32 index   = rng.bounded(allocated.Size());
+					void* toRemove = allocated[index];
+					arena.Free(toRemove, 16);
+					allocated.RemoveAtSwapUnsafe(index);
+				}
+			});
+
+			for (void* p : allocated)
+			{
+				arena.Free(p, 16);
+			}
+		}
+	}
+
+	{
+		ankerl::nanobench::Bench threaded;
+		constexpr p::i32 count = 100000;    // Allocations of each thread
+		threaded.title("Multithreaded alloc/free (100k per thread, 16-512 bytes)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		auto runThreads = [](p::i32 numThreads, auto&& work)
+		{
+			p::TArray<std::thread> threads;
+			for (p::i32 t = 0; t < numThreads; ++t)
+			{
+				threads.Add(std::thread{[&work, t] { work(t); }});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		};
+		// Keeps 64 allocations alive, replacing one each time
+		auto churn = [](auto&& alloc, auto&& free)
+		{
+			void* live[64]{};
+			p::sizet sizes[64]{};
+			for (p::i32 i = 0; i < count; ++i)
+			{
+				const p::i32 slot = i & 63;
+				if (live[slot])
+				{
+					free(live[slot], sizes[slot]);
+				}
+				sizes[slot] = 16 + (p::sizet(i) * 7 % 32) * 16;
+				live[slot]  = alloc(sizes[slot]);
+			}
+			for (p::i32 slot = 0; slot < 64; ++slot)
+			{
+				free(live[slot], sizes[slot]);
+			}
+		};
+
+		p::HeapArena heap;
+		auto heapAlloc = [&heap](p::sizet size)
+		{
+			return heap.Alloc(size);
+		};
+		auto heapFree = [&heap](void* ptr, p::sizet size)
+		{
+			heap.Free(ptr, size);
+		};
+		auto mallocAlloc = [](p::sizet size)
+		{
+			return p::HeapAlloc(size);
+		};
+		auto mallocFree = [](void* ptr, p::sizet)
+		{
+			p::HeapFree(ptr);
+		};
+		// What HeapArena did before caching blocks: malloc with tracked stats
+		p::MemoryStats stats;
+		stats.detectLeaks = false;
+		auto statsAlloc   = [&stats](p::sizet size)
+		{
+			void* ptr = p::HeapAlloc(size);
+			stats.Add(ptr, size);
+			return ptr;
+		};
+		auto statsFree = [&stats](void* ptr, p::sizet size)
+		{
+			stats.Remove(ptr, size);
+			p::HeapFree(ptr);
+		};
+
+		const p::i32 maxThreads = p::Max(p::i32(std::thread::hardware_concurrency()), 1);
+		for (p::i32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			const std::string threadsName = std::format(" - {} threads", numThreads);
+			threaded.run("Churn (malloc)" + threadsName, [&]
+			{
+				runThreads(numThreads, [&](p::i32)
+				{
+					churn(mallocAlloc, mallocFree);
+				});
+			});
+			threaded.run("Churn (malloc + MemoryStats)" + threadsName, [&]
+			{
+				runThreads(numThreads, [&](p::i32)
+				{
+					churn(statsAlloc, statsFree);
+				});
+			});
+			threaded.run("Churn (HeapArena)" + threadsName, [&]
+			{
+				runThreads(numThreads, [&](p::i32)
+				{
+					churn(heapAlloc, heapFree);
+				});
+			});
+
+			// Each thread allocates, then frees the allocations of another thread
+			p::TArray<p::TArray<void*>> allocated;
+			allocated.Resize(numThreads);
+			auto crossThread = [&](auto&& alloc, auto&& free)
+			{
+				runThreads(numThreads, [&](p::i32 t)
+				{
+					allocated[t].Clear(p::Shrink::No);
+					for (p::i32 i = 0; i < count; ++i)
+					{
+						allocated[t].Add(alloc(64));
+					}
+				});
+				runThreads(numThreads, [&](p::i32 t)
+				{
+					for (void* ptr : allocated[(t + 1) % numThreads])
+					{
+						free(ptr, 64);
+					}
+				});
+			};
+			threaded.run("Cross-thread free (malloc)" + threadsName, [&]
+			{
+				crossThread(mallocAlloc, mallocFree);
+			});
+			threaded.run("Cross-thread free (HeapArena)" + threadsName, [&]
+			{
+				crossThread(heapAlloc, heapFree);
+			});
+		}
 	}
 
 	/*{
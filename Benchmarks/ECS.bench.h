@@ -0,0 +1,763 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+#pragma once
+
+#include "nanobench.h"
+
+#include <PipeECS.h>
+
+#include <random>
+#include <thread>
+
+
+using namespace ankerl;
+using namespace p;
+
+
+struct BenchPosition
+{
+	float x = 0.f, y = 0.f;
+};
+struct BenchVelocity
+{
+	float x = 0.f, y = 0.f;
+};
+struct BenchHealth
+{
+	i32 value = 100;
+};
+struct BenchTagA
+{};
+struct BenchTagB
+{};
+struct BenchModified
+{
+	P_STRUCT(BenchModified, TF_ECS_ModifyOnGet)
+
+	i32 value = 0;
+};
+struct BenchTracked
+{
+	P_STRUCT(BenchTracked, TF_ECS_TrackChanges)
+
+	i32 value = 0;
+};
+struct BenchBounds : public Box
+{
+	P_STRUCT(BenchBounds, TF_ECS_ModifyOnEdit)
+};
+template<i32 N>
+struct BenchSpawned
+{
+	float values[4]{};
+};
+struct BenchSaved
+{
+	P_STRUCT(BenchSaved, TF_TrivialSerialize)
+
+	P_PROP(x)
+	float x = 0.f;
+	P_PROP(y)
+	float y = 0.f;
+	P_PROP(z)
+	float z = 0.f;
+};
+struct BenchSavedReflected
+{
+	P_STRUCT(BenchSavedReflected)
+
+	P_PROP(x)
+	float x = 0.f;
+	P_PROP(y)
+	float y = 0.f;
+	P_PROP(z)
+	float z = 0.f;
+};
+
+
+void RunECSBenchmarks()
+{
+	{
+		ankerl::nanobench::Bench queries;
+		constexpr i32 count   = 500000;
+		constexpr i32 changes = 100;    // Components toggled per iteration
+		queries.title("ECS - Queries (500k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(10)
+		    .maxEpochTime(p::Seconds{1});
+
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(count);
+		AddId(ctx, ids);
+		ctx.AddN<BenchPosition>(ids);
+		ctx.AddN<BenchVelocity>(ids);
+		for (i32 i = 0; i < count; i += 2)
+		{
+			ctx.Add<BenchHealth>(ids[i]);
+		}
+
+		// Toggle health on a few ids every iteration to simulate changes between frames
+		i32 next    = 0;
+		auto change = [&ctx, &ids, &next]
+		{
+			for (i32 i = 0; i < changes; ++i)
+			{
+				const Id id = ids[next];
+				if (ctx.Has<BenchHealth>(id))
+				{
+					ctx.Remove<BenchHealth>(id);
+				}
+				else
+				{
+					ctx.Add<BenchHealth>(id);
+				}
+				next = (next + 1) % count;
+			}
+		};
+
+		{
+			TArray<Id> results;
+			queries.run("FindAllIdsWith (rebuild)", [&]
+			{
+				change();
+				FindAllIdsWith<BenchPosition, BenchVelocity, BenchHealth>(ctx, results);
+				ankerl::nanobench::doNotOptimizeAway(results.Size());
+			});
+		}
+
+		{
+			IdQuery& query = ctx.AssureQuery<BenchPosition, BenchVelocity, BenchHealth>();
+			queries.run("IdQuery (incremental)", [&]
+			{
+				change();
+				ankerl::nanobench::doNotOptimizeAway(query.Size());
+			});
+		}
+	}
+
+	{
+		ankerl::nanobench::Bench iteration;
+		constexpr i32 count = 500000;
+		iteration.title("ECS - Iteration (500k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(10)
+		    .maxEpochTime(p::Seconds{1});
+
+		// Every other id has all components, so pools are not aligned by default
+		auto fill = [](IdContext& ctx)
+		{
+			TArray<Id> ids;
+			ids.Resize(count);
+			AddId(ctx, ids);
+			ctx.AddN<BenchPosition>(ids);
+			for (i32 i = 0; i < count; i += 2)
+			{
+				ctx.Add<BenchVelocity>(ids[i]);
+			}
+			for (i32 i = count - 1; i >= 0; --i)
+			{
+				ctx.Add<BenchHealth>(ids[i]);
+			}
+		};
+
+		{
+			IdContext ctx;
+			fill(ctx);
+			IdQuery& query = ctx.AssureQuery<BenchPosition, BenchVelocity, BenchHealth>();
+			iteration.run("IdQuery + Get", [&]
+			{
+				TIdScope<Writes<BenchPosition>, BenchVelocity, BenchHealth> scope{ctx};
+				for (Id id : query)
+				{
+					auto& position       = scope.Get<BenchPosition>(id);
+					const auto& velocity = scope.Get<const BenchVelocity>(id);
+					position.x += velocity.x * float(scope.Get<const BenchHealth>(id).value);
+				}
+			});
+		}
+
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<BenchPosition, BenchVelocity, BenchHealth>();
+			fill(ctx);
+			iteration.run("IdGroup", [&]
+			{
+				group.Each<BenchPosition, const BenchVelocity, const BenchHealth>(
+				    [](Id id, BenchPosition& position, const BenchVelocity& velocity,
+				        const BenchHealth& health)
+				{
+					position.x += velocity.x * float(health.value);
+				});
+			});
+		}
+
+		{
+			IdContext ctx;
+			fill(ctx);
+			// Health was added in reverse, so reading it by id jumps around until sorted
+			auto join = [&ctx]
+			{
+				TIdScope<Writes<BenchPosition>, BenchHealth> scope{ctx};
+				const TPool<BenchPosition>& positions = *scope.GetPool<const BenchPosition>();
+				for (Id id : positions.GetIdList())
+				{
+					auto& position = scope.Get<BenchPosition>(id);
+					position.x += float(scope.Get<const BenchHealth>(id).value);
+				}
+			};
+			iteration.run("Pool + Get (unsorted)", join);
+			ctx.SortPoolAs<BenchHealth, BenchPosition>();
+			iteration.run("Pool + Get (SortPoolAs)", join);
+		}
+	}
+
+	{
+		ankerl::nanobench::Bench tags;
+		constexpr i32 count = 1000000;
+		tags.title("ECS - Tag filtering (1M entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(10)
+		    .maxEpochTime(p::Seconds{1});
+
+		// Same distribution for tags and components with data
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(count);
+		AddId(ctx, ids);
+		for (i32 i = 0; i < count; ++i)
+		{
+			if (i % 2 == 0)
+			{
+				ctx.Add<BenchTagA>(ids[i]);
+				ctx.Add<BenchPosition>(ids[i]);
+			}
+			if (i % 3 == 0)
+			{
+				ctx.Add<BenchTagB>(ids[i]);
+				ctx.Add<BenchVelocity>(ids[i]);
+			}
+		}
+
+		TArray<Id> results;
+		tags.run("FindAllIdsWith (components)", [&]
+		{
+			FindAllIdsWith<BenchPosition, BenchVelocity>(ctx, results);
+			ankerl::nanobench::doNotOptimizeAway(results.Size());
+		});
+		tags.run("FindAllIdsWith (tags)", [&]
+		{
+			FindAllIdsWith<BenchTagA, BenchTagB>(ctx, results);
+			ankerl::nanobench::doNotOptimizeAway(results.Size());
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench hierarchy;
+		hierarchy.title("ECS - Hierarchy (100k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(10)
+		    .maxEpochTime(p::Seconds{1});
+
+		// 10 roots with 10 children each, repeated 5 levels deep
+		auto fill = [](IdContext& ctx, TArray<Id>& roots)
+		{
+			roots.Resize(10);
+			AddId(ctx, roots);
+			TArray<Id> parents{roots};
+			TArray<Id> children;
+			for (i32 level = 0; level < 4; ++level)
+			{
+				TArray<Id> nextParents;
+				for (Id parent : parents)
+				{
+					children.Resize(10);
+					AddId(ctx, children);
+					AttachId(ctx, parent, children);
+					nextParents.Append(children);
+				}
+				parents = Move(nextParents);
+			}
+		};
+
+		TArray<Id> results;
+		{
+			IdContext ctx;
+			TArray<Id> roots;
+			fill(ctx, roots);
+			hierarchy.run("GetAllIdChildren", [&]
+			{
+				results.Clear(Shrink::No);
+				GetAllIdChildren(ctx, roots, results, Limits<u32>::Max());
+				ankerl::nanobench::doNotOptimizeAway(results.Size());
+			});
+		}
+		{
+			IdContext ctx;
+			ctx.SetStatic<IdHierarchyIndex>();
+			TArray<Id> roots;
+			fill(ctx, roots);
+			GetIdHierarchyIndex(ctx);
+			hierarchy.run("GetAllIdChildren (IdHierarchyIndex)", [&]
+			{
+				results.Clear(Shrink::No);
+				GetAllIdChildren(ctx, roots, results, Limits<u32>::Max());
+				ankerl::nanobench::doNotOptimizeAway(results.Size());
+			});
+		}
+		{
+			IdContext ctx;
+			ctx.SetStatic<IdHierarchyIndex>();
+			TArray<Id> roots;
+			fill(ctx, roots);
+			const IdHierarchyIndex& index = *GetIdHierarchyIndex(ctx);
+			for (Id id : index.GetIds())
+			{
+				ctx.Add<BenchPosition>(id, {1.f, 1.f});
+			}
+
+			auto propagate = [](const BenchPosition& parent, BenchPosition& child)
+			{
+				child.x = parent.x + 1.f;
+				child.y = parent.y * 0.5f;
+			};
+			hierarchy.run("Propagate (serial)", [&]
+			{
+				const TView<const Id> ids      = index.GetIds();
+				const TView<const i32> parents = index.GetParentPositions();
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					if (parents[i] != NO_INDEX)
+					{
+						propagate(ctx.Get<const BenchPosition>(ids[parents[i]]),
+						    ctx.Get<BenchPosition>(ids[i]));
+					}
+				}
+			});
+			hierarchy.run("PropagateIdHierarchy", [&]
+			{
+				PropagateIdHierarchy<BenchPosition>(ctx, propagate);
+			});
+		}
+	}
+
+	{
+		ankerl::nanobench::Bench changes;
+		constexpr i32 count = 10000;    // CMdfd adds one id at a time, so it grows quadratically
+		changes.title("ECS - Change tracking (10k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(10)
+		    .maxEpochTime(p::Seconds{1});
+
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(count);
+		AddId(ctx, ids);
+		ctx.AddN<BenchModified>(ids);
+		ctx.AddN<BenchTracked>(ids);
+
+		// Writes all components, then finds and clears the changed ones
+		TArray<Id> changed;
+		changes.run("CMdfd", [&]
+		{
+			for (Id id : ids)
+			{
+				++ctx.Get<BenchModified>(id).value;
+			}
+			changed.Clear(Shrink::No);
+			FindAllIdsWith<CMdfd<BenchModified>>(ctx, changed);
+			ctx.ClearPool<CMdfd<BenchModified>>();
+			ankerl::nanobench::doNotOptimizeAway(changed.Size());
+		});
+		changes.run("Change ticks", [&]
+		{
+			const u32 tick = ctx.AdvanceChangeTick();
+			for (Id id : ids)
+			{
+				++ctx.Get<BenchTracked>(id).value;
+			}
+			changed.Clear(Shrink::No);
+			FindAllIdsChanged<BenchTracked>(ctx, tick - 1, changed);
+			ankerl::nanobench::doNotOptimizeAway(changed.Size());
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench snapshots;
+		constexpr i32 count = 500000;
+		snapshots.title("ECS - Snapshots (500k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(count);
+		AddId(ctx, ids);
+		ctx.AddN<BenchPosition>(ids);
+		ctx.AddN<BenchVelocity>(ids);
+		ctx.AddN<BenchHealth>(ids);
+
+		// Each frame writes positions of 1000 ids spread over the pool
+		auto writeFrame = [&ctx, &ids]()
+		{
+			for (i32 i = 0; i < ids.Size(); i += ids.Size() / 1000)
+			{
+				ctx.Get<BenchPosition>(ids[i]).x += 1.f;
+			}
+		};
+		snapshots.run("Copy", [&]
+		{
+			writeFrame();
+			IdContext copy{ctx};
+			ankerl::nanobench::doNotOptimizeAway(copy.Size());
+		});
+
+		IdContext snapshot;
+		snapshot.UpdateSnapshot(ctx);
+		snapshots.run("UpdateSnapshot", [&]
+		{
+			writeFrame();
+			snapshot.UpdateSnapshot(ctx);
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench spawning;
+		constexpr i32 count = 100000;
+		spawning.title("ECS - Spawning (100k entities, 10 components)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		spawning.run("Add", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(count);
+			AddId(ctx, ids);
+			[&ctx, &ids]<i32... N>(std::integer_sequence<i32, N...>)
+			{
+				for (Id id : ids)
+				{
+					(ctx.Add<BenchSpawned<N>>(id), ...);
+				}
+			}(std::make_integer_sequence<i32, 10>{});
+		});
+		spawning.run("AddN", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(count);
+			AddId(ctx, ids);
+			[&ctx, &ids]<i32... N>(std::integer_sequence<i32, N...>)
+			{
+				(ctx.AddN<BenchSpawned<N>>(ids), ...);
+			}(std::make_integer_sequence<i32, 10>{});
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench spatial;
+		constexpr i32 count    = 1000000;
+		constexpr float world  = 1000.f;
+		constexpr i32 numMoved = 10000;
+		spatial.title("ECS - Spatial index (1M entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		std::mt19937 random{1};
+		std::uniform_real_distribution<float> position{0.f, world};
+		std::uniform_real_distribution<float> size{0.1f, 2.f};
+		auto makeBox = [&](float scale)
+		{
+			const v3 min{position(random), position(random), position(random)};
+			return Box{min, min + v3{size(random), size(random), size(random)} * scale};
+		};
+
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(count);
+		AddId(ctx, ids);
+		for (Id id : ids)
+		{
+			BenchBounds bounds;
+			static_cast<Box&>(bounds) = makeBox(1.f);
+			ctx.Add<BenchBounds>(id, bounds);
+		}
+		TArray<Box> queries;
+		for (i32 i = 0; i < 100; ++i)
+		{
+			queries.Add(makeBox(20.f));
+		}
+
+		spatial.run("Build", [&]
+		{
+			TIdSpatialIndex<BenchBounds> index;
+			index.Update(ctx);
+			ankerl::nanobench::doNotOptimizeAway(index.GetHeight());
+		});
+
+		TIdSpatialIndex<BenchBounds> index{0.2f};
+		index.Update(ctx);
+		ctx.ClearPool<CMdfd<BenchBounds>>();
+
+		TArray<Id> found;
+		spatial.run("Overlap x100 (pool iteration)", [&]
+		{
+			found.Clear(Shrink::No);
+			const auto& pool = *ctx.GetPool<const BenchBounds>();
+			for (const Box& query : queries)
+			{
+				for (Id id : pool.GetIdList())
+				{
+					if (pool.Get(id).Overlaps(query))
+					{
+						found.Add(id);
+					}
+				}
+			}
+			ankerl::nanobench::doNotOptimizeAway(found.Size());
+		});
+		spatial.run("Overlap x100 (IdSpatialIndex)", [&]
+		{
+			found.Clear(Shrink::No);
+			for (const Box& query : queries)
+			{
+				index.FindOverlapping(query, found);
+			}
+			ankerl::nanobench::doNotOptimizeAway(found.Size());
+		});
+		TArray<TArray<Id>> batchFound;
+		spatial.run("Overlap x100 (IdSpatialIndex, batch)", [&]
+		{
+			index.FindOverlapping(queries, batchFound);
+			ankerl::nanobench::doNotOptimizeAway(batchFound.Size());
+		});
+		spatial.run("Radius x100 (IdSpatialIndex)", [&]
+		{
+			found.Clear(Shrink::No);
+			for (const Box& query : queries)
+			{
+				index.FindInRadius(query.GetCenter(), 20.f, found);
+			}
+			ankerl::nanobench::doNotOptimizeAway(found.Size());
+		});
+		spatial.run("Ray x100 (IdSpatialIndex)", [&]
+		{
+			found.Clear(Shrink::No);
+			for (const Box& query : queries)
+			{
+				index.FindOnRay(query.min, v3{1.f, 0.f, 0.f}, world, found);
+			}
+			ankerl::nanobench::doNotOptimizeAway(found.Size());
+		});
+		std::uniform_real_distribution<float> offset{-0.5f, 0.5f};
+		spatial.run("Move 10k + Update", [&]
+		{
+			for (i32 i = 0; i < numMoved; ++i)
+			{
+				BenchBounds& bounds = ctx.Get<BenchBounds>(ids[i * (count / numMoved)]);
+				const v3 move{offset(random), offset(random), offset(random)};
+				bounds.min += move;
+				bounds.max += move;
+			}
+			index.Update(ctx);
+			ctx.ClearPool<CMdfd<BenchBounds>>();
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench serialization;
+		serialization.title("ECS - Binary serialization (100k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		IdContext ctx;
+		TArray<Id> ids;
+		ids.Resize(100000);
+		AddId(ctx, ids);
+		for (i32 i = 0; i < ids.Size(); ++i)
+		{
+			ctx.Add<BenchSaved>(ids[i], {float(i), 1.f, 2.f});
+			ctx.Add<BenchSavedReflected>(ids[i], {float(i), 1.f, 2.f});
+		}
+
+		auto write = [&](BinaryFormatWriter& writer, TFunction<void(EntityWriter&)> onWritePools)
+		{
+			EntityWriter w{writer.GetWriter(), ctx};
+			w.SerializeEntities(ids, onWritePools, false);
+		};
+		auto read = [](BinaryFormatWriter& writer, TFunction<void(EntityReader&)> onReadPools)
+		{
+			IdContext loadedCtx;
+			TArray<Id> loadedIds;
+			BinaryFormatReader reader{writer.GetData()};
+			EntityReader r{reader.GetReader(), loadedCtx};
+			r.SerializeEntities(loadedIds, onReadPools);
+			ankerl::nanobench::doNotOptimizeAway(r.GetIds().Size());
+		};
+		auto writeRaw = [](EntityWriter& w)
+		{
+			w.SerializePool<BenchSaved>();
+		};
+		auto writeReflected = [](EntityWriter& w)
+		{
+			w.SerializePool<BenchSavedReflected>();
+		};
+
+		serialization.run("Write (raw bytes)", [&]
+		{
+			BinaryFormatWriter writer;
+			write(writer, writeRaw);
+			ankerl::nanobench::doNotOptimizeAway(writer.GetData().Size());
+		});
+		serialization.run("Write (reflection)", [&]
+		{
+			BinaryFormatWriter writer;
+			write(writer, writeReflected);
+			ankerl::nanobench::doNotOptimizeAway(writer.GetData().Size());
+		});
+
+		BinaryFormatWriter savedRaw, savedReflected;
+		write(savedRaw, writeRaw);
+		write(savedReflected, writeReflected);
+		serialization.run("Read (raw bytes)", [&]
+		{
+			read(savedRaw, [](EntityReader& r) { r.SerializePool<BenchSaved>(); });
+		});
+		serialization.run("Read (reflection)", [&]
+		{
+			read(savedReflected, [](EntityReader& r) { r.SerializePool<BenchSavedReflected>(); });
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench removal;
+		removal.title("ECS - Removal (50k of 100k entities)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		// Every run fills a new context, so "Fill" is the baseline of the others
+		auto fill = [](IdContext& ctx, TArray<Id>& ids)
+		{
+			ids.Resize(100000);
+			AddId(ctx, ids);
+			ctx.AddN<BenchPosition>(ids);
+			ctx.AddN<BenchVelocity>(ids);
+			for (i32 i = 0; i < ids.Size(); i += 100)
+			{
+				ctx.Add<BenchHealth>(ids[i]);
+				ctx.Add<BenchTagA>(ids[i]);
+			}
+			ctx.AssurePool<BenchTagB>();
+		};
+		removal.run("Fill", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			fill(ctx, ids);
+			ankerl::nanobench::doNotOptimizeAway(ids.Size());
+		});
+		removal.run("Fill + RmId (Instant)", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			fill(ctx, ids);
+			RmId(ctx, TView<const Id>{ids.Data(), ids.Size() / 2}, RmIdFlags::Instant);
+		});
+		removal.run("Fill + RmId + FlushDeferredRemovals", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			fill(ctx, ids);
+			RmId(ctx, TView<const Id>{ids.Data(), ids.Size() / 2});
+			FlushDeferredRemovals(ctx);
+		});
+
+		// Every other id is removed, leaving a removed slot between each id
+		auto fillHoles = [&fill](IdContext& ctx, TArray<Id>& ids)
+		{
+			fill(ctx, ids);
+			TArray<Id> removed;
+			for (i32 i = 0; i < ids.Size(); i += 2)
+			{
+				removed.Add(ids[i]);
+			}
+			RmId(ctx, removed, RmIdFlags::Instant);
+		};
+		removal.run("Fill + RmId + Compact", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			fillHoles(ctx, ids);
+			CompactPools(ctx, Seconds{10});
+		});
+		removal.run("Fill + RmId + CompactPools (100us)", [&]
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			fillHoles(ctx, ids);
+			CompactPools(ctx, Microseconds{100});
+		});
+	}
+
+	{
+		ankerl::nanobench::Bench ids;
+		constexpr i32 count = 100000;    // Ids created per iteration, split between threads
+		ids.title("ECS - Id creation (100k ids)")
+		    .performanceCounters(true)
+		    .minEpochIterations(5)
+		    .maxEpochTime(p::Seconds{1});
+
+		// Creates count ids from numThreads threads. Each thread validates the ids it creates.
+		auto runThreads = [](IdRegistry& registry, i32 numThreads, auto&& create)
+		{
+			TArray<std::thread> threads;
+			for (i32 t = 0; t < numThreads; ++t)
+			{
+				threads.Add(std::thread{[&registry, &create, numThreads]()
+				{
+					i32 numValid = 0;
+					create(registry, count / numThreads, numValid);
+					ankerl::nanobench::doNotOptimizeAway(numValid);
+				}});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		};
+
+		const i32 maxThreads = Max(i32(std::thread::hardware_concurrency()), 1);
+		for (i32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			const std::string threadsName = std::format("{} threads", numThreads);
+			ids.run("Create (locked) - " + threadsName, [&]
+			{
+				IdRegistry registry;
+				runThreads(registry, numThreads, [](IdRegistry& registry, i32 n, i32& numValid)
+				{
+					for (i32 i = 0; i < n; ++i)
+					{
+						numValid += registry.IsValid(registry.Create());
+					}
+				});
+			});
+			ids.run("Reservation - " + threadsName, [&]
+			{
+				IdRegistry registry;
+				runThreads(registry, numThreads, [](IdRegistry& registry, i32 n, i32& numValid)
+				{
+					IdRegistry::Reservation reservation{registry};
+					for (i32 i = 0; i < n; ++i)
+					{
+						numValid += registry.IsValid(reservation.Create());
+					}
+				});
+			});
+		}
+	}
+}
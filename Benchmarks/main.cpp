@@ -8,10 +8,12 @@
 
 // Benches
 #include "Arenas.bench.h"
+#include "ECS.bench.h"
 #include "Lookups.bench.h"
 
 int main()
 {
 	RunArenasBenchmarks();
+	RunECSBenchmarks();
 	RunLookupsBenchmarks();
 }
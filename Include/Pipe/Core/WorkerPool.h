@@ -0,0 +1,77 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+#pragma once
+
+#include "Pipe/Export.h"
+#include "PipeContainers.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+namespace p
+{
+	/**
+	 * Fixed set of threads running queued tasks.
+	 * Threads waiting for tasks to complete (WaitUntilDone, ParallelFor) help running them, so
+	 * a pool with 0 workers runs everything on the calling thread.
+	 */
+	struct P_API WorkerPool
+	{
+		using Task = std::function<void()>;
+
+	private:
+		TArray<std::thread> threads;
+		TArray<Task> tasks;
+		std::mutex tasksMutex;
+		std::condition_variable tasksCondition;
+		// Notified when tasks are added or a pending count reaches 0. See WaitUntilDone()
+		std::condition_variable doneCondition;
+		i32 numWaiting = 0;
+		bool stopping  = false;
+
+
+	public:
+		explicit WorkerPool(i32 numWorkers = GetDefaultNumWorkers());
+		~WorkerPool();
+		WorkerPool(const WorkerPool&)            = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		void Enqueue(Task&& task);
+
+		/**
+		 * Runs queued tasks on the calling thread until pending reaches 0, and sleeps while there
+		 * are none. Tasks must decrement pending with CompleteTask().
+		 */
+		void WaitUntilDone(const std::atomic<i32>& pending);
+
+		/**
+		 * Decrements pending, waking WaitUntilDone if it reaches 0. Pending is not accessed after
+		 * the decrement, so it can be destroyed as soon as WaitUntilDone returns.
+		 */
+		void CompleteTask(std::atomic<i32>& pending);
+
+		/**
+		 * Calls callback(index) for each index in [0, count) from the workers and the calling
+		 * thread. Returns once all indices have been processed.
+		 */
+		void ParallelFor(i32 count, const std::function<void(i32)>& callback);
+
+		i32 GetNumWorkers() const
+		{
+			return threads.Size();
+		}
+
+		// One worker per hardware thread, leaving one for the calling thread
+		static i32 GetDefaultNumWorkers();
+
+	private:
+		bool TryRunTask();
+		void WorkerLoop();
+	};
+
+	// Worker pool shared by default by parallel utilities. Created on first use.
+	P_API WorkerPool& GetDefaultWorkerPool();
+}    // namespace p
@@ -132,10 +132,13 @@ namespace p
 			// Producer's current chunk. Consumer does not access.
 			Chunk* tail            = nullptr;
 			MemoryStats* owner     = nullptr;
+			const void* thread     = nullptr;    // Identifies the producer thread
 			ThreadContext* nextCtx = nullptr;
 		};
 
 		mutable std::atomic<ThreadContext*> contexts{nullptr};
+		// Unique between instances. Identifies this owner on thread-local caches.
+		u64 uniqueId = 0;
 
 		ThreadContext* GetOrCreateContext();
 
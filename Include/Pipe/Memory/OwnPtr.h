@@ -16,7 +16,6 @@ namespace p
 {
 	namespace Internal
 	{
-		// TODO: Use pool arena for counters
 		using Deleter = void(Arena& arena, void* ptr);
 
 		// Container that lives from when an owner is created to when the last weak has been reset
@@ -32,12 +31,11 @@ namespace p
 				return deleter != nullptr;
 			}
 
-			void Delete()
-			{
-				this->~PtrWeakCounter();
-				p::Free<Internal::PtrWeakCounter>(arena, this, 1);
-			}
+			void Delete();
 		};
+
+		// Counters of owners in the heap arena are allocated from a pool cached by each thread
+		P_API PtrWeakCounter* NewPtrWeakCounter(Arena& arena, Deleter* deleter);
 	}    // namespace Internal
 
 
@@ -107,8 +105,7 @@ namespace p
 		{
 			if (value)
 			{
-				counter = new (p::Alloc<Internal::PtrWeakCounter>(arena))
-				    Internal::PtrWeakCounter(arena, deleter);
+				counter = Internal::NewPtrWeakCounter(arena, deleter);
 			}
 		}
 	};
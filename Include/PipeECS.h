@@ -5,12 +5,16 @@
 #include "Pipe/Core/PageBuffer.h"
 #include "Pipe/Core/Templates.h"
 #include "Pipe/Core/TypeTraits.h"
+#include "Pipe/Core/WorkerPool.h"
 #include "Pipe/Memory/UniquePtr.h"
 #include "PipeContainers.h"
 #include "PipeECSFwd.h"
 #include "PipePlatform.h"
 #include "PipeReflect.h"
+#include "PipeTime.h"
 
+#include <atomic>
+#include <cstdio>
 #include <shared_mutex>
 
 
@@ -20,6 +24,8 @@ namespace p
 	// FORWARD DECLARATIONS
 	//
 	struct IdContext;
+	struct IdQuery;
+	struct IdGroup;
 
 
 	////////////////////////////////
@@ -183,6 +189,9 @@ namespace p
 	template<typename T>
 	concept StoresLastModified = !IsEmpty<T> && HasAnyTypeStaticFlags<T>(TF_ECS_StoreLastModified)
 	    && (IsCopyConstructible<T> || IsMoveConstructible<T>);
+
+	template<typename T>
+	concept TracksChanges = HasAnyTypeStaticFlags<T>(TF_ECS_TrackChanges);
 	// clang-format on
 
 	template<typename T>
@@ -259,14 +268,79 @@ namespace p
 	//
 #pragma region Id Register
 	/** IdRegistry tracks the existance and versioning of ids. Used internally by the ECS
-	 * context */
+	 * context.
+	 * Ids are stored in pages that never move, so validation (IsValid, WasRemoved,
+	 * GetValidVersion) doesn't lock. Creation and removal lock, unless ids are created from a
+	 * Reservation.
+	 */
 	struct P_API IdRegistry
 	{
-		using Index   = Id::Index;
-		using Version = Id::Version;
+		using Index                   = Id::Index;
+		using Version                 = Id::Version;
+		static constexpr i32 pageSize = 4096;
+
+		/**
+		 * Indices reserved from a registry to create ids without locking it.
+		 * Indices are reserved in blocks, reusing removed indices first. Each thread creating
+		 * many ids can use its own reservation.
+		 * Unused indices return to the registry on Release() or destruction. Copies of the
+		 * registry can use the indices reserved at the moment of copying.
+		 * Resetting, copying or moving into the registry discards reserved indices.
+		 */
+		struct P_API Reservation
+		{
+		private:
+			IdRegistry* registry = nullptr;
+			TArray<Index> indices;    // Next index is the last
+			i32 blockSize  = 0;
+			u32 generation = 0;       // Generation of the registry when indices were reserved
+
+
+		public:
+			explicit Reservation(IdRegistry& registry, i32 blockSize = 256)
+			    : registry{&registry}, blockSize{blockSize}
+			{}
+			~Reservation()
+			{
+				Release();
+			}
+			Reservation(const Reservation&)            = delete;
+			Reservation& operator=(const Reservation&) = delete;
+
+			Id Create();
+			void Create(TView<Id> newIds);
+			// Returns unused indices to the registry
+			void Release();
+
+			i32 Size() const
+			{
+				return indices.Size();
+			}
+		};
 
 	private:
-		TArray<Id> entities;
+		using Slot = std::atomic<Id::Value>;
+		// Pages end with an extra slot holding the epoch of their last write
+		static constexpr i32 slotsPerPage = pageSize + 1;
+
+		// Pages of ids. The list is replaced when it grows, and old lists are kept alive until
+		// the registry is reset, so that reads never see freed memory.
+		std::atomic<Slot**> pages = nullptr;
+		i32 numPages              = 0;
+		i32 pagesCapacity         = 0;
+		struct OldPages
+		{
+			Slot** pages;
+			i32 capacity;
+		};
+		TArray<OldPages> oldPages;
+		std::atomic<u32> numIndices  = 0;    // Indices ever created
+		std::atomic<u32> numReserved = 0;    // Indices owned by reservations
+		std::atomic<u32> generation  = 0;    // Increased when reserved indices are discarded
+		u32 writeEpoch               = 1;
+		// Epoch of the source registry when this registry was last updated as its snapshot
+		u32 snapshotEpoch = 0;
+
 		TArray<Index> available;
 		TArray<Id> deferredRemovals;    // List of ids that are invalid but not removed yet.
 
@@ -279,8 +353,12 @@ namespace p
 	public:
 
 		IdRegistry(Arena& arena = GetCurrentArena())
-		    : entities{arena}, available{arena}, deferredRemovals{arena}, arena{&arena}
+		    : oldPages{arena}, available{arena}, deferredRemovals{arena}, arena{&arena}
 		{}
+		~IdRegistry()
+		{
+			Reset();
+		}
 		IdRegistry(IdRegistry&& other);
 		IdRegistry(const IdRegistry& other);
 		IdRegistry& operator=(IdRegistry&& other);
@@ -304,6 +382,55 @@ namespace p
 
 		template<typename Callback>
 		void Each(Callback cb) const;
+
+		/**
+		 * Makes this registry a copy of source, copying only pages written since the last
+		 * update. Indices reserved in source become available in the copy. Finding them scans
+		 * all indices, so updates are O(ids) while source has reservations with unused indices.
+		 */
+		void UpdateSnapshot(IdRegistry& source);
+
+	private:
+		// Returns the stored id of an index, or nullptr if it was never created
+		const Slot* FindSlot(Index index) const
+		{
+			if (index >= numIndices.load(std::memory_order_acquire))
+			{
+				return nullptr;
+			}
+			return GetSlot(index);
+		}
+		Slot* GetSlot(Index index) const
+		{
+			Slot* const* const currentPages = pages.load(std::memory_order_acquire);
+			return currentPages[index / pageSize] + index % pageSize;
+		}
+		// Writes the id of an index and marks its page as written
+		void StoreSlot(Index index, Id::Value value)
+		{
+			Slot* const page = pages.load(std::memory_order_acquire)[index / pageSize];
+			page[index % pageSize].store(value, std::memory_order_release);
+			MarkPageWritten(page);
+		}
+		void MarkPageWritten(Slot* page)
+		{
+			// Threads can write the same page, but always the same epoch
+			if (page[pageSize].load(std::memory_order_relaxed) != writeEpoch)
+			{
+				page[pageSize].store(writeEpoch, std::memory_order_relaxed);
+			}
+		}
+
+		// Adds new invalid indices. Must be locked.
+		void AddIndices(u32 count);
+		// Reserves indices for a reservation, recycled ones first
+		void ReserveIndices(i32 count, TArray<Index>& outIndices, u32& outGeneration);
+		// Returns reserved indices. Ignored if the registry changed generation since.
+		void ReleaseIndices(TView<const Index> indices, u32 generation);
+		// Copies other. If sinceEpoch is not 0, pages written before it are not copied.
+		void CopyFrom(const IdRegistry& other, u32 sinceEpoch = 0);
+		void MoveFrom(IdRegistry&& other);
+		void Reset();
 	};
 #pragma endregion Id Register
 
@@ -317,6 +444,11 @@ namespace p
 	struct CNotSerialized
 	{};
 
+	// Components written as raw bytes by binary formats. See TF_TrivialSerialize
+	template<typename T>
+	concept TriviallySerialized = !IsEmpty<T> && std::is_trivially_copyable_v<T>
+	                           && HasAnyTypeStaticFlags<T>(TF_TrivialSerialize);
+
 	class P_API EntityReader : public Reader
 	{
 		using Super = Reader;
@@ -337,6 +469,11 @@ namespace p
 		void SerializeEntity(Id& entity, TFunction<void(EntityReader&)> onReadPools);
 		void SerializeSingleEntity(Id& entity, TFunction<void(EntityReader&)> onReadPools);
 
+		// Creates count ids to be read a chunk at a time. See EntityWriter::BeginChunks()
+		void BeginChunks(i32 count);
+		// Reads the components of the next chunk
+		void SerializeChunk(TFunction<void(EntityReader&)> onReadPools);
+
 		template<typename T>
 		void SerializePool();
 
@@ -349,6 +486,10 @@ namespace p
 		const TArray<Id>& GetIds() const;
 		IdContext& GetContext();
 
+	private:
+		template<typename T>
+		void SerializeBinaryPool();
+
 	protected:
 		TypeId ProvideTypeId() const override
 		{
@@ -366,8 +507,12 @@ namespace p
 
 		// While serializing we create ids as Ids appear and link them.
 		TArray<Id> ids;
-		TMap<Id, i32> idToIndexes;
+		// Index in ids of each id, by its id index. -1 if not serialized
+		TArray<i32> idIndices;
 		bool serializingMany = false;
+		// Range of ids written while serializing many
+		i32 chunkBegin = 0;
+		i32 chunkEnd   = 0;
 
 
 	public:
@@ -379,6 +524,14 @@ namespace p
 		    Id entity, TFunction<void(EntityWriter&)> onWritePools, bool includeChildren = true);
 		void SerializeSingleEntity(Id entity, TFunction<void(EntityWriter&)> onWritePools);
 
+		/**
+		 * Finds the ids to write a chunk at a time, to avoid having all their components in memory.
+		 * See EntityFileWriter
+		 */
+		void BeginChunks(const TArray<Id>& entities, bool includeChildren = true);
+		// Writes the components of ids [first, first + count)
+		void SerializeChunk(i32 first, i32 count, TFunction<void(EntityWriter&)> onWritePools);
+
 		template<typename T>
 		void SerializePool();
 
@@ -389,9 +542,13 @@ namespace p
 		}
 
 		const TArray<Id>& GetIds() const;
-		const TMap<Id, i32>& GetIdToIndexes() const;
+		// @return the index of an id in GetIds(), or -1 if it is not serialized
+		i32 GetSerializedIndex(Id id) const;
 
 	private:
+		template<typename T>
+		void SerializeBinaryPool();
+
 		void RetrieveHierarchy(const TArray<Id>& roots, TArray<Id>& children);
 		void RemoveIgnoredEntities(TArray<Id>& entities);
 		void MapIdsToIndices();
@@ -403,6 +560,80 @@ namespace p
 		}
 	};
 
+	/**
+	 * Writes ids and their components to a file, a chunk of ids at a time.
+	 * Only the components of one chunk are in memory at once. See EntityFileReader
+	 */
+	struct P_API EntityFileWriter
+	{
+	private:
+		IdContext& context;
+		std::FILE* file = nullptr;
+		i32 idsPerChunk = 0;
+
+
+	public:
+		EntityFileWriter(IdContext& context, StringView path, i32 idsPerChunk = 64 * 1024);
+		~EntityFileWriter();
+		EntityFileWriter(const EntityFileWriter&)            = delete;
+		EntityFileWriter& operator=(const EntityFileWriter&) = delete;
+
+		// @return true if all chunks were written
+		bool Write(const TArray<Id>& entities, TFunction<void(EntityWriter&)> onWritePools,
+		    bool includeChildren = true);
+
+		bool IsValid() const
+		{
+			return file != nullptr;
+		}
+	};
+
+	enum class EntityFileStatus : u8
+	{
+		Read,         // A chunk was read
+		End,          // All chunks were read
+		Invalid,      // The file could not be opened or is not an entity file
+		Truncated     // The file ends before one of its chunks
+	};
+
+	/**
+	 * Reads ids and their components from a file written by EntityFileWriter.
+	 * All ids are created when opened. Their components can then be read a chunk at a time.
+	 * Opening checks that all chunks are in the file, so no ids are created for broken files.
+	 */
+	struct P_API EntityFileReader
+	{
+	private:
+		std::FILE* file = nullptr;
+		TArray<u8> chunk;
+		BinaryFormatReader format{TView<u8>{}};
+		EntityReader reader;
+		u32 numChunks           = 0;
+		u32 numChunksRead       = 0;
+		EntityFileStatus status = EntityFileStatus::Invalid;
+
+
+	public:
+		EntityFileReader(IdContext& context, StringView path);
+		~EntityFileReader();
+		EntityFileReader(const EntityFileReader&)            = delete;
+		EntityFileReader& operator=(const EntityFileReader&) = delete;
+
+		// @return Read if a chunk was read, End if there are no more, or the error found
+		EntityFileStatus ReadChunk(TFunction<void(EntityReader&)> onReadPools);
+		// @return End if all chunks were read, or the error found
+		EntityFileStatus ReadAll(TFunction<void(EntityReader&)> onReadPools);
+
+		bool IsValid() const
+		{
+			return file != nullptr;
+		}
+		const TArray<Id>& GetIds() const
+		{
+			return reader.GetIds();
+		}
+	};
+
 	void P_API Read(p::Reader& ct, p::Id& val);
 	void P_API Write(p::Writer& ct, p::Id val);
 #pragma endregion Serialization
@@ -547,6 +778,60 @@ namespace p
 		virtual TUniquePtr<IPool> Clone()              = 0;
 		virtual const TArray<Id>& GetIdList() const    = 0;
 
+		/**
+		 * Checks if many ids are contained at once.
+		 * @param results will be resized to ids.Size(). Each bit is set if its id is contained.
+		 */
+		virtual void HasIds(TView<const Id> ids, BitArray& results) const;
+
+		// Bit per id index, set if contained. Null if the pool doesn't keep one.
+		virtual const BitArray* GetIdBits() const
+		{
+			return nullptr;
+		}
+
+		/**
+		 * Removes many ids at once. Same as Remove(ids), but pools with less ids than the list
+		 * check their ids against the mask instead.
+		 * @param mask has a bit set for the index of each of the ids
+		 */
+		virtual i32 RemoveMasked(TView<const Id> ids, const BitArray& mask)
+		{
+			return Remove(ids);
+		}
+
+		/**
+		 * True if removing ids only changes this pool, and not groups, queries or anything else
+		 * a destructor can touch. Isolated pools can remove ids in parallel.
+		 */
+		virtual bool IsIsolated() const
+		{
+			return true;
+		}
+
+		// Ratio of removed slots still taking space in the pool. See CompactStep()
+		virtual float GetRemovedRatio() const
+		{
+			return 0.f;
+		}
+
+		/**
+		 * Moves up to maxMoves ids from the end of the pool into removed slots. The pool is valid
+		 * between calls, so compaction can be spread over frames. Don't call while iterating it.
+		 * @return true if no removed slots are left
+		 */
+		virtual bool CompactStep(i32 maxMoves)
+		{
+			return true;
+		}
+
+		/**
+		 * Updates a copy of this pool, copying only pages written since its last update.
+		 * @param snapshot pool to update, created in ctx if null
+		 * See IdContext::UpdateSnapshot()
+		 */
+		virtual void UpdateSnapshot(IdContext& ctx, TUniquePtr<IPool>& snapshot) {}
+
 		bool IsEmpty() const
 		{
 			return Size() > 0;
@@ -574,12 +859,35 @@ namespace p
 
 	struct P_API ComponentPool : public IPool
 	{
+		friend IdQuery;
+		friend IdGroup;
+
+		// Components per page. Equal for all pools so that the pages of a group align.
+		static constexpr i32 pageSize = 1024;
+
 	protected:
 		TPageBuffer<i32, 4096> idIndices;
 		TArray<Id> idList;
 		Arena* arena         = nullptr;
 		i32 lastRemovedIndex = NO_INDEX;
+		// Removed slots in idList, and index before which there are none
+		i32 numRemoved   = 0;
+		i32 compactIndex = 0;
+		// Epoch of the last write to each page. Tracked after the first snapshot of the pool.
+		bool trackWrites = false;
+		u32 writeEpoch   = 1;
+		TArray<u32> pageEpochs;
+		// Epoch of the source pool when this pool was last updated as its snapshot
+		u32 snapshotEpoch = 0;
 		PoolRemovePolicy removePolicy;
+		// Queries notified when ids are added or removed. Not copied with the pool.
+		TArray<IdQuery*> queries;
+		// Group owning the order of this pool, if any. Not copied with the pool.
+		IdGroup* group = nullptr;
+		// Bit per id index, set if contained. Makes Has and intersecting many pools a matter of
+		// bit operations. It is kept in addition to idList and idIndices, also for empty types.
+		// TODO: Bitset-only storage for empty components, without idList or idIndices
+		BitArray idBits;
 
 
 		ComponentPool(TypeId typeId, PoolRemovePolicy removePolicy, Arena& arena);
@@ -608,8 +916,19 @@ namespace p
 
 		bool Has(Id id) const override
 		{
-			const i32* const index = idIndices.At(id.GetIndex());
-			return index && *index != NO_INDEX;
+			const Index index = id.GetIndex();
+			// Only ids with their bit set check the version, so older ids of an index don't match
+			return index < Index(idBits.Size()) && (idBits.Data()[index >> 5] >> (index & 31)) & 1u
+			    && idList[idIndices[index]] == id;
+		}
+
+		void HasIds(TView<const Id> ids, BitArray& results) const final;
+		// Clears the bits of word for the ids (up to 32) not contained, checking their versions
+		u32 FilterIdsWord(const Id* ids, u32 word) const;
+
+		const BitArray* GetIdBits() const final
+		{
+			return &idBits;
 		}
 
 		Iterator Find(const Id id) const
@@ -633,11 +952,78 @@ namespace p
 			return idList;
 		}
 
+		IdGroup* GetGroup() const
+		{
+			return group;
+		}
+
+		i32 RemoveMasked(TView<const Id> ids, const BitArray& mask) override;
+
+		bool IsIsolated() const override
+		{
+			return !group && queries.IsEmpty();
+		}
+
+		i32 GetNumRemoved() const
+		{
+			return numRemoved;
+		}
+
+		float GetRemovedRatio() const override
+		{
+			return Size() > 0 ? float(numRemoved) / float(Size()) : 0.f;
+		}
+
+		bool CompactStep(i32 maxMoves) override;
+
+		// Tracks writes to all current pages, so that threads can write components in parallel
+		// without resizing the tracking. Must be called again after adding ids.
+		void PrepareParallelWrites()
+		{
+			const i32 numPages = (Size() + pageSize - 1) / pageSize;
+			if (trackWrites && pageEpochs.Size() < numPages)
+			{
+				pageEpochs.Resize(numPages, 0u);
+			}
+		}
+
 	protected:
+		// Swaps the ids and components at two indices. Only index b can be a removed slot.
+		virtual void SwapIndices(i32 a, i32 b) = 0;
 
 		Index EmplaceId(const Id id, bool forceBack);
+		// Adds ids at the end, in order. Ids already in the pool (or repeated) are skipped.
+		// @return the number of ids skipped
+		i32 EmplaceIdsBack(TView<const Id> ids);
 
 		void PopId(Id id);
+		// Removes removed slots at the end of idList
+		void TrimRemoved();
+
+		void MarkWritten(i32 index)
+		{
+			if (trackWrites) [[unlikely]]
+			{
+				MarkPageWritten(index / pageSize);
+			}
+		}
+		void MarkPageWritten(i32 page)
+		{
+			if (page >= pageEpochs.Size())    // Only when adding ids
+			{
+				pageEpochs.Resize(page + 1, 0u);
+			}
+			// Threads can write the same page, but always the same epoch
+			std::atomic_ref<u32>{pageEpochs[page]}.store(writeEpoch, std::memory_order_relaxed);
+		}
+
+		// Pages written since snapshot was updated from this pool, or all if it never was
+		void GetWrittenPages(const ComponentPool& snapshot, TArray<i32>& pages) const;
+		// Unlinks the ids of a range of a snapshot before it is overwritten
+		void UnlinkIds(i32 first, i32 last);
+		// Copies the ids of a range from the source of a snapshot
+		void CopyIds(const ComponentPool& source, i32 first, i32 last);
+		void FinishSnapshot(ComponentPool& snapshot);
 
 		void PopSwapId(Id id);
 
@@ -646,6 +1032,197 @@ namespace p
 	private:
 
 		void BindOnPageAllocated();
+
+		void RebuildQueries();
+	};
+
+
+	/**
+	 * Persistent list of the ids that contain all the components of a set of pools.
+	 * Instead of rebuilding the list each call (like FindAllIdsWith), it is updated incrementally
+	 * when ids are added to or removed from any of its pools.
+	 * Queries are owned by an IdContext. See IdContext::AssureQuery().
+	 */
+	struct P_API IdQuery
+	{
+		using Iterator = const Id*;
+
+	private:
+		TArray<ComponentPool*> pools;
+		TArray<TypeId> typeIds;    // Sorted
+		TArray<Id> ids;
+		// Index of each id inside the ids list
+		TPageBuffer<i32, 4096> idIndices;
+
+
+	public:
+		IdQuery(TView<ComponentPool* const> pools, Arena& arena = GetCurrentArena());
+		~IdQuery();
+		IdQuery(const IdQuery&)            = delete;
+		IdQuery& operator=(const IdQuery&) = delete;
+
+		// Finds all matching ids again from the pools
+		void Rebuild();
+
+		bool Has(Id id) const
+		{
+			const i32* const index = idIndices.At(id.GetIndex());
+			return index && *index != NO_INDEX && ids[*index] == id;
+		}
+
+		i32 Size() const
+		{
+			return ids.Size();
+		}
+
+		bool IsEmpty() const
+		{
+			return ids.IsEmpty();
+		}
+
+		TView<const Id> GetIds() const
+		{
+			return ids;
+		}
+
+		TView<const TypeId> GetTypeIds() const
+		{
+			return typeIds;
+		}
+
+		TView<ComponentPool* const> GetPools() const
+		{
+			return pools;
+		}
+
+		bool Matches(TView<const TypeId> sortedTypeIds) const;
+
+		Iterator begin() const
+		{
+			return ids.Data();
+		}
+		Iterator end() const
+		{
+			return ids.Data() + ids.Size();
+		}
+
+	private:
+		friend ComponentPool;
+
+		void OnIdAdded(Id id);
+		void OnIdRemoved(Id id);
+		void Clear();
+	};
+
+
+	/**
+	 * Owned group of pools that are kept sorted so that their first Size() entries refer to the
+	 * same ids in the same order. Iterating a group is a linear walk over the pages of its pools,
+	 * without lookups.
+	 * A pool can be owned by only one group. Swapping or sorting a grouped pool breaks the group.
+	 * Groups are owned by an IdContext. See IdContext::AssureGroup().
+	 */
+	struct P_API IdGroup
+	{
+	private:
+		const IdContext* context = nullptr;    // Gives the tick of changed components
+		TArray<ComponentPool*> pools;
+		TArray<TypeId> typeIds;    // Sorted
+		i32 size = 0;
+
+
+	public:
+		IdGroup(const IdContext& context, TView<ComponentPool* const> pools);
+		~IdGroup();
+		IdGroup(const IdGroup&)            = delete;
+		IdGroup& operator=(const IdGroup&) = delete;
+
+		// Sorts all pools again
+		void Rebuild();
+
+		bool Has(Id id) const
+		{
+			const ComponentPool* const pool = pools.First();
+			return pool->Has(id) && pool->GetIndexFromId(id) < size;
+		}
+
+		i32 Size() const
+		{
+			return size;
+		}
+
+		bool IsEmpty() const
+		{
+			return size == 0;
+		}
+
+		TView<const Id> GetIds() const
+		{
+			return {pools.First()->GetIdList().Data(), size};
+		}
+
+		TView<const TypeId> GetTypeIds() const
+		{
+			return typeIds;
+		}
+
+		TView<ComponentPool* const> GetPools() const
+		{
+			return pools;
+		}
+
+		bool Matches(TView<const TypeId> sortedTypeIds) const;
+
+		// Calls callback(id, components...) for each id of the group
+		template<typename... Component, typename Callback>
+		void Each(Callback&& callback) requires((!p::IsEmpty<Component> && ...));
+		template<typename... Component, typename Callback>
+		void Each(Callback&& callback) const
+		    requires((!p::IsEmpty<Component> && IsConst<Component>) && ...)
+		{
+			const_cast<IdGroup*>(this)->Each<Component...>(p::Fwd<Callback>(callback));
+		}
+
+		/**
+		 * Calls callback(ids, components...) for each page of the group, where components are
+		 * pointers to the first component of the page. Ids and components are contiguous.
+		 */
+		template<typename... Component, typename Callback>
+		void EachPage(Callback&& callback) requires((!p::IsEmpty<Component> && ...));
+		template<typename... Component, typename Callback>
+		void EachPage(Callback&& callback) const
+		    requires((!p::IsEmpty<Component> && IsConst<Component>) && ...)
+		{
+			const_cast<IdGroup*>(this)->EachPage<Component...>(p::Fwd<Callback>(callback));
+		}
+
+		template<typename Component>
+		TPool<Mut<Component>>* GetPool() const;
+
+	private:
+		template<typename Component>
+		static void MarkPageChanged(TPool<Mut<Component>>* pool, i32 page, u32 tick, i32 count)
+		{
+			if constexpr (IsMutable<Component> && TracksChanges<Component>)
+			{
+				pool->MarkPageChanged(page, tick, count);
+			}
+		}
+
+		friend ComponentPool;
+		template<typename T>
+		friend struct TPool;
+
+		friend IdContext;
+
+		// Called after an id is added to a pool of the group
+		void OnIdAdded(Id id);
+		// Called before an id is removed from a pool of the group
+		void OnIdRemoved(Id id);
+		void Clear()
+		{
+			size = 0;
+		}
 	};
 
 
@@ -653,61 +1230,28 @@ namespace p
 	struct TPool : public ComponentPool
 	{
 	private:
-		TPageBuffer<T, 1024> data;
+		TPageBuffer<T, pageSize> data;
+		// Tick of the last change of each component. Only used if T TracksChanges.
+		TPageBuffer<u32, pageSize> changeTicks;
 
 
 	public:
 		TPool(p::IdContext& ctx, Arena& arena = GetCurrentArena())
-		    : ComponentPool(p::GetTypeId<T>(), PoolRemovePolicy::InPlace, arena), data{arena}
+		    : ComponentPool(p::GetTypeId<T>(), PoolRemovePolicy::InPlace, arena)
+		    , data{arena}
+		    , changeTicks{arena}
 		{}
-		TPool(const TPool& other) : ComponentPool(other), data{*other.arena}
+		TPool(const TPool& other)
+		    : ComponentPool(other), data{*other.arena}, changeTicks{*other.arena}
 		{
-			if constexpr (!p::IsEmpty<T>)
-			{
-				data.Reserve(other.data.Capacity());
-				i32 u = 0;
-				for (i32 i = 0; i < other.Size(); ++i, ++u)
-				{
-					const Id id = other.idList[i];
-					if (id != NoId)
-					{
-						if constexpr (IsCopyConstructible<T>)
-						{
-							data.Insert(u, other.data[i]);
-						}
-						else
-						{
-							data.Insert(u);
-						}
-					}
-				}
-			}
+			CopyData(other);
 		}
 		TPool& operator=(const TPool& other)
 		{
 			ComponentPool::operator=(other);
-			data = TPageBuffer<T, 1024>{*other.arena};
-
-			if constexpr (!p::IsEmpty<T>)
-			{
-				data.Reserve(other.data.Capacity());
-				i32 u = 0;
-				for (i32 i = 0; i < other.Size(); ++i, ++u)
-				{
-					const Id id = other.idList[i];
-					if (id != NoId)
-					{
-						if constexpr (IsCopyConstructible<T>)
-						{
-							data.Insert(u, other.data[i]);
-						}
-						else
-						{
-							data.Insert(u);
-						}
-					}
-				}
-			}
+			data        = TPageBuffer<T, pageSize>{*other.arena};
+			changeTicks = TPageBuffer<u32, pageSize>{*other.arena};
+			CopyData(other);
 			return *this;
 		}
 		~TPool() override
@@ -744,15 +1288,38 @@ namespace p
 				if constexpr (!p::IsEmpty<T>)
 				{
 					data.Reserve(index + 1u);
-					T* const value = data.Insert(index, p::Fwd<Args>(args)...);
+					T* value = data.Insert(index, p::Fwd<Args>(args)...);
+					InsertChangeTick(index);
+					if (group)
+					{
+						group->OnIdAdded(id);
+						value = &Get(id);    // The group may have moved it
+					}
 					return *value;
 				}
-			}
-		}
+				else
+				{
+					InsertChangeTick(index);
+					if (group)
+					{
+						group->OnIdAdded(id);
+					}
+				}
+			}
+		}
 
 		template<typename It>
 		void Add(It first, It last, const T& value = {}) requires(IsCopyConstructible<T>)
 		{
+			if constexpr (std::contiguous_iterator<It>)
+			{
+				if (!group)
+				{
+					AddBack({std::to_address(first), i32(last - first)}, nullptr, value);
+					return;
+				}
+			}
+
 			const sizet numToAdd = std::distance(first, last);
 
 			TArray<Id> ids;
@@ -761,10 +1328,7 @@ namespace p
 			{
 				ids.Add(*it);
 			}
-
-			const sizet newSize = Size() + numToAdd;
-			idList.Reserve(newSize);
-			data.Reserve(newSize);
+			ReserveMore(numToAdd);
 
 			for (Id id : ids)
 			{
@@ -782,6 +1346,11 @@ namespace p
 					{
 						data.Insert(index, value);
 					}
+					InsertChangeTick(index);
+					if (group)
+					{
+						group->OnIdAdded(id);
+					}
 				}
 			}
 		}
@@ -790,6 +1359,16 @@ namespace p
 		void Add(It first, It last, CIt from)
 		    requires(IsSame<std::decay_t<typename std::iterator_traits<CIt>::value_type>, T>)
 		{
+			if constexpr (std::contiguous_iterator<It> && std::contiguous_iterator<CIt>
+			              && IsCopyConstructible<T>)
+			{
+				if (!group)
+				{
+					AddBack({std::to_address(first), i32(last - first)}, std::to_address(from));
+					return;
+				}
+			}
+
 			const sizet numToAdd = std::distance(first, last);
 
 			TArray<Id> ids;
@@ -798,10 +1377,7 @@ namespace p
 			{
 				ids.Add(*it);
 			}
-
-			const sizet newSize = Size() + numToAdd;
-			idList.Reserve(newSize);
-			data.Reserve(newSize);
+			ReserveMore(numToAdd);
 
 			for (Id id : ids)
 			{
@@ -829,6 +1405,11 @@ namespace p
 					{
 						data.Insert(index, *from);
 					}
+					InsertChangeTick(index);
+					if (group)
+					{
+						group->OnIdAdded(id);
+					}
 				}
 				++from;
 			}
@@ -909,6 +1490,7 @@ namespace p
 		{
 			P_Check(Has(id));
 			const i32 index = GetIndexFromId(id);
+			MarkWritten(index);
 			return data[index];
 		}
 
@@ -925,6 +1507,7 @@ namespace p
 				const i32* const index = idIndices.At(id.GetIndex());
 				if (index && *index != NO_INDEX)    // Has(id)
 				{
+					MarkWritten(*index);
 					return &data[*index];
 				}
 			}
@@ -944,6 +1527,12 @@ namespace p
 			return nullptr;
 		}
 
+		// Destructors of components may touch state shared with other pools
+		bool IsIsolated() const override
+		{
+			return p::IsTriviallyDestructible<T> && ComponentPool::IsIsolated();
+		}
+
 		void* TryGetVoid(Id id) override
 		{
 			return TryGet(id);
@@ -954,6 +1543,61 @@ namespace p
 			return p::MakeUnique<TPool<T>>(*this);
 		}
 
+		void UpdateSnapshot(IdContext& ctx, TUniquePtr<IPool>& snapshotPool) override
+		{
+			if (!snapshotPool)
+			{
+				snapshotPool = p::MakeUnique<TPool<T>>(ctx, *arena);
+			}
+			auto& snapshot = *static_cast<TPool*>(snapshotPool.Get());
+
+			TArray<i32> pages;
+			GetWrittenPages(snapshot, pages);
+			// Ids can move between pages, so all written pages are unlinked first
+			for (i32 page : pages)
+			{
+				const i32 first = page * pageSize;
+				const i32 last  = Min(first + pageSize, snapshot.Size());
+				if constexpr (!p::IsEmpty<T>)
+				{
+					for (i32 i = first; i < last; ++i)
+					{
+						if (!IsNone(snapshot.idList[i]))
+						{
+							snapshot.data.RemoveAt(i);
+						}
+					}
+				}
+				snapshot.UnlinkIds(first, last);
+			}
+
+			snapshot.idList.Resize(Size(), Shrink::No);
+			snapshot.data.Reserve(Size());
+			snapshot.changeTicks.Reserve(Size());
+			for (i32 page : pages)
+			{
+				const i32 first = page * pageSize;
+				const i32 last  = Min(first + pageSize, Size());
+				snapshot.CopyIds(*this, first, last);
+				for (i32 i = first; i < last; ++i)
+				{
+					if (IsNone(idList[i]))
+					{
+						continue;
+					}
+					if constexpr (!p::IsEmpty<T>)
+					{
+						snapshot.data.Insert(i, data[i]);
+					}
+					if constexpr (TracksChanges<T>)
+					{
+						snapshot.changeTicks.Insert(i, changeTicks[i]);
+					}
+				}
+			}
+			FinishSnapshot(snapshot);
+		}
+
 		void Reserve(sizet size)
 		{
 			idList.Reserve(size);
@@ -966,9 +1610,14 @@ namespace p
 			}
 		}
 
+		// Grows capacity like adding ids one by one would, so that calling it often is not quadratic
 		void ReserveMore(sizet size)
 		{
-			Reserve(Size() + size);
+			const sizet newSize = Size() + size;
+			if (newSize > sizet(idList.Capacity()))
+			{
+				Reserve(Max(newSize, sizet(idList.Capacity()) * 3 / 2));
+			}
 		}
 
 		void Shrink()
@@ -990,75 +1639,405 @@ namespace p
 				}
 				data.Clear();
 			}
+			changeTicks.Clear();
 			ClearIds();
 		}
 
 		/*! @brief Removes all NoId from pool */
 		void Compact()
 		{
-			i32 from = idList.Size();
-			for (; from && idList[from - 1].GetVersion() == NoIdVersion; --from)
-			{}
+			CompactStep(Limits<i32>::Max());
+		}
+
+		// Pages split the pool for parallel iteration. Removed ids stay marked with NoIdVersion.
+		i32 GetNumPages() const
+		{
+			return (Size() + pageSize - 1) / pageSize;
+		}
 
-			for (i32 to = lastRemovedIndex; to != NO_INDEX && from;)
+		TView<const Id> GetPageIds(i32 page) const
+		{
+			const i32 first = page * pageSize;
+			return {idList.Data() + first, Min(pageSize, Size() - first)};
+		}
+
+		// Values of a page, matching GetPageIds(page)
+		T* GetPageData(i32 page) requires(!p::IsEmpty<T>)
+		{
+			if (trackWrites) [[unlikely]]
 			{
-				if (to < from)
-				{
-					--from;
+				MarkPageWritten(page);
+			}
+			return data.GetPages()[page];
+		}
 
-					if constexpr (!p::IsEmpty<T>)
-					{
-						std::uninitialized_move_n(&data[from], 1, &data[to]);
-					}
+		const T* GetPageData(i32 page) const requires(!p::IsEmpty<T>)
+		{
+			return data.GetPages()[page];
+		}
 
-					auto& listTo = idList[i32(to)];
-					p::Swap(idList[from], listTo);
+		// Marks the component of an id changed at a tick. See IdContext::GetChangeTick()
+		void MarkChanged(Id id, u32 tick) requires(TracksChanges<T>)
+		{
+			P_Check(Has(id));
+			const i32 index = GetIndexFromId(id);
+			MarkWritten(index);
+			changeTicks[index] = tick;
+		}
 
-					idIndices[listTo.GetIndex()] = to;
-					to                           = from;
+		// Marks the first count components of a page changed at a tick
+		void MarkPageChanged(i32 page, u32 tick, i32 count = pageSize) requires(TracksChanges<T>)
+		{
+			const i32 first = page * pageSize;
+			MarkWritten(first);
+			std::fill_n(changeTicks.GetPages()[page], Min(count, Size() - first), tick);
+		}
+
+		// Tick when the component of an id last changed
+		u32 GetChangeTick(Id id) const requires(TracksChanges<T>)
+		{
+			P_Check(Has(id));
+			return changeTicks[GetIndexFromId(id)];
+		}
 
-					for (; from && idList[from - 1].GetVersion() == NoIdVersion; --from)
-					{}
+		// Adds all ids whose component changed after a tick
+		void FindChangedSince(u32 tick, TArray<Id>& ids) const requires(TracksChanges<T>)
+		{
+			const TArray<u32*>& pages = changeTicks.GetPages();
+			for (i32 first = 0, page = 0; first < Size(); first += pageSize, ++page)
+			{
+				const u32* const ticks = pages[page];
+				const i32 last         = Min(first + pageSize, Size());
+				for (i32 i = first; i < last; ++i)
+				{
+					// Removed slots keep their tick, so the id is checked too
+					if (ticks[i - first] > tick && idList[i].GetVersion() != NoIdVersion)
+					{
+						ids.Add(idList[i]);
+					}
 				}
 			}
-
-			lastRemovedIndex = NO_INDEX;
-			idList.Resize(from);
 		}
 
 		void Swap(const Id a, const Id b)
 		{
+			P_CheckMsg(!group, "Pools owned by a group can't be reordered");
 			P_CheckMsg(Has(a), "Set does not contain entity");
 			P_CheckMsg(Has(b), "Set does not contain entity");
 
 			i32& aListIdx = idIndices[a.GetIndex()];
 			i32& bListIdx = idIndices[b.GetIndex()];
 
+			MarkWritten(aListIdx);
+			MarkWritten(bListIdx);
 			p::Swap(idList[aListIdx], idList[bListIdx]);
 			p::Swap(aListIdx, bListIdx);
 			data.Swap(aListIdx, bListIdx);
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks.Swap(aListIdx, bListIdx);
+			}
+		}
+
+		/**
+		 * Sorts ids and components of the pool by predicate(a, b), where a and b are components,
+		 * or ids for empty components. Removed slots are compacted first. Grouped ids keep the
+		 * order of their group, so only ids after them are sorted.
+		 */
+		template<typename Predicate>
+		void Sort(Predicate&& predicate)
+		{
+			Compact();
+			const i32 first = GetFirstSortable();
+			TArray<i32> order;
+			order.Resize(Size() - first);
+			for (i32 i = 0; i < order.Size(); ++i)
+			{
+				order[i] = first + i;
+			}
+			if constexpr (p::IsEmpty<T>)
+			{
+				std::sort(order.begin(), order.end(), [this, &predicate](i32 a, i32 b)
+				{
+					return predicate(idList[a], idList[b]);
+				});
+			}
+			else
+			{
+				std::sort(order.begin(), order.end(), [this, &predicate](i32 a, i32 b)
+				{
+					return predicate(data[a], data[b]);
+				});
+			}
+			ApplyOrder(first, order);
+		}
+
+		/**
+		 * Sorts ids and components of the pool to match the order of another pool. Ids also in
+		 * the other pool are moved to the front, so both pools can be iterated in lockstep.
+		 */
+		void SortAs(const ComponentPool& other)
+		{
+			Compact();
+			const i32 first = GetFirstSortable();
+			TArray<i32> order;
+			order.Reserve(Size() - first);
+			BitArray sorted;
+			sorted.Resize(Size(), false);
+			for (Id id : other.GetIdList())
+			{
+				const i32* const index = idIndices.At(id.GetIndex());
+				if (!IsNone(id) && index && *index >= first)
+				{
+					order.Add(*index);
+					sorted.SetTrue(*index);
+				}
+			}
+			for (i32 i = first; i < Size(); ++i)
+			{
+				if (!sorted.IsSet(i))
+				{
+					order.Add(i);
+				}
+			}
+			ApplyOrder(first, order);
+		}
+
+	protected:
+		void SwapIndices(i32 a, i32 b) override
+		{
+			MarkWritten(a);
+			MarkWritten(b);
+			Id& idA             = idList[a];
+			Id& idB             = idList[b];
+			const bool bRemoved = idB.GetVersion() == NoIdVersion;
+			if constexpr (!p::IsEmpty<T>)
+			{
+				if (bRemoved)
+				{
+					std::construct_at(&data[b], Move(data[a]));
+					data.RemoveAt(a);
+				}
+				else
+				{
+					data.Swap(a, b);
+				}
+			}
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks.Swap(a, b);
+			}
+
+			if (bRemoved)
+			{
+				if (lastRemovedIndex == b)
+				{
+					lastRemovedIndex = a;
+				}
+			}
+			else
+			{
+				idIndices[idB.GetIndex()] = a;
+			}
+			idIndices[idA.GetIndex()] = b;
+			p::Swap(idA, idB);
 		}
 
 	private:
+		i32 GetFirstSortable() const
+		{
+			return group ? group->Size() : 0;
+		}
+
+		// Moves the id at order[i] to first + i, with its component and tick
+		void ApplyOrder(i32 first, TView<const i32> order)
+		{
+			if (trackWrites)
+			{
+				for (i32 page = first / pageSize; page < GetNumPages(); ++page)
+				{
+					MarkPageWritten(page);
+				}
+			}
+			BitArray moved;
+			ApplyOrder(idList, first, order, moved);
+			if constexpr (!p::IsEmpty<T>)
+			{
+				ApplyOrder(data, first, order, moved);
+			}
+			if constexpr (TracksChanges<T>)
+			{
+				ApplyOrder(changeTicks, first, order, moved);
+			}
+			for (i32 i = first; i < Size(); ++i)
+			{
+				idIndices[idList[i].GetIndex()] = i;
+			}
+		}
+
+		// Follows each cycle of the order, so that every element is moved only once
+		template<typename Buffer>
+		static void ApplyOrder(Buffer& buffer, i32 first, TView<const i32> order, BitArray& moved)
+		{
+			moved.Clear();
+			moved.Resize(order.Size(), false);
+			for (i32 i = 0; i < order.Size(); ++i)
+			{
+				if (moved.IsSet(i) || order[i] == first + i)
+				{
+					continue;
+				}
+				auto tmp = Move(buffer[first + i]);
+				i32 to   = i;
+				while (order[to] != first + i)
+				{
+					const i32 from      = order[to] - first;
+					buffer[first + to] = Move(buffer[first + from]);
+					moved.SetTrue(to);
+					to = from;
+				}
+				buffer[first + to] = Move(tmp);
+				moved.SetTrue(to);
+			}
+		}
+
 		void PopSwap(Id id)
 		{
+			if (group)
+			{
+				group->OnIdRemoved(id);
+			}
+			const i32 lastIndex = Size() - 1u;
 			if constexpr (!p::IsEmpty<T>)
 			{
-				const i32 lastIndex = Size() - 1u;
 				data.Swap(GetIndexFromId(id), lastIndex);
 				data.RemoveAt(lastIndex);
 			}
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks[GetIndexFromId(id)] = changeTicks[lastIndex];
+			}
 			PopSwapId(id);
 		}
 
 		void Pop(Id id)
 		{
+			if (group)
+			{
+				group->OnIdRemoved(id);
+			}
 			if constexpr (!p::IsEmpty<T>)
 			{
 				data.RemoveAt(GetIndexFromId(id));
 			}
 			PopId(id);
 		}
+
+		// Adds ids and their values (or value, if values is null) at the end of the pool.
+		// Components are constructed a page at a time, which is a memcpy for most types.
+		void AddBack(TView<const Id> ids, const T* values, const T& value = {})
+		{
+			const i32 firstIndex = Size();
+			const i32 numSkipped = EmplaceIdsBack(ids);
+			const i32 lastIndex  = Size();
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks.Reserve(lastIndex);
+				for (i32 index = firstIndex; index < lastIndex;)
+				{
+					const i32 offset = changeTicks.GetOffset(index);
+					const i32 count  = Min(pageSize - offset, lastIndex - index);
+					std::uninitialized_fill_n(changeTicks.AssurePage(index) + offset, count, 0u);
+					index += count;
+				}
+			}
+			if constexpr (!p::IsEmpty<T>)
+			{
+				data.Reserve(lastIndex);
+				if (numSkipped == 0) [[likely]]    // New slots match ids one to one
+				{
+					for (i32 index = firstIndex; index < lastIndex;)
+					{
+						const i32 offset = data.GetOffset(index);
+						const i32 count  = Min(pageSize - offset, lastIndex - index);
+						T* const page    = data.AssurePage(index);
+						if (values)
+						{
+							std::uninitialized_copy_n(
+							    values + (index - firstIndex), count, page + offset);
+						}
+						else
+						{
+							std::uninitialized_fill_n(page + offset, count, value);
+						}
+						index += count;
+					}
+				}
+				else
+				{
+					// Ids skipped were already in the pool. Repeated ids keep their last value.
+					i32 index = firstIndex;
+					for (i32 i = 0; i < ids.Size(); ++i)
+					{
+						const T& idValue = values ? values[i] : value;
+						if (index < lastIndex && idList[index] == ids[i])
+						{
+							data.Insert(index++, idValue);
+						}
+						else
+						{
+							Get(ids[i]) = idValue;
+						}
+					}
+				}
+			}
+		}
+
+		void InsertChangeTick(i32 index)
+		{
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks.Reserve(index + 1u);
+				changeTicks.Insert(index, 0u);
+			}
+		}
+
+		// Copies components matching the ids copied by ComponentPool, which skips removed slots
+		void CopyData(const TPool& other)
+		{
+			if constexpr (!p::IsEmpty<T>)
+			{
+				data.Reserve(Size());
+			}
+			if constexpr (TracksChanges<T>)
+			{
+				changeTicks.Reserve(Size());
+			}
+			i32 u = 0;
+			for (i32 i = 0; i < other.Size(); ++i)
+			{
+				if (other.idList[i].GetVersion() == NoIdVersion)
+				{
+					continue;
+				}
+				if constexpr (!p::IsEmpty<T>)
+				{
+					if constexpr (IsCopyConstructible<T>)
+					{
+						data.Insert(u, other.data[i]);
+					}
+					else
+					{
+						data.Insert(u);
+					}
+				}
+				if constexpr (TracksChanges<T>)
+				{
+					changeTicks.Insert(u, other.changeTicks[i]);
+				}
+				++u;
+			}
+		}
 	};
 
 	// CRemoved pool is special in the sense that it acts as an interface to deferred removals in
@@ -1269,6 +2248,28 @@ namespace p
 			return Has<CMdfd<Mut<Component>>>(id);
 		}
 
+		template<typename Component>
+		void MarkChanged(Id id, CopyConst<TPool<Mut<Component>>, Component>& pool) const
+		{
+			if constexpr (IsMutable<Component> && TracksChanges<Component>)
+			{
+				pool.MarkChanged(id, GetContext().GetChangeTick());
+			}
+		}
+		template<typename Component>
+		void MarkChanged(
+		    TView<const Id> ids, CopyConst<TPool<Mut<Component>>, Component>& pool) const
+		{
+			if constexpr (IsMutable<Component> && TracksChanges<Component>)
+			{
+				const u32 tick = GetContext().GetChangeTick();
+				for (Id id : ids)
+				{
+					pool.MarkChanged(id, tick);
+				}
+			}
+		}
+
 		template<typename Component>
 		decltype(auto) Add(Id id, Component&& value = {}) const requires(IsMutable<Component>)
 		{
@@ -1278,7 +2279,21 @@ namespace p
 			{
 				Modify<Component>(id, &pool);
 			}
-			return pool.Add(id, p::Fwd<Component>(value));
+			if constexpr (TracksChanges<Component> && !p::IsEmpty<Component>)
+			{
+				auto& added = pool.Add(id, p::Fwd<Component>(value));
+				MarkChanged<Component>(id, pool);
+				return added;
+			}
+			else if constexpr (TracksChanges<Component>)
+			{
+				pool.Add(id);
+				MarkChanged<Component>(id, pool);
+			}
+			else
+			{
+				return pool.Add(id, p::Fwd<Component>(value));
+			}
 		}
 		template<typename Component>
 		decltype(auto) Add(Id id, const Component& value) const requires(IsMutable<Component>)
@@ -1289,7 +2304,21 @@ namespace p
 			{
 				Modify<Component>(id, &pool);
 			}
-			return pool.Add(id, value);
+			if constexpr (TracksChanges<Component> && !p::IsEmpty<Component>)
+			{
+				auto& added = pool.Add(id, value);
+				MarkChanged<Component>(id, pool);
+				return added;
+			}
+			else if constexpr (TracksChanges<Component>)
+			{
+				pool.Add(id);
+				MarkChanged<Component>(id, pool);
+			}
+			else
+			{
+				return pool.Add(id, value);
+			}
 		}
 
 		// Add component to an entities (if they dont have it already)
@@ -1308,11 +2337,19 @@ namespace p
 			{
 				Modify<Component>(ids, &pool);
 			}
-			return pool.Add(ids.begin(), ids.end(), value);
-		}
-
-		template<typename Component>
-		void AddN(TView<const Id> ids, const TView<const Component>& values)
+			if constexpr (TracksChanges<Component>)
+			{
+				pool.Add(ids.begin(), ids.end(), value);
+				MarkChanged<Component>(ids, pool);
+			}
+			else
+			{
+				return pool.Add(ids.begin(), ids.end(), value);
+			}
+		}
+
+		template<typename Component>
+		void AddN(TView<const Id> ids, const TView<const Component>& values)
 		{
 			P_Check(ids.Size() == values.Size());
 			auto& pool = AssurePool<Component>();
@@ -1321,6 +2358,7 @@ namespace p
 				Modify<Component>(ids, &pool);
 			}
 			pool.Add(ids.begin(), ids.end(), values.begin());
+			MarkChanged<Component>(ids, pool);
 		}
 
 		// Add components to many entities (if they dont have it already)
@@ -1377,6 +2415,7 @@ namespace p
 			{
 				Modify<Component>(id, pool);
 			}
+			MarkChanged<Component>(id, *pool);
 			return pool->Get(id);
 		}
 
@@ -1394,6 +2433,13 @@ namespace p
 						Modify<Component>(id, pool);
 					}
 				}
+				if constexpr (IsMutable<Component> && TracksChanges<Component>)
+				{
+					if (value)
+					{
+						MarkChanged<Component>(id, *pool);
+					}
+				}
 				return value;
 			}
 			return nullptr;
@@ -1408,18 +2454,19 @@ namespace p
 			{
 				if constexpr (HasAnyTypeStaticFlags<Component>(TF_ECS_ModifyOnGet))
 				{
-					Modify<Component>(id, *pool);
+					Modify<Component>(id, &pool);
 				}
-				return pool.Get(id);
 			}
 			else
 			{
 				if constexpr (HasAnyTypeStaticFlags<Component>(TF_ECS_ModifyOnAdd))
 				{
-					Modify<Component>(id, *pool);
+					Modify<Component>(id, &pool);
 				}
-				return pool.Add(id);
+				pool.Add(id);
 			}
+			MarkChanged<Component>(id, pool);
+			return pool.Get(id);
 		}
 
 		template<typename... Component>
@@ -1427,6 +2474,28 @@ namespace p
 		{
 			(GetPool<Component>()->Clear(), ...);
 		}
+
+		// Sorts the pool of a component by predicate(a, b). See TPool::Sort()
+		template<typename Component, typename Predicate>
+		void SortPool(Predicate&& predicate) const requires(IsMutable<Component>)
+		{
+			if (auto* pool = GetPool<Component>())
+			{
+				pool->Sort(predicate);
+			}
+		}
+
+		// Sorts the pool of a component in the order of the pool of Other. See TPool::SortAs()
+		template<typename Component, typename Other>
+		void SortPoolAs() const requires(IsMutable<Component>)
+		{
+			auto* pool        = GetPool<Component>();
+			const auto* other = GetPool<const Other>();
+			if (pool && other)
+			{
+				pool->SortAs(*other);
+			}
+		}
 	};
 #pragma endregion Operations
 
@@ -1465,7 +2534,13 @@ namespace p
 		IdRegistry idRegistry;
 		mutable TArray<PoolInstance> pools;
 		TArray<OwnPtr> statics;
+		mutable TArray<TUniquePtr<IdQuery>> queries;
+		mutable TArray<TUniquePtr<IdGroup>> groups;
 		IdRemovePolicy removePolicy = IdRemovePolicy::Instant;
+		u32 changeTick              = 1;
+		// Pools are compacted on FlushDeferredRemovals with this ratio of removed slots, if not 0
+		float autoCompactRatio         = 0.f;
+		Microseconds autoCompactBudget = Microseconds{100};
 
 
 	public:
@@ -1536,6 +2611,15 @@ namespace p
 
 		void Reset(bool keepStatics = false);
 
+		/**
+		 * Makes this context a copy of source, for readers in other threads (saving,
+		 * replication...). Only pages of pools written since the last update are copied, so it
+		 * can be updated every frame. Queries, groups and statics are not copied.
+		 * See IdRegistry::UpdateSnapshot() for the cost of copying ids.
+		 * Don't read it while it is being updated.
+		 */
+		void UpdateSnapshot(IdContext& source);
+
 		IdContext& GetContext() const
 		{
 			return *const_cast<IdContext*>(this);
@@ -1562,6 +2646,66 @@ namespace p
 		{
 			return pools;
 		}
+
+		// Finds or creates a query containing all ids with every component
+		template<typename... Component>
+		IdQuery& AssureQuery() const requires(sizeof...(Component) >= 1);
+
+		// Finds a query by its component types. They must be sorted.
+		IdQuery* FindQuery(TView<const TypeId> sortedTypeIds) const;
+		bool RemoveQuery(const IdQuery& query);
+
+		/**
+		 * Finds or creates a group owning the pools of these components.
+		 * Pools can only be owned by one group, so groups can't share components.
+		 */
+		template<typename... Component>
+		IdGroup& AssureGroup() const requires(sizeof...(Component) >= 1);
+
+		// Finds a group by its component types. They must be sorted.
+		IdGroup* FindGroup(TView<const TypeId> sortedTypeIds) const;
+		bool RemoveGroup(const IdGroup& group);
+
+		/**
+		 * Adds the types of all queries and groups using a type to a sorted list. Adding or
+		 * removing ids of one of their pools also changes the others.
+		 */
+		void AddLinkedTypeIds(TypeId typeId, TArray<TypeId>& sortedTypeIds) const;
+
+		// Tick given to components with TF_ECS_TrackChanges when they are added or accessed mutably
+		u32 GetChangeTick() const
+		{
+			return changeTick;
+		}
+
+		/**
+		 * Starts a new tick and returns it. Changes done from now on are found by
+		 * FindAllIdsChanged(ctx, previousTick).
+		 */
+		u32 AdvanceChangeTick()
+		{
+			return ++changeTick;
+		}
+
+		/**
+		 * Makes FlushDeferredRemovals compact pools with a ratio of removed slots of at least
+		 * minRemovedRatio, using up to budget each time. Compaction of big pools is then spread
+		 * over the frames that flush removals. A ratio of 0 (the default) disables it.
+		 * See CompactPools()
+		 */
+		void SetAutoCompact(float minRemovedRatio, Microseconds budget = Microseconds{100})
+		{
+			autoCompactRatio  = minRemovedRatio;
+			autoCompactBudget = budget;
+		}
+		float GetAutoCompactRatio() const
+		{
+			return autoCompactRatio;
+		}
+		Microseconds GetAutoCompactBudget() const
+		{
+			return autoCompactBudget;
+		}
 #pragma endregion Entities
 
 #pragma region Statics
@@ -1750,6 +2894,16 @@ namespace p
 			return context;
 		}
 
+		// Calls group.Each<Component...>(callback), if this scope can access all components
+		template<typename... Component, typename Callback>
+		void EachGrouped(IdGroup& group, Callback&& callback) const
+		{
+			static_assert(((IsConst<Component> ? IsReadable<Component>() : IsWritable<Component>())
+			                  && ...),
+			    "Scope lacks dependencies of the group components");
+			group.Each<Component...>(p::Fwd<Callback>(callback));
+		}
+
 		template<typename Component>
 		static constexpr bool IsMdfdType() requires(!HasTypeMember<Component>)
 		{
@@ -2290,6 +3444,41 @@ namespace p
 		return Move(ids);
 	}
 
+	/**
+	 * Find all ids whose component was added or accessed mutably after a tick.
+	 * Component must have the TF_ECS_TrackChanges flag.
+	 *
+	 * @param scope from where to get pools
+	 * @param sinceTick ticks returned by IdContext::AdvanceChangeTick() or GetChangeTick()
+	 * @param ids array where matching ids will be added
+	 */
+	template<typename Component, typename Scope>
+	void FindAllIdsChanged(const Scope& scope, u32 sinceTick, TArray<Id>& ids)
+	    requires(TracksChanges<Component>)
+	{
+		if (const auto* pool = scope.template GetPool<const Component>())
+		{
+			pool->FindChangedSince(sinceTick, ids);
+		}
+	}
+
+	/**
+	 * Find all ids whose component was added or accessed mutably after a tick.
+	 * Component must have the TF_ECS_TrackChanges flag.
+	 *
+	 * @param scope from where to get pools
+	 * @param sinceTick ticks returned by IdContext::AdvanceChangeTick() or GetChangeTick()
+	 * @return ids array with matching ids
+	 */
+	template<typename Component, typename Scope>
+	TArray<Id> FindAllIdsChanged(const Scope& scope, u32 sinceTick)
+	    requires(TracksChanges<Component>)
+	{
+		TArray<Id> ids;
+		FindAllIdsChanged<Component>(scope, sinceTick, ids);
+		return Move(ids);
+	}
+
 	/**
 	 * Find all ids containing any of the components.
 	 * Includes possible duplicates
@@ -2371,6 +3560,13 @@ namespace p
 	// Remove
 	P_API bool RmId(IdContext& ctx, TView<const Id> ids, RmIdFlags flags = RmIdFlags::None);
 	P_API bool FlushDeferredRemovals(IdContext& ctx);
+
+	/**
+	 * Compacts pools with a ratio of removed slots of at least minRemovedRatio, until none are left
+	 * or the time budget runs out. Calling it every frame spreads compaction of big pools.
+	 * @return true if all pools over the ratio were fully compacted
+	 */
+	P_API bool CompactPools(IdContext& ctx, Microseconds budget, float minRemovedRatio = 0.25f);
 #pragma endregion Editing
 
 
@@ -2379,6 +3575,112 @@ namespace p
 //
 #pragma region Hierarchy
 
+	/**
+	 * Optional cache of all hierarchies of a context in depth-first order, where each id is
+	 * followed by all its descendants. Getting all descendants of an id is then a contiguous slice,
+	 * and propagating values from parents to children is a single linear sweep.
+	 *
+	 * Enabled with ctx.SetStatic<IdHierarchyIndex>(). Hierarchy functions (AttachId,
+	 * DetachIdParent, RmId...) mark it dirty, and GetIdHierarchyIndex() rebuilds it if needed.
+	 * Call MarkDirty() after editing CParent or CChild directly.
+	 */
+	struct P_API IdHierarchyIndex
+	{
+	private:
+		TArray<Id> ids;
+		// Position of the parent of each id, or NO_INDEX for roots
+		TArray<i32> parents;
+		// Position after the last descendant of each id
+		TArray<i32> ends;
+		// Distance of each id to its root
+		TArray<u32> levels;
+		// Positions sorted by level, and where each level starts in it
+		TArray<i32> levelOrder;
+		TArray<i32> levelStarts;
+		// Position of each id by its index
+		TPageBuffer<i32, 4096> positions;
+		std::atomic<bool> dirty = true;
+		std::mutex rebuildMutex;
+
+
+	public:
+		IdHierarchyIndex(Arena& arena = GetCurrentArena());
+		IdHierarchyIndex(const IdHierarchyIndex&)            = delete;
+		IdHierarchyIndex& operator=(const IdHierarchyIndex&) = delete;
+
+		void MarkDirty()
+		{
+			dirty.store(true, std::memory_order_release);
+		}
+		bool IsDirty() const
+		{
+			return dirty.load(std::memory_order_acquire);
+		}
+
+		// Rebuilds the index if it is dirty. Safe to call from multiple threads.
+		void Update(TIdScopeRef<CParent> scope);
+
+		i32 GetPosition(Id id) const
+		{
+			const i32* const position = positions.At(id.GetIndex());
+			return position && *position != NO_INDEX && ids[*position] == id ? *position
+			                                                                 : NO_INDEX;
+		}
+		bool Has(Id id) const
+		{
+			return GetPosition(id) != NO_INDEX;
+		}
+
+		// All ids of the hierarchies, each followed by its descendants
+		TView<const Id> GetIds() const
+		{
+			return ids;
+		}
+		TView<const i32> GetParentPositions() const
+		{
+			return parents;
+		}
+		TView<const i32> GetEndPositions() const
+		{
+			return ends;
+		}
+		TView<const u32> GetLevels() const
+		{
+			return levels;
+		}
+
+		i32 GetNumLevels() const
+		{
+			return Max(levelStarts.Size() - 1, 0);
+		}
+		// Positions of all ids at a distance of level to their root, in depth-first order
+		TView<const i32> GetLevelPositions(i32 level) const
+		{
+			return {levelOrder.Data() + levelStarts[level],
+			    levelStarts[level + 1] - levelStarts[level]};
+		}
+
+		// All descendants of an id, or none if not in the hierarchy
+		TView<const Id> GetDescendants(Id id) const
+		{
+			const i32 position = GetPosition(id);
+			if (position == NO_INDEX)
+			{
+				return {};
+			}
+			return {ids.Data() + position + 1, ends[position] - position - 1};
+		}
+
+	private:
+		void Rebuild(TIdScopeRef<CParent> scope);
+	};
+
+	/**
+	 * @return the hierarchy index of the context, rebuilt if it was dirty, or null if it was not
+	 * enabled. See IdHierarchyIndex.
+	 */
+	P_API const IdHierarchyIndex* GetIdHierarchyIndex(TIdScopeRef<CParent> scope);
+
 	// Link a list of nodes at the end of the parent children list
 	P_API void AttachId(
 	    TIdScopeRef<Writes<CChild, CParent>> scope, Id parent, TView<const Id> children);
@@ -2468,122 +3770,873 @@ namespace p
 
 
 ////////////////////////////////
-// DEFINITIONS
+// SPATIAL
 //
-#pragma region Definitions
+#pragma region Spatial
 
-	template<typename Callback>
-	void IdRegistry::Each(Callback cb) const
+	/**
+	 * Bounding volume hierarchy of ids and their bounds. Finds ids overlapping a box, inside a
+	 * radius or hit by a ray without iterating all of them.
+	 * Leaves are enlarged by a margin, so that ids that move less than it don't change the tree.
+	 * See TIdSpatialIndex to keep it in sync with a component.
+	 */
+	struct P_API IdSpatialIndex
 	{
-		if (available.IsEmpty() && deferredRemovals.IsEmpty())
+	private:
+		struct Node
+		{
+			Box bounds;                // Enlarged by the margin on leaves
+			i32 parent = NO_INDEX;     // Or the next free node
+			i32 children[2]{NO_INDEX, NO_INDEX};
+			i32 height = 0;            // 0 on leaves, -1 on free nodes
+		};
+
+		TArray<Node> nodes;
+		// Id and exact bounds of each leaf node
+		TArray<Id> leafIds;
+		TArray<Box> leafBounds;
+		// Leaf node of each id by its index
+		TPageBuffer<i32, 4096> leaves;
+		i32 root      = NO_INDEX;
+		i32 freeNode  = NO_INDEX;
+		i32 numLeaves = 0;
+		float margin  = 0.f;
+
+
+	public:
+		IdSpatialIndex(float margin = 0.f, Arena& arena = GetCurrentArena());
+		IdSpatialIndex(const IdSpatialIndex&)            = delete;
+		IdSpatialIndex& operator=(const IdSpatialIndex&) = delete;
+
+		// Adds an id, or updates its bounds if it was already added
+		void Set(Id id, const Box& bounds);
+		bool Remove(Id id);
+		// Replaces all ids by building a balanced tree at once. Ids must not repeat.
+		void Build(TView<const Id> ids, TView<const Box> bounds);
+		void Clear();
+
+		bool Has(Id id) const
 		{
-			for (i32 i = 0; i < entities.Size(); ++i)
-			{
-				cb(entities[i]);
-			}
+			return GetLeaf(id) != NO_INDEX;
 		}
-		else
+		i32 Size() const
+		{
+			return numLeaves;
+		}
+		i32 GetHeight() const
+		{
+			return root != NO_INDEX ? nodes[root].height : 0;
+		}
+		float GetMargin() const
+		{
+			return margin;
+		}
+
+		// Finds ids with bounds overlapping bounds
+		void FindOverlapping(const Box& bounds, TArray<Id>& outIds) const;
+		// Finds ids overlapping each of many bounds, in parallel. outIds[i] is for bounds[i].
+		void FindOverlapping(TView<const Box> bounds, TArray<TArray<Id>>& outIds,
+		    WorkerPool& workers = GetDefaultWorkerPool()) const;
+		// Finds ids with bounds closer than radius to center
+		void FindInRadius(const v3& center, float radius, TArray<Id>& outIds) const;
+		// Finds ids with bounds hit by a ray before maxDistance (in lengths of direction)
+		void FindOnRay(
+		    const v3& origin, const v3& direction, float maxDistance, TArray<Id>& outIds) const;
+
+		// Calls callback(id, bounds) for all ids
+		template<typename Callback>
+		void Each(Callback&& callback) const
 		{
-			for (i32 i = 0; i < entities.Size(); ++i)
+			for (i32 i = 0; i < nodes.Size(); ++i)
 			{
-				const Id id = entities[i];
-				if (id.GetIndex() == i)
+				if (nodes[i].height == 0)
 				{
-					cb(id);
+					callback(leafIds[i], leafBounds[i]);
 				}
 			}
 		}
-	}
 
+	private:
+		i32 GetLeaf(Id id) const
+		{
+			const i32* const leaf = leaves.At(id.GetIndex());
+			return leaf && *leaf != NO_INDEX && leafIds[*leaf] == id ? *leaf : NO_INDEX;
+		}
+
+		i32 AllocateNode();
+		void FreeNode(i32 node);
+		void InsertLeaf(i32 leaf);
+		void RemoveLeaf(i32 leaf);
+		// Updates bounds and heights of a node and its parents, rotating unbalanced nodes
+		void Refit(i32 node);
+		i32 Balance(i32 node);
+		// Builds the subtree of leaves sorted by keys, using nodes from nextNode. Returns its node.
+		i32 BuildRange(const u64* keys, i32 first, i32 count, i32 parent, i32& nextNode);
 
-	template<typename T>
-	inline void EntityReader::SerializePool()
+		// Adds the id of leaves passing leafTest, visiting only nodes that pass nodeTest
+		template<typename NodeTest, typename LeafTest>
+		void Find(NodeTest&& nodeTest, LeafTest&& leafTest, TArray<Id>& outIds) const;
+	};
+
+	/**
+	 * Spatial index of the bounds of a component (a Box, or derived from one), kept in sync using
+	 * CMdfd<Component>. The component needs the TF_ECS_ModifyOnEdit flag.
+	 * Can be kept in a context with ctx.SetStatic<TIdSpatialIndex<Component>>().
+	 */
+	template<typename Component>
+	struct TIdSpatialIndex : public IdSpatialIndex
 	{
-		if (EnterNext(GetTypeName<T>(false)))
-		{
-			auto& pool = GetContext().AssurePool<T>();
+		static_assert(Derived<Component, Box>, "Component must be or derive from Box");
 
-			if (serializingMany) [[likely]]
+	private:
+		bool built = false;
+
+
+	public:
+		using IdSpatialIndex::IdSpatialIndex;
+
+		/**
+		 * Applies the bounds of ids marked with CMdfd<Component> since the last update, so it must
+		 * run before CMdfd is cleared. Ids removed without marking them (e.g. by RmId) are found
+		 * by comparing the number of ids. The first update, or one with many changes, rebuilds the
+		 * tree from all components.
+		 */
+		void Update(TIdScopeRef<const Component, const CMdfd<Component>> scope)
+		{
+			const auto* pool     = scope.template GetPool<const Component>();
+			const auto* mdfdPool = scope.template GetPool<const CMdfd<Component>>();
+			const i32 numIds     = pool ? pool->Size() - pool->GetNumRemoved() : 0;
+			const i32 numChanged = mdfdPool ? mdfdPool->Size() : 0;
+			if (!built || numChanged > Max(Size(), numIds) / 4)
 			{
-				String key;
-				BeginObject();
-				for (i32 i = 0; i < ids.Size(); ++i)
-				{
-					const Id id = ids[i];
-					key.clear();
-					Strings::FormatTo(key, "{}", i);
+				Rebuild(pool);
+				return;
+			}
 
-					if (EnterNext(key))
+			if (mdfdPool)
+			{
+				for (Id id : mdfdPool->GetIdList())
+				{
+					if (id.GetVersion() == NoIdVersion)
 					{
-						if constexpr (!IsEmpty<T>)
-						{
-							T& comp = pool.Has(id) ? pool.Get(id) : pool.Add(id);
-							Serialize(comp);
-						}
-						else
-						{
-							pool.Add(id);
-						}
-						Leave();
+						continue;
+					}
+					if (const Component* value = pool ? pool->TryGet(id) : nullptr)
+					{
+						Set(id, *value);
+					}
+					else
+					{
+						Remove(id);
 					}
 				}
 			}
-			else
+
+			if (Size() != numIds)
 			{
-				if constexpr (!IsEmpty<T>)
+				TArray<Id> missing;
+				Each([pool, &missing](Id id, const Box&)
 				{
-					const Id id = ids[0];
-					T& comp     = pool.Has(id) ? pool.Get(id) : pool.Add(id);
-					Serialize(comp);
-				}
-				else
+					if (!pool || !pool->Has(id)
+					    || pool->GetIdFromIndex(pool->GetIndexFromId(id)) != id)
+					{
+						missing.Add(id);
+					}
+				});
+				for (Id id : missing)
 				{
-					pool.Add(ids[0]);
+					Remove(id);
 				}
 			}
-			Leave();
 		}
-	}
 
-	template<typename T>
-	inline void EntityWriter::SerializePool()
-	{
-		TArray<TPair<i32, Id>> typeIds;    // TODO: Make sure this is needed
-
-		auto* pool = context.GetPool<const T>();
-		if (pool)
+	private:
+		void Rebuild(const TPool<Component>* pool)
 		{
-			typeIds.Reserve(Min(i32(pool->Size()), ids.Size()));
-			for (i32 i = 0; i < ids.Size(); ++i)
+			built = true;
+			TArray<Id> ids;
+			TArray<Box> bounds;
+			if (pool)
 			{
-				const Id id = ids[i];
-				if (pool->Has(id))
+				ids.Reserve(pool->Size());
+				bounds.Reserve(pool->Size());
+				for (Id id : pool->GetIdList())
 				{
-					typeIds.Add({i, id});
+					if (id.GetVersion() != NoIdVersion)
+					{
+						ids.Add(id);
+						bounds.Add(pool->Get(id));
+					}
 				}
 			}
+			Build(ids, bounds);
 		}
+	};
+#pragma endregion Spatial
 
-		if (typeIds.IsEmpty())
+
+////////////////////////////////
+// SYSTEMS
+//
+#pragma region Systems
+	/**
+	 * Runs systems (callbacks receiving a scope) using the read and write dependencies of their
+	 * scopes. Systems that don't conflict run in parallel. Two systems conflict if one writes a
+	 * component the other reads or writes. Conflicting systems always run in the order they were
+	 * added. Queries and groups share state between their pools, so writing one of their
+	 * components counts as writing all of them.
+	 * NOTE: Systems must not touch ids or components outside of their scope while running.
+	 */
+	struct P_API SystemScheduler
+	{
+		struct System
 		{
-			return;
-		}
+			TArray<TypeId> reads;     // Sorted
+			TArray<TypeId> writes;    // Sorted
+			// Assures the pools of the scope exist before running in parallel
+			std::function<void(IdContext&)> prepare;
+			std::function<void(IdContext&)> run;
 
-		// FIX: yyjson doesn't seem to take into account stringview length when generating text
-		// Temporarely fixed by caching component name keys
-		PushAddFlags(p::WriteFlags_CacheStringKeys);
-		if (EnterNext(GetTypeName<T>(false)))
+			// Systems added later that conflict with this one
+			TArray<i32> dependents;
+			i32 numDependencies = 0;
+		};
+
+	private:
+		TArray<System> systems;
+
+
+	public:
+		template<typename Scope, typename Callback>
+		i32 Add(Callback&& callback)
 		{
-			if (serializingMany) [[likely]]
+			System system;
+			Scope::RDependencies::Call([&system]<typename... T>()
 			{
-				String key;
-				BeginObject();
-				for (auto id : typeIds)
-				{
-					key.clear();
-					Strings::FormatTo(key, "{}", id.first);
+				(system.reads.Add(GetTypeId<T>()), ...);
+			});
+			Scope::WDependencies::Call([&system]<typename... T>()
+			{
+				(system.writes.Add(GetTypeId<T>()), ...);
+			});
+			system.prepare = [](IdContext& ctx)
+			{
+				Scope{ctx};
+			};
+			system.run = [callback = p::Fwd<Callback>(callback)](IdContext& ctx) mutable
+			{
+				Scope scope{ctx};
+				callback(scope);
+			};
+			return AddSystem(Move(system));
+		}
 
-					if constexpr (std::is_empty_v<T>)
+		// Runs all systems and waits for them to finish
+		void Run(IdContext& ctx, WorkerPool& workers = GetDefaultWorkerPool());
+
+		void Clear()
+		{
+			systems.Clear();
+		}
+
+		i32 Size() const
+		{
+			return systems.Size();
+		}
+
+		const TArray<System>& GetSystems() const
+		{
+			return systems;
+		}
+
+		static bool Conflict(const System& a, const System& b);
+
+	private:
+		i32 AddSystem(System&& system);
+	};
+
+
+	/**
+	 * Calls callback(id, component) for each id in the pool of a component, from multiple threads.
+	 * Work is split by pages of the pool. Component must be const to only read it.
+	 * Empty components call callback(id).
+	 */
+	template<typename Component, typename Scope, typename Callback>
+	void EachParallel(
+	    const Scope& scope, Callback&& callback, WorkerPool& workers = GetDefaultWorkerPool())
+	{
+		auto* pool = scope.template GetPool<Component>();
+		if (!pool)
+		{
+			return;
+		}
+
+		const u32 tick = scope.GetContext().GetChangeTick();
+		workers.ParallelFor(pool->GetNumPages(), [pool, tick, &callback](i32 page)
+		{
+			if constexpr (IsMutable<Component> && TracksChanges<Component>)
+			{
+				pool->MarkPageChanged(page, tick);
+			}
+			const TView<const Id> ids = pool->GetPageIds(page);
+			if constexpr (p::IsEmpty<Component>)
+			{
+				for (Id id : ids)
+				{
+					if (!IsNone(id))
+					{
+						callback(id);
+					}
+				}
+			}
+			else
+			{
+				auto* const values = pool->GetPageData(page);
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					if (!IsNone(ids[i]))
+					{
+						callback(ids[i], values[i]);
+					}
+				}
+			}
+		});
+	}
+
+	/**
+	 * Calls callback(ids, components) for each page of the pool of a component, from multiple
+	 * threads. Removed ids inside a page are NoIdVersion (see IsNone) and their component must not
+	 * be accessed.
+	 */
+	template<typename Component, typename Scope, typename Callback>
+	void EachPageParallel(const Scope& scope, Callback&& callback,
+	    WorkerPool& workers = GetDefaultWorkerPool()) requires(!p::IsEmpty<Component>)
+	{
+		auto* pool = scope.template GetPool<Component>();
+		if (!pool)
+		{
+			return;
+		}
+
+		const u32 tick = scope.GetContext().GetChangeTick();
+		workers.ParallelFor(pool->GetNumPages(), [pool, tick, &callback](i32 page)
+		{
+			if constexpr (IsMutable<Component> && TracksChanges<Component>)
+			{
+				pool->MarkPageChanged(page, tick);
+			}
+			const TView<const Id> ids = pool->GetPageIds(page);
+			callback(ids, TView<Component>{pool->GetPageData(page), ids.Size()});
+		});
+	}
+
+	/**
+	 * Calls callback(id, component) for each id of a list containing a component, from multiple
+	 * threads. Ids without the component are skipped. The list is split in batches of one page.
+	 */
+	template<typename Component, typename Scope, typename Callback>
+	void EachParallel(const Scope& scope, TView<const Id> ids, Callback&& callback,
+	    WorkerPool& workers = GetDefaultWorkerPool())
+	{
+		auto* pool = scope.template GetPool<Component>();
+		if (!pool)
+		{
+			return;
+		}
+
+		constexpr i32 batchSize = TPool<Mut<Component>>::pageSize;
+		const i32 numBatches    = (ids.Size() + batchSize - 1) / batchSize;
+		const u32 tick          = scope.GetContext().GetChangeTick();
+		workers.ParallelFor(numBatches, [pool, ids, tick, &callback](i32 batch)
+		{
+			const i32 last = Min((batch + 1) * batchSize, ids.Size());
+			for (i32 i = batch * batchSize; i < last; ++i)
+			{
+				const Id id = ids[i];
+				if (!pool->Has(id))
+				{
+					continue;
+				}
+				if constexpr (IsMutable<Component> && TracksChanges<Component>)
+				{
+					pool->MarkChanged(id, tick);
+				}
+				if constexpr (p::IsEmpty<Component>)
+				{
+					callback(id);
+				}
+				else
+				{
+					callback(id, pool->Get(id));
+				}
+			}
+		});
+	}
+
+	/**
+	 * Calls callback(parentValue, childValue) for each child with a component whose parent also
+	 * has it, parents always before their children. The hierarchy is processed one level at a time
+	 * and each level is split in batches between threads, so a callback may only write childValue.
+	 * Uses the hierarchy index if enabled (see IdHierarchyIndex), or builds a temporary one.
+	 */
+	template<typename Component, typename Scope, typename Callback>
+	void PropagateIdHierarchy(const Scope& scope, Callback&& callback,
+	    WorkerPool& workers = GetDefaultWorkerPool()) requires(!p::IsEmpty<Component>)
+	{
+		auto* pool = scope.template GetPool<Component>();
+		if (!pool)
+		{
+			return;
+		}
+
+		const TIdScope<CParent> hierarchy = [&scope]() -> TIdScope<CParent>
+		{
+			if constexpr (IsSame<Scope, IdContext>)
+			{
+				return {scope.GetContext()};
+			}
+			else
+			{
+				return {scope};
+			}
+		}();
+		const IdHierarchyIndex* index = GetIdHierarchyIndex(hierarchy);
+		IdHierarchyIndex localIndex;    // Empty unless the context has no index
+		if (!index)
+		{
+			localIndex.Update(hierarchy);
+			index = &localIndex;
+		}
+
+		constexpr i32 batchSize = TPool<Mut<Component>>::pageSize;
+		const TView<const Id> ids = index->GetIds();
+		const TView<const i32> parents = index->GetParentPositions();
+		pool->PrepareParallelWrites();
+
+		// Resolve each component once instead of once as parent and once per child. Reads go
+		// through the const pool, so only children written below are marked as written.
+		const auto* const constPool = pool;
+		TArray<const Component*> values;
+		values.Resize(ids.Size());
+		workers.ParallelFor((ids.Size() + batchSize - 1) / batchSize,
+		    [constPool, ids, &values](i32 batch)
+		{
+			const i32 last = Min((batch + 1) * batchSize, ids.Size());
+			for (i32 i = batch * batchSize; i < last; ++i)
+			{
+				values[i] = constPool->TryGet(ids[i]);
+			}
+		});
+
+		for (i32 level = 1; level < index->GetNumLevels(); ++level)
+		{
+			const TView<const i32> positions = index->GetLevelPositions(level);
+			workers.ParallelFor((positions.Size() + batchSize - 1) / batchSize,
+			    [&scope, pool, ids, parents, positions, &values, &callback](i32 batch)
+			{
+				const i32 last = Min((batch + 1) * batchSize, positions.Size());
+				for (i32 i = batch * batchSize; i < last; ++i)
+				{
+					const i32 position            = positions[i];
+					const Component* const parent = values[parents[position]];
+					if (values[position] && parent)
+					{
+						callback(*parent, pool->Get(ids[position]));
+						scope.template MarkChanged<Component>(ids[position], *pool);
+					}
+				}
+			});
+		}
+	}
+
+
+	/**
+	 * Records structural changes (ids and components) to apply them later at a sync point,
+	 * for example after running systems in parallel.
+	 * Recording doesn't touch pools, so each thread can record into its own buffer without locks
+	 * (see IdCommandBuffers).
+	 * Ids are created instantly by AddId from indices reserved in blocks, so later commands can
+	 * use them. Everything else is applied by Apply() in one sorted pass per pool.
+	 */
+	struct P_API IdCommandBuffer
+	{
+		// Commands of a single pool
+		struct PoolCommands
+		{
+			struct Command
+			{
+				Id id;
+				i32 order;         // Position when recorded. Breaks ties between commands on an id.
+				i32 valueIndex;    // NO_INDEX removes the component
+			};
+
+			TypeId typeId;
+			TArray<Command> commands;
+
+
+			PoolCommands(TypeId typeId) : typeId{typeId} {}
+			virtual ~PoolCommands() = default;
+
+			// Applies and clears all commands. Only the last command of each id is applied.
+			virtual void Apply(IdContext& ctx) = 0;
+			// Moves the commands of other (same type) after the ones of this buffer
+			virtual void Append(PoolCommands& other) = 0;
+			virtual void Clear() = 0;
+
+		protected:
+			// Sorts commands by id, keeping only the last one of each id
+			void SortAndCollapse();
+		};
+
+		template<typename T>
+		struct TPoolCommands : public PoolCommands
+		{
+			TArray<T> values;
+
+
+			TPoolCommands() : PoolCommands(GetTypeId<T>()) {}
+
+			void Apply(IdContext& ctx) override;
+			void Append(PoolCommands& other) override;
+			void Clear() override
+			{
+				commands.Clear(Shrink::No);
+				values.Clear(Shrink::No);
+			}
+		};
+
+		struct RmIdCommand
+		{
+			Id id;
+			RmIdFlags flags;
+		};
+
+	private:
+		IdContext* context = nullptr;
+		TArray<TUniquePtr<PoolCommands>> pools;
+		TArray<RmIdCommand> rmIds;
+		IdRegistry::Reservation reservation;
+
+
+	public:
+		IdCommandBuffer(IdContext& ctx) : context{&ctx}, reservation{ctx.GetIdRegistry()} {}
+
+		// Creates an id instantly
+		Id AddId()
+		{
+			return reservation.Create();
+		}
+		void AddId(TView<Id> ids)
+		{
+			reservation.Create(ids);
+		}
+
+		void RmId(Id id, RmIdFlags flags = RmIdFlags::None)
+		{
+			rmIds.Add({id, flags});
+		}
+		void RmId(TView<const Id> ids, RmIdFlags flags = RmIdFlags::None)
+		{
+			rmIds.Reserve(rmIds.Size() + ids.Size());
+			for (Id id : ids)
+			{
+				rmIds.Add({id, flags});
+			}
+		}
+
+		// Lvalues bind to the const T& overload below
+		template<typename T>
+		void Add(Id id, T&& value = {}) requires(!IsLValueRef<T> && IsMutable<T>)
+		{
+			auto& commands = AssurePoolCommands<T>();
+			i32 valueIndex = 0;
+			if constexpr (!p::IsEmpty<T>)
+			{
+				valueIndex = commands.values.Add(Move(value));
+			}
+			commands.commands.Add({id, commands.commands.Size(), valueIndex});
+		}
+		template<typename T>
+		void Add(Id id, const T& value) requires(IsMutable<T>)
+		{
+			auto& commands = AssurePoolCommands<T>();
+			i32 valueIndex = 0;
+			if constexpr (!p::IsEmpty<T>)
+			{
+				valueIndex = commands.values.Add(value);
+			}
+			commands.commands.Add({id, commands.commands.Size(), valueIndex});
+		}
+
+		template<typename T>
+		void Remove(Id id)
+		{
+			auto& commands = AssurePoolCommands<T>();
+			commands.commands.Add({id, commands.commands.Size(), NO_INDEX});
+		}
+		template<typename T>
+		void Remove(TView<const Id> ids)
+		{
+			auto& commands = AssurePoolCommands<T>();
+			commands.commands.Reserve(commands.commands.Size() + ids.Size());
+			for (Id id : ids)
+			{
+				commands.commands.Add({id, commands.commands.Size(), NO_INDEX});
+			}
+		}
+
+		/**
+		 * Applies all recorded commands to the context and clears them.
+		 * Component commands are applied first, each pool at once. Ids are removed last.
+		 */
+		void Apply();
+
+		// Applies the commands of many buffers touching each pool only once
+		static void Apply(TView<IdCommandBuffer* const> buffers);
+
+		void Clear();
+		bool IsEmpty() const;
+
+		IdContext& GetContext() const
+		{
+			return *context;
+		}
+
+	private:
+		template<typename T>
+		TPoolCommands<Mut<T>>& AssurePoolCommands();
+
+		// Moves the commands of other after the ones of this buffer
+		void Append(IdCommandBuffer& other);
+	};
+
+
+	/**
+	 * One IdCommandBuffer per thread recording on the same context.
+	 * Get() returns the buffer of the calling thread, creating it the first time.
+	 * Apply() must not run while other threads record.
+	 */
+	struct P_API IdCommandBuffers
+	{
+	private:
+		IdContext* context = nullptr;
+		// Unique between instances. Identifies this owner on thread-local caches.
+		u64 uniqueId = 0;
+		std::mutex buffersMutex;
+		TArray<std::thread::id> threadIds;
+		TArray<TUniquePtr<IdCommandBuffer>> buffers;
+
+
+	public:
+		IdCommandBuffers(IdContext& ctx);
+		IdCommandBuffers(const IdCommandBuffers&)            = delete;
+		IdCommandBuffers& operator=(const IdCommandBuffers&) = delete;
+
+		// Buffer of the calling thread
+		IdCommandBuffer& Get();
+
+		// Applies the commands of all threads, touching each pool once
+		void Apply();
+
+		void Clear();
+		bool IsEmpty() const;
+	};
+#pragma endregion Systems
+
+
+////////////////////////////////
+// DEFINITIONS
+//
+#pragma region Definitions
+
+	template<typename Callback>
+	void IdRegistry::Each(Callback cb) const
+	{
+		const u32 size = numIndices.load(std::memory_order_acquire);
+		if (available.IsEmpty() && deferredRemovals.IsEmpty()
+		    && numReserved.load(std::memory_order_relaxed) == 0)
+		{
+			for (u32 i = 0; i < size; ++i)
+			{
+				cb(Id::MakeRaw(GetSlot(i)->load(std::memory_order_relaxed)));
+			}
+		}
+		else
+		{
+			for (u32 i = 0; i < size; ++i)
+			{
+				const Id id = Id::MakeRaw(GetSlot(i)->load(std::memory_order_relaxed));
+				if (id.GetIndex() == i)
+				{
+					cb(id);
+				}
+			}
+		}
+	}
+
+
+	template<typename T>
+	inline void EntityReader::SerializePool()
+	{
+		if (serializingMany && GetFormat().IsBinary())
+		{
+			SerializeBinaryPool<T>();
+			return;
+		}
+
+		if (EnterNext(GetTypeName<T>(false)))
+		{
+			auto& pool = GetContext().AssurePool<T>();
+
+			if (serializingMany) [[likely]]
+			{
+				String key;
+				BeginObject();
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					const Id id = ids[i];
+					key.clear();
+					Strings::FormatTo(key, "{}", i);
+
+					if (EnterNext(key))
+					{
+						if constexpr (!IsEmpty<T>)
+						{
+							T& comp = pool.Has(id) ? pool.Get(id) : pool.Add(id);
+							Serialize(comp);
+						}
+						else
+						{
+							pool.Add(id);
+						}
+						Leave();
+					}
+				}
+			}
+			else
+			{
+				if constexpr (!IsEmpty<T>)
+				{
+					const Id id = ids[0];
+					T& comp     = pool.Has(id) ? pool.Get(id) : pool.Add(id);
+					Serialize(comp);
+				}
+				else
+				{
+					pool.Add(ids[0]);
+				}
+			}
+			Leave();
+		}
+	}
+
+	template<typename T>
+	inline void EntityReader::SerializeBinaryPool()
+	{
+		auto& format = static_cast<BinaryFormatReader&>(GetFormat());
+		u32 count    = 0;
+		format.Read(count);
+		const u8* indices = count > 0 ? format.ReadBytes(count * sizeof(i32)) : nullptr;
+		if (!indices)
+		{
+			return;
+		}
+
+		TArray<Id> poolIds;
+		poolIds.AddUninitialized(i32(count));
+		for (u32 i = 0; i < count; ++i)
+		{
+			i32 index;
+			CopyMem(&index, indices + i * sizeof(i32), sizeof(i32));
+			if (!P_EnsureMsg(index >= 0 && index < ids.Size(), "Invalid id index in a pool"))
+			{
+				return;
+			}
+			poolIds[i] = ids[index];
+		}
+
+		auto& pool = GetContext().AssurePool<T>();
+		if constexpr (IsEmpty<T>)
+		{
+			pool.Add(poolIds.begin(), poolIds.end());
+		}
+		else if constexpr (TriviallySerialized<T>)
+		{
+			const u8* bytes = format.ReadBytes(count * sizeof(T));
+			if (bytes)
+			{
+				TArray<T> values;
+				values.AddUninitialized(i32(count));
+				CopyMem(values.Data(), bytes, count * sizeof(T));
+				pool.Add(poolIds.begin(), poolIds.end(), values.begin());
+			}
+		}
+		else if constexpr (IsCopyConstructible<T> && IsDefaultConstructible<T>)
+		{
+			TArray<T> values;
+			values.Resize(i32(count));
+			for (T& value : values)
+			{
+				Serialize(value);
+			}
+			pool.Add(poolIds.begin(), poolIds.end(), values.begin());
+		}
+		else
+		{
+			for (Id id : poolIds)
+			{
+				Serialize(pool.Has(id) ? pool.Get(id) : pool.Add(id));
+			}
+		}
+	}
+
+	template<typename T>
+	inline void EntityWriter::SerializePool()
+	{
+		if (serializingMany && GetFormat().IsBinary())
+		{
+			SerializeBinaryPool<T>();
+			return;
+		}
+
+		TArray<TPair<i32, Id>> typeIds;    // TODO: Make sure this is needed
+
+		auto* pool = context.GetPool<const T>();
+		if (pool)
+		{
+			const i32 first = serializingMany ? chunkBegin : 0;
+			const i32 last  = serializingMany ? chunkEnd : ids.Size();
+			typeIds.Reserve(Min(i32(pool->Size()), last - first));
+			for (i32 i = first; i < last; ++i)
+			{
+				const Id id = ids[i];
+				if (pool->Has(id))
+				{
+					typeIds.Add({i, id});
+				}
+			}
+		}
+
+		if (typeIds.IsEmpty())
+		{
+			return;
+		}
+
+		// FIX: yyjson doesn't seem to take into account stringview length when generating text
+		// Temporarely fixed by caching component name keys
+		PushAddFlags(p::WriteFlags_CacheStringKeys);
+		if (EnterNext(GetTypeName<T>(false)))
+		{
+			if (serializingMany) [[likely]]
+			{
+				String key;
+				BeginObject();
+				for (auto id : typeIds)
+				{
+					key.clear();
+					Strings::FormatTo(key, "{}", id.first);
+
+					if constexpr (std::is_empty_v<T>)
 					{
 						Next(StringView{key}, T{});
 					}
@@ -2609,6 +4662,51 @@ namespace p
 		PopFlags();
 	}
 
+	// Binary formats write each pool as an array of id indices followed by its components.
+	// Pools are not named, so empty ones are written too.
+	template<typename T>
+	inline void EntityWriter::SerializeBinaryPool()
+	{
+		TArray<i32> indices;
+		auto* pool = context.GetPool<const T>();
+		if (pool)
+		{
+			indices.Reserve(Min(i32(pool->Size()), chunkEnd - chunkBegin));
+			for (i32 i = chunkBegin; i < chunkEnd; ++i)
+			{
+				if (pool->Has(ids[i]))
+				{
+					indices.Add(i);
+				}
+			}
+		}
+
+		auto& format = static_cast<BinaryFormatWriter&>(GetFormat());
+		format.Write(u32(indices.Size()));
+		if (indices.IsEmpty())
+		{
+			return;
+		}
+		CopyMem(format.WriteBytes(indices.Size() * sizeof(i32)), indices.Data(),
+		    indices.Size() * sizeof(i32));
+		if constexpr (TriviallySerialized<T>)
+		{
+			u8* bytes = format.WriteBytes(indices.Size() * sizeof(T));
+			for (i32 index : indices)
+			{
+				CopyMem(bytes, &pool->Get(ids[index]), sizeof(T));
+				bytes += sizeof(T);
+			}
+		}
+		else if constexpr (!IsEmpty<T>)
+		{
+			for (i32 index : indices)
+			{
+				Serialize(pool->Get(ids[index]));
+			}
+		}
+	}
+
 
 	template<typename T>
 	inline TPool<Mut<T>>& IdContext::AssurePool() const
@@ -2632,6 +4730,41 @@ namespace p
 		return *static_cast<TPool<Mut<T>>*>(pool);
 	}
 
+	template<typename... Component>
+	inline IdQuery& IdContext::AssureQuery() const requires(sizeof...(Component) >= 1)
+	{
+		TypeId typeIds[]{RegisterTypeId<Mut<Component>>()...};
+		p::Sort(typeIds, i32(sizeof...(Component)), TLess<TypeId>());
+		if (IdQuery* query = FindQuery(typeIds))
+		{
+			return *query;
+		}
+
+		ComponentPool* queryPools[]{&AssurePool<Component>()...};
+		const i32 index = queries.Add(MakeUnique<IdQuery>(TView<ComponentPool* const>{queryPools}));
+		return *queries[index].Get();
+	}
+
+	template<typename... Component>
+	inline IdGroup& IdContext::AssureGroup() const requires(sizeof...(Component) >= 1)
+	{
+		TypeId typeIds[]{RegisterTypeId<Mut<Component>>()...};
+		p::Sort(typeIds, i32(sizeof...(Component)), TLess<TypeId>());
+		if (IdGroup* group = FindGroup(typeIds))
+		{
+			return *group;
+		}
+
+		ComponentPool* groupPools[]{&AssurePool<Component>()...};
+		for (const ComponentPool* pool : groupPools)
+		{
+			P_CheckMsg(!pool->GetGroup(), "A pool can only be owned by one group");
+		}
+		const i32 index =
+		    groups.Add(MakeUnique<IdGroup>(*this, TView<ComponentPool* const>{groupPools}));
+		return *groups[index].Get();
+	}
+
 	template<typename T>
 	inline PoolInstance IdContext::CreatePoolInstance() const
 	{
@@ -2701,6 +4834,158 @@ namespace p
 		}
 		return *ptr.GetUnsafe<Static>();
 	}
+
+	template<typename... Component, typename Callback>
+	inline void IdGroup::Each(Callback&& callback) requires((!p::IsEmpty<Component> && ...))
+	{
+		EachPage<Component...>([&callback](TView<const Id> ids, Component*... components)
+		{
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				callback(ids[i], components[i]...);
+			}
+		});
+	}
+
+	template<typename... Component, typename Callback>
+	inline void IdGroup::EachPage(Callback&& callback) requires((!p::IsEmpty<Component> && ...))
+	{
+		const TView<const Id> ids = GetIds();
+		const std::tuple<TPool<Mut<Component>>*...> componentPools{GetPool<Component>()...};
+		constexpr i32 pageSize = ComponentPool::pageSize;
+		const u32 tick         = context->GetChangeTick();
+		for (i32 page = 0, first = 0; first < size; ++page, first += pageSize)
+		{
+			const TView<const Id> pageIds{ids.Data() + first, Min(pageSize, size - first)};
+			(MarkPageChanged<Component>(
+			     std::get<TPool<Mut<Component>>*>(componentPools), page, tick, pageIds.Size()),
+			    ...);
+			callback(pageIds, std::get<TPool<Mut<Component>>*>(componentPools)->GetPageData(page)...);
+		}
+	}
+
+	template<typename Component>
+	inline TPool<Mut<Component>>* IdGroup::GetPool() const
+	{
+		constexpr TypeId typeId = GetTypeId<Mut<Component>>();
+		for (ComponentPool* pool : pools)
+		{
+			if (pool->GetTypeId() == typeId)
+			{
+				return static_cast<TPool<Mut<Component>>*>(pool);
+			}
+		}
+		P_CheckMsg(false, "Component is not part of the group");
+		return nullptr;
+	}
+
+	template<typename T>
+	inline void IdCommandBuffer::TPoolCommands<T>::Apply(IdContext& ctx)
+	{
+		if (commands.IsEmpty())
+		{
+			return;
+		}
+		SortAndCollapse();
+
+		const IdRegistry& registry = ctx.GetIdRegistry();
+		TArray<Id> removedIds;
+		TArray<Id> addedIds;
+		i32 numAdded = 0;
+		for (const Command& command : commands)
+		{
+			if (!registry.IsValid(command.id))
+			{
+				continue;
+			}
+			if (command.valueIndex == NO_INDEX)
+			{
+				removedIds.Add(command.id);
+			}
+			else
+			{
+				// Valid adds are moved to the front
+				commands[numAdded++] = command;
+				addedIds.Add(command.id);
+			}
+		}
+
+		ctx.template Remove<T>(removedIds);
+
+		if (!addedIds.IsEmpty())
+		{
+			auto& pool = ctx.AssurePool<T>();
+			if constexpr (HasAnyTypeStaticFlags<T>(TF_ECS_ModifyOnAdd))
+			{
+				ctx.template Modify<T>(addedIds, &pool);
+			}
+			if constexpr (p::IsEmpty<T>)
+			{
+				pool.Add(addedIds.begin(), addedIds.end());
+			}
+			else if constexpr (IsCopyConstructible<T>)
+			{
+				// Values are gathered in id order to insert all of them in one call
+				TArray<T> addedValues;
+				addedValues.Reserve(numAdded);
+				for (i32 i = 0; i < numAdded; ++i)
+				{
+					addedValues.Add(Move(values[commands[i].valueIndex]));
+				}
+				pool.Add(addedIds.begin(), addedIds.end(), addedValues.begin());
+			}
+			else
+			{
+				for (i32 i = 0; i < numAdded; ++i)
+				{
+					pool.Add(commands[i].id, Move(values[commands[i].valueIndex]));
+				}
+			}
+			ctx.template MarkChanged<T>(addedIds, pool);
+		}
+		Clear();
+	}
+
+	template<typename T>
+	inline void IdCommandBuffer::TPoolCommands<T>::Append(PoolCommands& other)
+	{
+		P_Check(other.typeId == typeId);
+		auto& otherCommands = static_cast<TPoolCommands<T>&>(other);
+		const i32 orderOffset = commands.Size();
+		const i32 valueOffset = values.Size();
+		commands.Reserve(commands.Size() + otherCommands.commands.Size());
+		for (const Command& command : otherCommands.commands)
+		{
+			const i32 valueIndex = (command.valueIndex == NO_INDEX || p::IsEmpty<T>)
+			                         ? command.valueIndex
+			                         : command.valueIndex + valueOffset;
+			commands.Add({command.id, command.order + orderOffset, valueIndex});
+		}
+		if constexpr (!p::IsEmpty<T>)
+		{
+			values.Reserve(values.Size() + otherCommands.values.Size());
+			for (T& value : otherCommands.values)
+			{
+				values.Add(Move(value));
+			}
+		}
+		otherCommands.Clear();
+	}
+
+	template<typename T>
+	inline IdCommandBuffer::TPoolCommands<Mut<T>>& IdCommandBuffer::AssurePoolCommands()
+	{
+		constexpr TypeId typeId = GetTypeId<Mut<T>>();
+		for (auto& commands : pools)
+		{
+			if (commands->typeId == typeId)
+			{
+				return *static_cast<TPoolCommands<Mut<T>>*>(commands.Get());
+			}
+		}
+		const i32 index = pools.Add(MakeUnique<TPoolCommands<Mut<T>>>());
+		return *static_cast<TPoolCommands<Mut<T>>*>(pools[index].Get());
+	}
 #pragma endregion Definitions
 }    // namespace p
 
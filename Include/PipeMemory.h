@@ -309,12 +309,37 @@ namespace p
 	P_API void* HeapRealloc(void* ptr, sizet size);
 	P_API void HeapFree(void* ptr);
 
+	// Native virtual memory functions. Reserved memory can't be used until it is committed.
+	P_API sizet GetVirtualPageSize();
+	P_API void* ReserveVirtualMem(sizet size, sizet align = 0);
+	// Huge pages are hinted where supported (transparent huge pages on linux)
+	P_API bool CommitVirtualMem(void* ptr, sizet size, bool hugePages = false);
+	// Returns physical memory of committed pages, keeping them reserved
+	P_API void DecommitVirtualMem(void* ptr, sizet size);
+	P_API void FreeVirtualMem(void* ptr, sizet size);
+
 
 	P_API HeapArena& GetHeapArena();
+	// Current arenas are per thread. Each thread starts using the heap arena
 	P_API Arena& GetCurrentArena();
 	P_API void PushCurrentArena(Arena& arena);
 	P_API void PopCurrentArena();
 
+	// Makes an arena current on this thread while in scope
+	struct CurrentArenaScope
+	{
+		CurrentArenaScope(Arena& arena)
+		{
+			PushCurrentArena(arena);
+		}
+		~CurrentArenaScope()
+		{
+			PopCurrentArena();
+		}
+		CurrentArenaScope(const CurrentArenaScope&)            = delete;
+		CurrentArenaScope& operator=(const CurrentArenaScope&) = delete;
+	};
+
 	// Arena allocation functions (Find current arena)
 	P_API void* Alloc(sizet size);
 	P_API void* Alloc(sizet size, sizet align);
@@ -375,7 +400,7 @@ namespace p
 			return static_cast<u8*>(data) + size;
 		}
 
-		bool Contains(void* ptr) const
+		bool Contains(const void* ptr) const
 		{
 			return data <= ptr && static_cast<u8*>(data) + size > ptr;
 		}
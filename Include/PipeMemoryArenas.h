@@ -6,6 +6,8 @@
 #include "PipeMemory.h"
 #include "PipeReflect.h"
 
+#include <bit>
+
 
 namespace p
 {
@@ -49,11 +51,23 @@ namespace p
 #pragma endregion Dummy Arena
 
 #pragma region Heap Arena
+	/**
+	 * HeapArena allocates from the heap (malloc).
+	 * Small allocations are served from free lists of each thread, by size class. Each thread
+	 * refills them in batches from central lists, and frees from any thread go to the lists of
+	 * that thread, returning to the central lists without locks when there are too many.
+	 * Cached memory is reused, and only returned to the heap by Trim().
+	 */
 	struct P_API HeapArena : public Arena
 	{
 		using Super = Arena;
 		P_STRUCT(HeapArena)
 
+		// Allocations up to this size are cached
+		static constexpr sizet maxCachedSize = 2048;
+		// Alignment of all cached blocks. Blocks aligned more are allocated to fit their class
+		static constexpr sizet maxCachedAlign = 16;
+
 	private:
 		MemoryStats stats;
 
@@ -65,6 +79,14 @@ namespace p
 		bool Realloc(void* ptr, const sizet ptrSize, const sizet size);
 		void Free(void* ptr, sizet size);
 
+		/**
+		 * Returns cached memory to the heap: blocks cached by this thread and blocks freed to the
+		 * central lists, if all blocks of their span are free. Blocks cached by other threads
+		 * are kept. Shared by all heap arenas.
+		 * @return bytes returned to the heap
+		 */
+		static sizet Trim();
+
 		const MemoryStats* GetStats() const override
 		{
 			return &stats;
@@ -159,6 +181,121 @@ namespace p
 	};
 #pragma endregion Mono Linear
 
+#pragma region Virtual Linear
+	/**
+	 * VirtualLinearArena reserves a big range of virtual memory and allocates linearly on it.
+	 * Pages are committed as allocations advance and decommitted on Release, so memory stays
+	 * contiguous and pointers stable, without chaining blocks.
+	 * Individual allocations can't be freed.
+	 */
+	struct P_API VirtualLinearArena : public Arena
+	{
+		using Super = Arena;
+		P_STRUCT(VirtualLinearArena)
+
+		// Size of huge pages. Commits are aligned to it when huge pages are used
+		static constexpr sizet hugePageSize = 2 * Memory::MB;
+
+	private:
+		MemoryStats stats;
+
+	protected:
+		u8* data           = nullptr;
+		u8* insert         = nullptr;
+		u8* committedEnd   = nullptr;
+		sizet reservedSize = 0;
+		// Memory is committed in multiples of this size
+		sizet commitSize = 0;
+		sizet count      = 0;
+		bool hugePages   = false;
+
+
+	public:
+		VirtualLinearArena(sizet reserveSize = 64 * Memory::GB, bool useHugePages = false,
+		    sizet minCommitSize = 64 * Memory::KB);
+		~VirtualLinearArena();
+
+		void* Alloc(sizet size)
+		{
+			return Alloc(size, alignof(std::max_align_t));
+		}
+		void* Alloc(sizet size, sizet align)
+		{
+			u8* const ptr = insert + GetAlignmentPadding(insert, align);
+			if (ptr + size > committedEnd) [[unlikely]]
+			{
+				if (!Commit(ptr + size))
+				{
+					return nullptr;
+				}
+			}
+			insert = ptr + size;
+			++count;
+			stats.Add(ptr, size);
+			return ptr;
+		}
+		bool Realloc(void* ptr, sizet ptrSize, sizet size)
+		{
+			return false;
+		}
+		void Free(void* ptr, sizet size)
+		{
+			stats.Remove(ptr, size);
+			if (count > 0 && --count == 0)
+			{
+				// All allocations were freed. Committed memory is kept for reuse
+				insert = data;
+			}
+		}
+
+		// Frees all allocations. Decommitted memory returns to the OS but remains reserved
+		void Release(bool decommit = true);
+
+		bool IsValid() const
+		{
+			return data != nullptr;
+		}
+		sizet GetUsedSize() const
+		{
+			return sizet(insert - data);
+		}
+		sizet GetCommittedSize() const
+		{
+			return sizet(committedEnd - data);
+		}
+		sizet GetReservedSize() const
+		{
+			return reservedSize;
+		}
+
+		sizet GetAvailableMemory() const override
+		{
+			return reservedSize - GetUsedSize();
+		}
+		void GetBlocks(TArray<ArenaBlock>& outBlocks) const override
+		{
+			if (committedEnd > data)
+			{
+				outBlocks.Add(ArenaBlock{data, GetCommittedSize()});
+			}
+		}
+
+		const MemoryStats* GetStats() const override
+		{
+			return &stats;
+		}
+
+	private:
+		bool Commit(u8* end);
+
+	protected:
+		TypeId ProvideTypeId() const override
+		{
+			return p::GetTypeId<VirtualLinearArena>();
+		}
+	};
+#pragma endregion Virtual Linear
+
 #pragma region Multi Linear
 	namespace Details
 	{
@@ -296,6 +433,254 @@ namespace p
 	};
 #pragma endregion Multi Linear
 
+#pragma region Pool Arena
+	namespace Details
+	{
+		struct P_API PoolSlot
+		{
+			PoolSlot* next;
+		};
+
+		struct P_API PoolPage
+		{
+			PoolPage* next;
+		};
+
+		// Intrusive free list of slots of one size, carved from pages of the parent arena
+		struct P_API PoolBucket
+		{
+			sizet slotSize     = 0;
+			sizet slotAlign    = 0;
+			sizet pageSize     = 0;
+			PoolSlot* freeSlot = nullptr;
+			u8* insert         = nullptr;    // Next slot never used of the last page
+			u8* pageEnd        = nullptr;
+			PoolPage* lastPage = nullptr;
+
+
+			void Init(sizet size, sizet align, sizet minPageSize);
+
+			void* Alloc(Arena& parentArena)
+			{
+				if (PoolSlot* const slot = freeSlot) [[likely]]
+				{
+					freeSlot = slot->next;
+					return slot;
+				}
+				if (insert + slotSize <= pageEnd) [[likely]]
+				{
+					void* const ptr = insert;
+					insert += slotSize;
+					return ptr;
+				}
+				return AllocFromNewPage(parentArena);
+			}
+			void Free(void* ptr)
+			{
+				auto* const slot = static_cast<PoolSlot*>(ptr);
+				slot->next       = freeSlot;
+				freeSlot         = slot;
+			}
+
+			void Release(Arena& parentArena);
+
+			void GetBlocks(TArray<ArenaBlock>& outBlocks) const
+			{
+				for (PoolPage* page = lastPage; page != nullptr; page = page->next)
+				{
+					outBlocks.Add(ArenaBlock{page, pageSize});
+				}
+			}
+
+		private:
+			void* AllocFromNewPage(Arena& parentArena);
+		};
+	}    // namespace Details
+
+	/**
+	 * PoolArena allocates blocks of a single size in O(1).
+	 * Freed blocks are kept in a free list and reused. Pages are allocated from the parent arena
+	 * as needed, and only returned on Release.
+	 * Bigger allocations are forwarded to the parent arena.
+	 */
+	struct P_API PoolArena : public ChildArena
+	{
+		using Super = ChildArena;
+		P_STRUCT(PoolArena)
+
+	private:
+		MemoryStats stats;
+
+	protected:
+		Details::PoolBucket bucket;
+
+
+	public:
+		PoolArena(sizet slotSize, sizet slotAlign = alignof(std::max_align_t),
+		    sizet pageSize = 16 * Memory::KB, Arena& parentArena = GetCurrentArena());
+		~PoolArena()
+		{
+			Release();
+		}
+
+		void* Alloc(sizet size)
+		{
+			void* const ptr = size <= bucket.slotSize ? bucket.Alloc(GetParentArena())
+			                                          : GetParentArena().Alloc(size);
+			stats.Add(ptr, size);
+			return ptr;
+		}
+		void* Alloc(sizet size, sizet align);
+		bool Realloc(void* ptr, sizet ptrSize, sizet size)
+		{
+			return false;
+		}
+		void Free(void* ptr, sizet size)
+		{
+			stats.Remove(ptr, size);
+			if (size <= bucket.slotSize)
+			{
+				bucket.Free(ptr);
+			}
+			else
+			{
+				GetParentArena().Free(ptr, size);
+			}
+		}
+
+		void Release();
+
+		sizet GetSlotSize() const
+		{
+			return bucket.slotSize;
+		}
+		void GetBlocks(TArray<ArenaBlock>& outBlocks) const override
+		{
+			bucket.GetBlocks(outBlocks);
+		}
+
+		const MemoryStats* GetStats() const override
+		{
+			return &stats;
+		}
+	protected:
+		TypeId ProvideTypeId() const override
+		{
+			return p::GetTypeId<PoolArena>();
+		}
+	};
+
+	// TPoolArena works like a PoolArena with a slot size and alignment known at compile time
+	template<sizet size, sizet align = alignof(std::max_align_t)>
+	struct P_API TPoolArena : public PoolArena
+	{
+		using Super = PoolArena;
+		P_STRUCT(TPoolArena)
+
+
+		TPoolArena(sizet pageSize = 16 * Memory::KB, Arena& parentArena = GetCurrentArena())
+		    : PoolArena(size, align, pageSize, parentArena)
+		{}
+	};
+
+	/**
+	 * MultiPoolArena keeps a pool for each size class, allocating and freeing in O(1).
+	 * Classes are 8 bytes apart up to 64, then 4 classes per power of two up to 1024.
+	 * Blocks aligned more than their class are allocated from a bigger class.
+	 */
+	struct P_API MultiPoolArena : public ChildArena
+	{
+		using Super = ChildArena;
+		P_STRUCT(MultiPoolArena)
+
+		static constexpr i32 numClasses = 24;
+		// Allocations up to this size are pooled
+		static constexpr sizet maxPooledSize = 1024;
+		// Max alignment of pooled blocks
+		static constexpr sizet maxPooledAlign = 64;
+
+	private:
+		MemoryStats stats;
+
+	protected:
+		Details::PoolBucket buckets[numClasses];
+
+
+	public:
+		MultiPoolArena(sizet pageSize = 16 * Memory::KB, Arena& parentArena = GetCurrentArena());
+		~MultiPoolArena()
+		{
+			Release();
+		}
+
+		void* Alloc(sizet size)
+		{
+			void* const ptr = size <= maxPooledSize ? buckets[GetClass(size)].Alloc(GetParentArena())
+			                                        : GetParentArena().Alloc(size);
+			stats.Add(ptr, size);
+			return ptr;
+		}
+		void* Alloc(sizet size, sizet align);
+		bool Realloc(void* ptr, sizet ptrSize, sizet size)
+		{
+			return false;
+		}
+		void Free(void* ptr, sizet size)
+		{
+			stats.Remove(ptr, size);
+			if (size <= maxPooledSize)
+			{
+				buckets[GetClass(size)].Free(ptr);
+			}
+			else
+			{
+				GetParentArena().Free(ptr, size);
+			}
+		}
+
+		void Release();
+
+		void GetBlocks(TArray<ArenaBlock>& outBlocks) const override
+		{
+			for (const Details::PoolBucket& bucket : buckets)
+			{
+				bucket.GetBlocks(outBlocks);
+			}
+		}
+
+		const MemoryStats* GetStats() const override
+		{
+			return &stats;
+		}
+
+		static constexpr sizet GetClassSize(i32 index)
+		{
+			if (index < 8)
+			{
+				return sizet(index + 1) * 8;
+			}
+			const i32 group = (index - 8) / 4;
+			return (sizet(64) << group) + sizet((index - 8) % 4 + 1) * (sizet(16) << group);
+		}
+		static i32 GetClass(sizet size)
+		{
+			if (size <= 64)
+			{
+				return size > 0 ? i32((size + 7) / 8) - 1 : 0;
+			}
+			const sizet last  = size - 1;
+			const i32 highBit = i32(std::bit_width(last)) - 1;
+			return 8 + (highBit - 6) * 4 + i32((last >> (highBit - 2)) & 3);
+		}
+
+	protected:
+		TypeId ProvideTypeId() const override
+		{
+			return p::GetTypeId<MultiPoolArena>();
+		}
+	};
+#pragma endregion Pool Arena
+
 #pragma region Best Fit Arena
 	struct P_API BestFitArena : public ChildArena
 	{
@@ -527,4 +912,119 @@ namespace p
 		}
 	};
 #pragma endregion Big Best Fit Arena
+
+#pragma region TLSF Arena
+	namespace Details
+	{
+		// Header of each block. Free blocks keep their free list links after it.
+		struct P_API TLSFBlock
+		{
+			TLSFBlock* prevPhysical = nullptr;
+			sizet size              = 0;    // Size after the header. Lowest bit marks free blocks
+			TLSFBlock* nextFree     = nullptr;
+			TLSFBlock* prevFree     = nullptr;
+		};
+
+		// Header of each block of memory allocated from the parent arena
+		struct P_API TLSFRegion
+		{
+			TLSFRegion* next = nullptr;
+			sizet size       = 0;
+		};
+	}    // namespace Details
+
+	/**
+	 * TLSFArena (Two-Level Segregated Fit) allocates and frees blocks of any size in O(1).
+	 * Free blocks are kept in lists by size class, found with two levels of bitmaps, and merged
+	 * with their neighbors as soon as they are freed.
+	 * When no block fits, a new region is allocated from the parent arena. Regions that become
+	 * empty are returned, except the last one.
+	 */
+	struct P_API TLSFArena : public ChildArena
+	{
+		using Super = ChildArena;
+		P_STRUCT(TLSFArena)
+
+		// Alignment and granularity of all blocks
+		static constexpr sizet minAlign = 16;
+		// Each power of two is split in 2^slLog2 lists
+		static constexpr u32 slLog2 = 4;
+		static constexpr u32 slCount = 1 << slLog2;
+		// Blocks smaller than this go into the first level, split linearly
+		static constexpr u32 flShift        = slLog2 + 4;
+		static constexpr sizet smallSize    = sizet(1) << flShift;
+		static constexpr u32 flCount        = 40 - flShift;
+		static constexpr sizet maxBlockSize = sizet(1) << (flShift + flCount - 1);
+
+	private:
+		MemoryStats stats;
+
+	protected:
+		using Block  = Details::TLSFBlock;
+		using Region = Details::TLSFRegion;
+
+		u32 flBitmap = 0;
+		u32 slBitmaps[flCount]{};
+		Block* freeBlocks[flCount][slCount]{};
+		Region* lastRegion = nullptr;
+		sizet regionSize   = 0;
+		sizet freeSize     = 0;
+
+
+	public:
+		TLSFArena(sizet regionSize = Memory::MB, Arena& parentArena = GetCurrentArena());
+		~TLSFArena()
+		{
+			Release();
+		}
+
+		void* Alloc(sizet size)
+		{
+			return Alloc(size, minAlign);
+		}
+		void* Alloc(sizet size, sizet align);
+		bool Realloc(void* ptr, sizet ptrSize, sizet size)
+		{
+			return false;
+		}
+		void Free(void* ptr, sizet size);
+
+		// Frees all regions
+		void Release();
+
+		// Bytes available in free blocks of all regions
+		sizet GetFreeSize() const
+		{
+			return freeSize;
+		}
+
+		sizet GetAvailableMemory() const override
+		{
+			return freeSize;
+		}
+		void GetBlocks(TArray<ArenaBlock>& outBlocks) const override;
+
+		const MemoryStats* GetStats() const override
+		{
+			return &stats;
+		}
+
+	private:
+		static void Mapping(sizet size, u32& fl, u32& sl);
+		static sizet RoundUpToList(sizet size);
+		Block* FindFreeBlock(sizet size);
+		void InsertFreeBlock(Block* block);
+		void RemoveFreeBlock(Block* block);
+		Block* MergeFree(Block* block);
+		void SplitBlock(Block* block, sizet size);
+		bool AddRegion(sizet minBlockSize);
+		void FreeRegion(Region* region);
+
+	protected:
+		TypeId ProvideTypeId() const override
+		{
+			return p::GetTypeId<TLSFArena>();
+		}
+	};
+#pragma endregion TLSF Arena
 }    // namespace p
@@ -193,6 +193,12 @@ namespace p
 		TF_ECS_ModifyOnEdit = TF_ECS_ModifyOnAdd | TF_ECS_ModifyOnGet | TF_ECS_ModifyOnRm,
 		// -> In ECS, syntax sugar for flags TF_ECS_StoreLastModified and TF_ECS_ModifyOnEdit
 		TF_ECS_ModifyAndStoreOnEdit = TF_ECS_StoreLastModified | TF_ECS_ModifyOnEdit,
+		// -> In ECS, should pools of this type store the tick when each component last changed?
+		// Cheaper than CMdfd for components edited often. See FindAllIdsChanged()
+		TF_ECS_TrackChanges = 1 << 11,
+		// -> Can be serialized as raw bytes by binary formats. The type must be trivially copyable
+		// and not contain pointers or ids. See EntityWriter::SerializePool()
+		TF_TrivialSerialize = 1 << 12,
 
 		// Any other flags up to 64 bytes are available to the user
 	};
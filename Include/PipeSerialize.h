@@ -538,6 +538,11 @@ namespace p
 		virtual bool IsObject() const           = 0;
 		virtual bool IsArray() const            = 0;
 		virtual bool IsValid() const            = 0;
+		// Binary formats can read raw blocks of bytes. See BinaryFormatReader::ReadBytes()
+		virtual bool IsBinary() const
+		{
+			return false;
+		}
 
 		Reader& GetReader()
 		{
@@ -588,6 +593,11 @@ namespace p
 		virtual void Write(double val)          = 0;
 		virtual void Write(StringView val)      = 0;
 		virtual bool IsValid() const            = 0;
+		// Binary formats can write raw blocks of bytes. See BinaryFormatWriter::WriteBytes()
+		virtual bool IsBinary() const
+		{
+			return false;
+		}
 
 
 		void PushAddFlags(WriteFlags flags)
@@ -797,6 +807,9 @@ namespace p
 		P_API BinaryFormatReader(TView<u8> data);
 		P_API ~BinaryFormatReader();
 
+		// Starts reading other data
+		P_API void Reset(TView<u8> newData);
+
 		P_API void BeginObject() override {}    // Nothing to do
 		P_API void BeginArray(u32& size) override;
 
@@ -820,6 +833,16 @@ namespace p
 		P_API bool IsObject() const override;
 		P_API bool IsArray() const override;
 		P_API bool IsValid() const override;
+		P_API bool IsBinary() const override
+		{
+			return true;
+		}
+
+		/**
+		 * Reads a block of raw bytes.
+		 * @return the bytes, or null if they exceed the read buffer. They may not be aligned
+		 */
+		P_API const u8* ReadBytes(u32 size);
 	};
 
 	struct BinaryFormatWriter : public IFormatWriter
@@ -857,9 +880,21 @@ namespace p
 		{
 			return data != nullptr;
 		}
+		P_API bool IsBinary() const override
+		{
+			return true;
+		}
 		// END Writer Interface
 
+		/**
+		 * Adds a block of raw bytes.
+		 * @return the bytes added, to be filled by the caller. They may not be aligned
+		 */
+		P_API u8* WriteBytes(u32 size);
+
 		P_API TView<p::u8> GetData();
+		// Clears the data written, keeping its memory
+		P_API void Reset();
 
 	private:
 		void PreAlloc(p::u32 offset);
@@ -0,0 +1,163 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "Pipe/Core/WorkerPool.h"
+
+#include "PipeMath.h"
+
+
+namespace p
+{
+	WorkerPool::WorkerPool(i32 numWorkers)
+	{
+		threads.Reserve(numWorkers);
+		for (i32 i = 0; i < numWorkers; ++i)
+		{
+			threads.Add(std::thread{[this]()
+			{
+				WorkerLoop();
+			}});
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::unique_lock lock{tasksMutex};
+			stopping = true;
+		}
+		tasksCondition.notify_all();
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	void WorkerPool::Enqueue(Task&& task)
+	{
+		bool anyWaiting;
+		{
+			std::unique_lock lock{tasksMutex};
+			tasks.Add(Move(task));
+			anyWaiting = numWaiting > 0;
+		}
+		tasksCondition.notify_one();
+		if (anyWaiting)
+		{
+			doneCondition.notify_all();
+		}
+	}
+
+	void WorkerPool::WaitUntilDone(const std::atomic<i32>& pending)
+	{
+		while (pending.load(std::memory_order_acquire) > 0)
+		{
+			if (TryRunTask())
+			{
+				continue;
+			}
+
+			// Nothing to help with. Sleep until done or until there are tasks again.
+			std::unique_lock lock{tasksMutex};
+			++numWaiting;
+			doneCondition.wait(lock, [this, &pending]()
+			{
+				return pending.load(std::memory_order_acquire) == 0 || !tasks.IsEmpty();
+			});
+			--numWaiting;
+		}
+	}
+
+	void WorkerPool::CompleteTask(std::atomic<i32>& pending)
+	{
+		if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			// Waiters check pending while locked, so locking here means none can miss the notify
+			{
+				std::unique_lock lock{tasksMutex};
+			}
+			doneCondition.notify_all();
+		}
+	}
+
+	void WorkerPool::ParallelFor(i32 count, const std::function<void(i32)>& callback)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		std::atomic<i32> next{0};
+		auto runIndices = [&next, count, &callback]()
+		{
+			for (i32 i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+			     i = next.fetch_add(1, std::memory_order_relaxed))
+			{
+				callback(i);
+			}
+		};
+
+		// The calling thread also works, so one helper less is needed
+		const i32 numHelpers = Min(GetNumWorkers(), count - 1);
+		std::atomic<i32> pending{numHelpers};
+		for (i32 i = 0; i < numHelpers; ++i)
+		{
+			Enqueue([this, &runIndices, &pending]()
+			{
+				runIndices();
+				CompleteTask(pending);
+			});
+		}
+		runIndices();
+		WaitUntilDone(pending);
+	}
+
+	i32 WorkerPool::GetDefaultNumWorkers()
+	{
+		return Max(i32(std::thread::hardware_concurrency()) - 1, 0);
+	}
+
+	bool WorkerPool::TryRunTask()
+	{
+		Task task;
+		{
+			std::unique_lock lock{tasksMutex};
+			if (tasks.IsEmpty())
+			{
+				return false;
+			}
+			task = Move(tasks.Last());
+			tasks.RemoveLast(1, Shrink::No);
+		}
+		task();
+		return true;
+	}
+
+	void WorkerPool::WorkerLoop()
+	{
+		while (true)
+		{
+			Task task;
+			{
+				std::unique_lock lock{tasksMutex};
+				tasksCondition.wait(lock, [this]()
+				{
+					return stopping || !tasks.IsEmpty();
+				});
+				if (tasks.IsEmpty())    // Only empty when stopping
+				{
+					return;
+				}
+				task = Move(tasks.Last());
+				tasks.RemoveLast(1, Shrink::No);
+			}
+			task();
+		}
+	}
+
+
+	WorkerPool& GetDefaultWorkerPool()
+	{
+		static WorkerPool pool;
+		return pool;
+	}
+}    // namespace p
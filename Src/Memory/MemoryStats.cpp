@@ -71,7 +71,10 @@ namespace p
 
 	MemoryStats::MemoryStats()
 	    : events{GetStatsArena()}, live{GetStatsArena()}, frees{GetStatsArena()}
-	{}
+	{
+		static std::atomic<u64> lastUniqueId{0};
+		uniqueId = ++lastUniqueId;
+	}
 
 	MemoryStats::~MemoryStats()
 	{
@@ -101,14 +104,38 @@ namespace p
 
 	MemoryStats::ThreadContext* MemoryStats::GetOrCreateContext()
 	{
-		// Per-thread, per-MemoryStats context. The thread_local cache holds
-		// the most recently used context; we replace it if the owner changed.
-		thread_local ThreadContext* ctx = nullptr;
-		if (!ctx || ctx->owner != this)
+		// Per-thread, per-MemoryStats context. The thread_local cache holds the most recently
+		// used contexts, since allocations often alternate between an arena and its parent.
+		// Entries are matched by unique id, since another owner can reuse a destroyed address.
+		struct CachedContext
+		{
+			u64 ownerId        = 0;
+			ThreadContext* ctx = nullptr;
+		};
+		static constexpr u32 numCachedContexts = 4;
+		thread_local CachedContext cachedContexts[numCachedContexts]{};
+		thread_local u32 nextCachedContext = 0;
+		thread_local const u8 threadMarker = 0;
+		for (const CachedContext& cached : cachedContexts)
+		{
+			if (cached.ownerId == uniqueId) [[likely]]
+			{
+				return cached.ctx;
+			}
+		}
+
+		// Not cached. This thread may still have a context on this MemoryStats.
+		ThreadContext* ctx = contexts.load(std::memory_order_acquire);
+		while (ctx && ctx->thread != &threadMarker)
+		{
+			ctx = ctx->nextCtx;
+		}
+		if (!ctx)
 		{
 			ctx = p::Alloc<ThreadContext>(GetStatsArena(), 1);
 			new (ctx) ThreadContext{};
-			ctx->owner = this;
+			ctx->owner  = this;
+			ctx->thread = &threadMarker;
 			// Link into the global list. Append-only, so no synchronization
 			// needed with the consumer beyond the CAS.
 			ThreadContext* old = contexts.load(std::memory_order_relaxed);
@@ -118,6 +145,8 @@ namespace p
 			} while (!contexts.compare_exchange_weak(
 			    old, ctx, std::memory_order_release, std::memory_order_relaxed));
 		}
+		cachedContexts[nextCachedContext] = {uniqueId, ctx};
+		nextCachedContext                 = (nextCachedContext + 1) % numCachedContexts;
 		return ctx;
 	}
 
@@ -2,9 +2,122 @@
 
 #include "Pipe/Memory/OwnPtr.h"
 
+#include "PipeMemoryArenas.h"
+
+#include <mutex>
+
 
 namespace p
 {
+	namespace Internal
+	{
+		// Never destroyed, since owners can be released after static destruction
+		static std::mutex& GetCounterMutex()
+		{
+			alignas(std::mutex) static u8 storage[sizeof(std::mutex)];
+			static std::mutex* mutex = new (storage) std::mutex();
+			return *mutex;
+		}
+
+		static PoolArena& GetCounterArena()
+		{
+			alignas(PoolArena) static u8 storage[sizeof(PoolArena)];
+			static PoolArena* arena = new (storage) PoolArena(
+			    sizeof(PtrWeakCounter), alignof(PtrWeakCounter), 16 * Memory::KB, GetHeapArena());
+			return *arena;
+		}
+
+		// Counters cached by each thread, so that the shared pool is only locked once per batch.
+		// Trivially destructible, so that it can still be used after the thread cleaned it.
+		struct CounterCache
+		{
+			static constexpr i32 capacity  = 64;
+			static constexpr i32 batchSize = 32;
+
+			void* slots[capacity];
+			i32 size    = 0;
+			bool closed = false;    // Thread exiting, counters go directly to the pool
+		};
+		static thread_local CounterCache counterCache;
+
+		// Returns cached counters to the pool when a thread exits
+		struct CounterCacheCleaner
+		{
+			~CounterCacheCleaner()
+			{
+				std::scoped_lock lock{GetCounterMutex()};
+				for (i32 i = 0; i < counterCache.size; ++i)
+				{
+					GetCounterArena().Free(counterCache.slots[i], sizeof(PtrWeakCounter));
+				}
+				counterCache.size   = 0;
+				counterCache.closed = true;
+			}
+		};
+		static thread_local CounterCacheCleaner counterCacheCleaner;
+
+		static void* AllocCounter()
+		{
+			CounterCache& cache = counterCache;
+			if (cache.size == 0) [[unlikely]]
+			{
+				std::scoped_lock lock{GetCounterMutex()};
+				if (cache.closed)
+				{
+					return GetCounterArena().Alloc(sizeof(PtrWeakCounter));
+				}
+				static_cast<void>(&counterCacheCleaner);    // Registers the cleaner
+				for (; cache.size < CounterCache::batchSize; ++cache.size)
+				{
+					cache.slots[cache.size] = GetCounterArena().Alloc(sizeof(PtrWeakCounter));
+				}
+			}
+			return cache.slots[--cache.size];
+		}
+
+		static void FreeCounter(void* ptr)
+		{
+			CounterCache& cache = counterCache;
+			if (cache.size == CounterCache::capacity || cache.closed) [[unlikely]]
+			{
+				std::scoped_lock lock{GetCounterMutex()};
+				if (cache.closed)
+				{
+					GetCounterArena().Free(ptr, sizeof(PtrWeakCounter));
+					return;
+				}
+				for (; cache.size > CounterCache::capacity - CounterCache::batchSize; --cache.size)
+				{
+					GetCounterArena().Free(cache.slots[cache.size - 1], sizeof(PtrWeakCounter));
+				}
+			}
+			cache.slots[cache.size++] = ptr;
+		}
+
+		PtrWeakCounter* NewPtrWeakCounter(Arena& arena, Deleter* deleter)
+		{
+			// Only counters of the heap use the pool. Other arenas may be released as a whole.
+			void* ptr = &arena == &GetHeapArena() ? AllocCounter()
+			                                      : p::Alloc<PtrWeakCounter>(arena);
+			return new (ptr) PtrWeakCounter(arena, deleter);
+		}
+
+		void PtrWeakCounter::Delete()
+		{
+			Arena& counterArena = arena;
+			this->~PtrWeakCounter();
+			if (&counterArena == &GetHeapArena())
+			{
+				FreeCounter(this);
+			}
+			else
+			{
+				p::Free<PtrWeakCounter>(counterArena, this, 1);
+			}
+		}
+	}    // namespace Internal
+
+
 	void BaseOwnPtr::Delete()
 	{
 		if (!counter)
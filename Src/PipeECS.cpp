@@ -6,8 +6,22 @@
 #include "Pipe/Core/Limits.h"
 #include "Pipe/Core/Set.h"
 
+#include <bit>
 #include <mutex>
 
+#if defined(__x86_64__) || defined(_M_X64)
+	#define P_ECS_SSE2 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define P_ECS_TARGET_AVX2
+	#else
+		#define P_ECS_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define P_ECS_SSE2 0
+#endif
+
 
 namespace p
 {
@@ -42,34 +56,34 @@ namespace p
 	}
 
 
-	IdRegistry::IdRegistry(IdRegistry&& other)
+	IdRegistry::IdRegistry(IdRegistry&& other) : IdRegistry(*other.arena)
 	{
 		std::unique_lock lock{other.mutex};
-		entities         = Move(other.entities);
-		available        = Move(other.available);
-		deferredRemovals = Move(other.deferredRemovals);
+		MoveFrom(Move(other));
 	}
-	IdRegistry::IdRegistry(const IdRegistry& other)
+	IdRegistry::IdRegistry(const IdRegistry& other) : IdRegistry(*other.arena)
 	{
 		std::shared_lock lock{other.mutex};
-		entities         = other.entities;
-		available        = other.available;
-		deferredRemovals = other.deferredRemovals;
+		CopyFrom(other);
 	}
 	IdRegistry& IdRegistry::operator=(IdRegistry&& other)
 	{
-		std::unique_lock lock{other.mutex};
-		entities         = Move(other.entities);
-		available        = Move(other.available);
-		deferredRemovals = Move(other.deferredRemovals);
+		if (this != &other)
+		{
+			std::unique_lock lock{mutex};
+			std::unique_lock otherLock{other.mutex};
+			MoveFrom(Move(other));
+		}
 		return *this;
 	}
 	IdRegistry& IdRegistry::operator=(const IdRegistry& other)
 	{
-		std::shared_lock lock{other.mutex};
-		entities         = other.entities;
-		available        = other.available;
-		deferredRemovals = other.deferredRemovals;
+		if (this != &other)
+		{
+			std::unique_lock lock{mutex};
+			std::shared_lock otherLock{other.mutex};
+			CopyFrom(other);
+		}
 		return *this;
 	}
 
@@ -88,22 +102,26 @@ namespace p
 		{
 			for (i32 i = 0; i < nRecicled; ++i)
 			{
-				const Index index = available.Last();
-				auto& id          = entities[i32(index)];
-				id = MakeId(index, id.GetVersion());    // Set entity index to mark it as valid
+				const Index index = available[available.Size() - 1 - i];
+				const Slot& slot  = *GetSlot(index);
+				// Set entity index to mark it as valid
+				const Id id =
+				    MakeId(index, Id::MakeRaw(slot.load(std::memory_order_relaxed)).GetVersion());
+				StoreSlot(index, id.value);
 				newIds[i] = id;
 			}
-			available.RemoveLast(nRecicled);
+			available.RemoveLast(nRecicled, Shrink::No);
 			newIds = newIds.LastUnsafe(newIds.Size() - nRecicled);
 		}
 
 		// Remaining entities
-		const i32 firstIndex = entities.Size();
+		const u32 firstIndex = numIndices.load(std::memory_order_relaxed);
+		AddIndices(newIds.Size());
 		for (i32 i = 0; i < newIds.Size(); ++i)
 		{
 			newIds[i] = MakeId(firstIndex + i, 0);
+			StoreSlot(firstIndex + i, newIds[i].value);
 		}
-		entities.Append(newIds);
 	}
 
 	bool IdRegistry::RemoveInstant(TView<const Id> ids)
@@ -114,13 +132,12 @@ namespace p
 		for (Id id : ids)
 		{
 			const Index index = id.GetIndex();
-			if (entities.IsValidIndex(index))
+			if (index < numIndices.load(std::memory_order_relaxed))
 			{
-				Id& storedId = entities[i32(index)];
-				if (id == storedId)
+				if (id.value == GetSlot(index)->load(std::memory_order_relaxed))
 				{
 					// Increase version and reset index to invalidate current entity
-					storedId = MakeId(Id::indexMask, storedId.GetVersion() + 1u);
+					StoreSlot(index, MakeId(Id::indexMask, id.GetVersion() + 1u).value);
 					available.Add(index);
 				}
 			}
@@ -136,14 +153,13 @@ namespace p
 		for (Id id : ids)
 		{
 			const Index index = id.GetIndex();
-			if (entities.IsValidIndex(index))
+			if (index < numIndices.load(std::memory_order_relaxed))
 			{
-				Id& storedId = entities[index];
-				if (id == storedId)
+				if (id.value == GetSlot(index)->load(std::memory_order_relaxed))
 				{
-					deferredRemovals.AddSorted(storedId);
+					deferredRemovals.AddSorted(id);
 					// Increase version and reset index to invalidate current entity
-					storedId = MakeId(Id::indexMask, storedId.GetVersion() + 1u);
+					StoreSlot(index, MakeId(Id::indexMask, id.GetVersion() + 1u).value);
 				}
 			}
 		}
@@ -152,6 +168,7 @@ namespace p
 
 	bool IdRegistry::FlushDeferredRemovals()
 	{
+		std::unique_lock lock{mutex};
 		if (deferredRemovals.Size() > 0)
 		{
 			available.ReserveMore(deferredRemovals.Size());
@@ -167,32 +184,277 @@ namespace p
 
 	bool IdRegistry::IsValid(Id id) const
 	{
-		std::shared_lock lock{mutex};
-		const Index index = id.GetIndex();
-		return entities.IsValidIndex(index) && entities[p::i32(index)] == id;
+		const Slot* const slot = FindSlot(id.GetIndex());
+		return slot && slot->load(std::memory_order_acquire) == id.value;
 	}
 
 	bool IdRegistry::WasRemoved(Id id) const
 	{
-		std::shared_lock lock{mutex};
-		const Index index = id.GetIndex();
-		return entities.IsValidIndex(index)
-		    && entities[p::i32(index)].GetVersion() > id.GetVersion();
+		const Slot* const slot = FindSlot(id.GetIndex());
+		return slot
+		    && Id::MakeRaw(slot->load(std::memory_order_acquire)).GetVersion() > id.GetVersion();
 	}
 
 	TOptional<IdRegistry::Version> IdRegistry::GetValidVersion(IdRegistry::Index idx) const
 	{
-		std::shared_lock lock{mutex};
-		if (entities.IsValidIndex(idx))
+		if (const Slot* const slot = FindSlot(idx))
 		{
-			return entities[p::i32(idx)].GetVersion();
+			return Id::MakeRaw(slot->load(std::memory_order_acquire)).GetVersion();
 		}
 		return TOptional<Version>{};
 	}
 
 	u32 IdRegistry::Size() const
 	{
-		return entities.Size() - available.Size() - deferredRemovals.Size();
+		return numIndices.load(std::memory_order_relaxed) - available.Size()
+		     - deferredRemovals.Size() - numReserved.load(std::memory_order_relaxed);
+	}
+
+	void IdRegistry::AddIndices(u32 count)
+	{
+		const u32 first          = numIndices.load(std::memory_order_relaxed);
+		const u32 last           = first + count;
+		const i32 numNeededPages = i32((last + pageSize - 1) / pageSize);
+		if (numNeededPages > pagesCapacity)
+		{
+			const i32 newCapacity = Max(numNeededPages, Max(pagesCapacity * 2, 8));
+			Slot** const newPages = p::Alloc<Slot*>(*arena, newCapacity);
+			Slot** const lastPages = pages.load(std::memory_order_relaxed);
+			for (i32 i = 0; i < numPages; ++i)
+			{
+				newPages[i] = lastPages[i];
+			}
+			if (lastPages)
+			{
+				// Other threads may still be reading the last list
+				oldPages.Add({lastPages, pagesCapacity});
+			}
+			pages.store(newPages, std::memory_order_release);
+			pagesCapacity = newCapacity;
+		}
+
+		Slot** const currentPages = pages.load(std::memory_order_relaxed);
+		for (; numPages < numNeededPages; ++numPages)
+		{
+			currentPages[numPages] = p::Alloc<Slot>(*arena, slotsPerPage);
+			std::construct_at(currentPages[numPages] + pageSize, writeEpoch);
+		}
+		const Id::Value invalidId = MakeId(Id::indexMask, 0).value;
+		for (u32 i = first; i < last; ++i)
+		{
+			std::construct_at(GetSlot(i), invalidId);
+		}
+		if (count > 0)
+		{
+			for (u32 page = first / pageSize; page <= (last - 1) / pageSize; ++page)
+			{
+				MarkPageWritten(currentPages[page]);
+			}
+		}
+		numIndices.store(last, std::memory_order_release);
+	}
+
+	void IdRegistry::ReserveIndices(i32 count, TArray<Index>& outIndices, u32& outGeneration)
+	{
+		std::unique_lock lock{mutex};
+		outGeneration = generation.load(std::memory_order_relaxed);
+		outIndices.ReserveMore(count);
+		const i32 nRecicled = Min(count, available.Size());
+		// Reserved indices are taken from the end. New indices are added reversed so that they
+		// get used in order.
+		const u32 firstIndex = numIndices.load(std::memory_order_relaxed);
+		const i32 nNew       = count - nRecicled;
+		AddIndices(nNew);
+		for (i32 i = nNew - 1; i >= 0; --i)
+		{
+			outIndices.Add(firstIndex + i);
+		}
+		for (i32 i = available.Size() - nRecicled; i < available.Size(); ++i)
+		{
+			outIndices.Add(available[i]);
+		}
+		available.RemoveLast(nRecicled, Shrink::No);
+		numReserved.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void IdRegistry::ReleaseIndices(TView<const Index> indices, u32 indicesGeneration)
+	{
+		std::unique_lock lock{mutex};
+		if (indicesGeneration != generation.load(std::memory_order_relaxed))
+		{
+			return;    // Indices were discarded by a reset, copy or move
+		}
+		available.Append(indices);
+		numReserved.fetch_sub(indices.Size(), std::memory_order_relaxed);
+	}
+
+	void IdRegistry::UpdateSnapshot(IdRegistry& source)
+	{
+		if (this == &source)
+		{
+			return;
+		}
+		std::unique_lock lock{mutex};
+		std::unique_lock sourceLock{source.mutex};
+		CopyFrom(source, snapshotEpoch);
+		snapshotEpoch = source.writeEpoch;
+		// Writes from now on are newer than the snapshot
+		++source.writeEpoch;
+	}
+
+	void IdRegistry::CopyFrom(const IdRegistry& other, u32 sinceEpoch)
+	{
+		const u32 size = other.numIndices.load(std::memory_order_relaxed);
+		// Pages are reused when growing, so that repeated copies (snapshots) don't allocate
+		if (size < numIndices.load(std::memory_order_relaxed))
+		{
+			Reset();
+			sinceEpoch = 0;
+		}
+		snapshotEpoch = 0;
+		AddIndices(size - numIndices.load(std::memory_order_relaxed));
+		numReserved.store(0, std::memory_order_relaxed);
+		generation.fetch_add(1, std::memory_order_relaxed);
+
+		Slot** const currentPages = pages.load(std::memory_order_relaxed);
+		Slot** const otherPages   = other.pages.load(std::memory_order_acquire);
+		for (u32 first = 0, page = 0; first < size; first += pageSize, ++page)
+		{
+			const u32 count              = Min<u32>(pageSize, size - first);
+			Slot* const slots            = currentPages[page];
+			const Slot* const otherSlots = otherPages[page];
+			if (sinceEpoch != 0
+			    && otherSlots[pageSize].load(std::memory_order_relaxed) <= sinceEpoch)
+			{
+				continue;    // Not written since the last copy
+			}
+			for (u32 i = 0; i < count; ++i)
+			{
+				slots[i].store(otherSlots[i].load(std::memory_order_relaxed),
+				    std::memory_order_relaxed);
+			}
+		}
+		available        = other.available;
+		deferredRemovals = other.deferredRemovals;
+
+		// Indices still owned by reservations of the other registry are not owned by anyone in
+		// the copy. They are the invalid indices that are not available or pending removal.
+		const u32 otherReserved = other.numReserved.load(std::memory_order_relaxed);
+		if (otherReserved > 0)
+		{
+			BitArray unreserved{*arena};
+			unreserved.Resize(i32(size));
+			unreserved.SetAllFalse();
+			for (Index index : available)
+			{
+				unreserved.SetTrue(i32(index));
+			}
+			for (Id id : deferredRemovals)
+			{
+				unreserved.SetTrue(i32(id.GetIndex()));
+			}
+			const i32 lastAvailable = available.Size();
+			for (u32 index = 0; index < size; ++index)
+			{
+				const Id id = Id::MakeRaw(GetSlot(index)->load(std::memory_order_relaxed));
+				if (id.GetIndex() == Id::indexMask && !unreserved.IsSet(i32(index)))
+				{
+					available.Add(index);
+				}
+			}
+			P_Check(u32(available.Size() - lastAvailable) == otherReserved);
+		}
+	}
+
+	void IdRegistry::MoveFrom(IdRegistry&& other)
+	{
+		Reset();
+		if (arena == other.arena)
+		{
+			pages.store(other.pages.exchange(nullptr), std::memory_order_release);
+			numPages      = Exchange(other.numPages, 0);
+			pagesCapacity = Exchange(other.pagesCapacity, 0);
+			oldPages      = Move(other.oldPages);
+			numIndices.store(other.numIndices.exchange(0), std::memory_order_release);
+			numReserved.store(other.numReserved.exchange(0), std::memory_order_relaxed);
+			writeEpoch       = Max(writeEpoch, other.writeEpoch);
+			snapshotEpoch    = Exchange(other.snapshotEpoch, 0u);
+			available        = Move(other.available);
+			deferredRemovals = Move(other.deferredRemovals);
+			other.generation.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			CopyFrom(other);
+			other.Reset();
+		}
+	}
+
+	void IdRegistry::Reset()
+	{
+		Slot** const currentPages = pages.exchange(nullptr, std::memory_order_relaxed);
+		for (i32 i = 0; i < numPages; ++i)
+		{
+			p::Free(*arena, currentPages[i], slotsPerPage);
+		}
+		if (currentPages)
+		{
+			p::Free(*arena, currentPages, pagesCapacity);
+		}
+		for (const OldPages& old : oldPages)
+		{
+			p::Free(*arena, old.pages, old.capacity);
+		}
+		oldPages.Clear();
+		numPages      = 0;
+		pagesCapacity = 0;
+		numIndices.store(0, std::memory_order_relaxed);
+		numReserved.store(0, std::memory_order_relaxed);
+		generation.fetch_add(1, std::memory_order_relaxed);
+		snapshotEpoch = 0;
+		available.Clear();
+		deferredRemovals.Clear();
+	}
+
+
+	Id IdRegistry::Reservation::Create()
+	{
+		Id id;
+		Create(id);
+		return id;
+	}
+
+	void IdRegistry::Reservation::Create(TView<Id> newIds)
+	{
+		if (generation != registry->generation.load(std::memory_order_relaxed))
+		{
+			indices.Clear(Shrink::No);    // The registry discarded them
+		}
+		if (indices.Size() < newIds.Size())
+		{
+			registry->ReserveIndices(
+			    Max(blockSize, newIds.Size() - indices.Size()), indices, generation);
+		}
+
+		for (Id& id : newIds)
+		{
+			const Index index = indices.Last();
+			indices.RemoveLast(1, Shrink::No);
+			// Only this reservation owns the index, no need to lock
+			const Slot& slot = *registry->GetSlot(index);
+			id = MakeId(index, Id::MakeRaw(slot.load(std::memory_order_relaxed)).GetVersion());
+			registry->StoreSlot(index, id.value);
+		}
+		registry->numReserved.fetch_sub(newIds.Size(), std::memory_order_relaxed);
+	}
+
+	void IdRegistry::Reservation::Release()
+	{
+		if (!indices.IsEmpty())
+		{
+			registry->ReleaseIndices(indices, generation);
+			indices.Clear();
+		}
 	}
 
 
@@ -222,9 +484,7 @@ namespace p
 		if (EnterNext("components"))
 		{
 			BeginObject();
-			serializingMany = true;
-			onReadPools(*this);
-			serializingMany = false;
+			SerializeChunk(onReadPools);
 			Leave();
 		}
 
@@ -252,6 +512,19 @@ namespace p
 		FixParentIdLinks(context, parent);
 	}
 
+	void EntityReader::BeginChunks(i32 count)
+	{
+		ids.Resize(count);
+		AddId(context, ids);
+	}
+
+	void EntityReader::SerializeChunk(TFunction<void(EntityReader&)> onReadPools)
+	{
+		serializingMany = true;
+		onReadPools(*this);
+		serializingMany = false;
+	}
+
 	const TArray<Id>& EntityReader::GetIds() const
 	{
 		return ids;
@@ -266,23 +539,13 @@ namespace p
 	void EntityWriter::SerializeEntities(const TArray<Id>& entities,
 	    TFunction<void(EntityWriter&)> onWritePools, bool includeChildren)
 	{
-		if (includeChildren)
-		{
-			RetrieveHierarchy(entities, ids);
-		}
-		else
-		{
-			ids = entities;
-		}
-		MapIdsToIndices();
+		BeginChunks(entities, includeChildren);
 
 		Next("count", ids.Size());
 		if (EnterNext("components"))
 		{
 			BeginObject();
-			serializingMany = true;
-			onWritePools(*this);
-			serializingMany = false;
+			SerializeChunk(0, ids.Size(), onWritePools);
 			Leave();
 		}
 	}
@@ -300,14 +563,47 @@ namespace p
 		onWritePools(*this);
 	}
 
+	void EntityWriter::BeginChunks(const TArray<Id>& entities, bool includeChildren)
+	{
+		if (includeChildren)
+		{
+			ids.Clear(Shrink::No);
+			RetrieveHierarchy(entities, ids);
+		}
+		else
+		{
+			ids = entities;
+		}
+		MapIdsToIndices();
+	}
+
+	void EntityWriter::SerializeChunk(
+	    i32 first, i32 count, TFunction<void(EntityWriter&)> onWritePools)
+	{
+		chunkBegin      = Clamp(first, 0, ids.Size());
+		chunkEnd        = Clamp(first + count, chunkBegin, ids.Size());
+		serializingMany = true;
+		onWritePools(*this);
+		serializingMany = false;
+	}
+
 	const TArray<Id>& EntityWriter::GetIds() const
 	{
 		return ids;
 	}
 
-	const TMap<Id, i32>& EntityWriter::GetIdToIndexes() const
+	i32 EntityWriter::GetSerializedIndex(Id id) const
 	{
-		return idToIndexes;
+		const Id::Index index = id.GetIndex();
+		if (index < Id::Index(idIndices.Size()))
+		{
+			const i32 serializedIndex = idIndices[index];
+			if (serializedIndex >= 0 && ids[serializedIndex] == id)
+			{
+				return serializedIndex;
+			}
+		}
+		return -1;
 	}
 
 	void EntityWriter::RetrieveHierarchy(const TArray<Id>& roots, TArray<Id>& children)
@@ -342,11 +638,172 @@ namespace p
 
 	void EntityWriter::MapIdsToIndices()
 	{
-		idToIndexes.Reserve(ids.Size());
+		idIndices.Clear(Shrink::No);
 		for (i32 i = 0; i < ids.Size(); ++i)
 		{
-			idToIndexes.Insert(ids[i], i);
+			const Id::Index index = ids[i].GetIndex();
+			if (index >= Id::Index(idIndices.Size()))
+			{
+				idIndices.Resize(i32(index) + 1, -1, Shrink::No);
+			}
+			idIndices[index] = i;
+		}
+	}
+
+	// "PECS" in little endian
+	static constexpr u32 entityFileMagic   = 0x53434550;
+	static constexpr u32 entityFileVersion = 2;
+
+	static bool WriteFileU32(std::FILE* file, u32 value)
+	{
+		const u8 bytes[4]{u8(value), u8(value >> 8), u8(value >> 16), u8(value >> 24)};
+		return std::fwrite(bytes, 1, 4, file) == 4;
+	}
+
+	static bool ReadFileU32(std::FILE* file, u32& value)
+	{
+		u8 bytes[4];
+		if (std::fread(bytes, 1, 4, file) != 4)
+		{
+			return false;
+		}
+		value = u32(bytes[0]) | (u32(bytes[1]) << 8) | (u32(bytes[2]) << 16)
+		      | (u32(bytes[3]) << 24);
+		return true;
+	}
+
+	EntityFileWriter::EntityFileWriter(IdContext& context, StringView path, i32 idsPerChunk)
+	    : context{context}, idsPerChunk{Max(idsPerChunk, 1)}
+	{
+		file = std::fopen(String{path}.c_str(), "wb");
+	}
+
+	EntityFileWriter::~EntityFileWriter()
+	{
+		if (file)
+		{
+			std::fclose(file);
+		}
+	}
+
+	bool EntityFileWriter::Write(const TArray<Id>& entities,
+	    TFunction<void(EntityWriter&)> onWritePools, bool includeChildren)
+	{
+		if (!file)
+		{
+			return false;
+		}
+
+		BinaryFormatWriter format;
+		EntityWriter writer{format.GetWriter(), context};
+		writer.BeginChunks(entities, includeChildren);
+		const i32 numIds = writer.GetIds().Size();
+
+		bool written = WriteFileU32(file, entityFileMagic) && WriteFileU32(file, entityFileVersion)
+		            && WriteFileU32(file, u32(numIds)) && WriteFileU32(file, u32(idsPerChunk));
+		for (i32 first = 0; written && first < numIds; first += idsPerChunk)
+		{
+			// Each chunk reuses the memory of the last one
+			format.Reset();
+			writer.SerializeChunk(first, Min(idsPerChunk, numIds - first), onWritePools);
+			const TView<u8> data = format.GetData();
+			written = WriteFileU32(file, u32(data.Size()))
+			       && std::fwrite(data.Data(), 1, data.Size(), file) == sizet(data.Size());
+		}
+		return std::fflush(file) == 0 && written;
+	}
+
+	// Checks that the last byte of every chunk is in the file, without reading the chunks
+	static bool HasEntityFileChunks(std::FILE* file, u32 numChunks)
+	{
+		std::fpos_t begin;
+		if (std::fgetpos(file, &begin) != 0)
+		{
+			return false;
+		}
+		bool valid = true;
+		for (u32 i = 0; valid && i < numChunks; ++i)
+		{
+			u32 size = 0;
+			valid    = ReadFileU32(file, size) && size <= u32(Limits<i32>::Max())
+			      && (size == 0
+			          || (std::fseek(file, long(size) - 1, SEEK_CUR) == 0
+			              && std::fgetc(file) != EOF));
+		}
+		return std::fsetpos(file, &begin) == 0 && valid;
+	}
+
+	EntityFileReader::EntityFileReader(IdContext& context, StringView path)
+	    : reader{format.GetReader(), context}
+	{
+		file = std::fopen(String{path}.c_str(), "rb");
+		u32 magic = 0, version = 0, numIds = 0, idsPerChunk = 0;
+		if (file && ReadFileU32(file, magic) && magic == entityFileMagic
+		    && ReadFileU32(file, version) && version == entityFileVersion
+		    && ReadFileU32(file, numIds) && numIds <= u32(Limits<i32>::Max())
+		    && ReadFileU32(file, idsPerChunk) && idsPerChunk > 0)
+		{
+			numChunks = numIds / idsPerChunk + (numIds % idsPerChunk != 0);
+			status    = HasEntityFileChunks(file, numChunks) ? EntityFileStatus::Read
+			                                                 : EntityFileStatus::Truncated;
+		}
+		if (status == EntityFileStatus::Read)
+		{
+			reader.BeginChunks(i32(numIds));
+		}
+		else if (file)
+		{
+			std::fclose(file);
+			file = nullptr;
+		}
+	}
+
+	EntityFileReader::~EntityFileReader()
+	{
+		if (file)
+		{
+			std::fclose(file);
+		}
+	}
+
+	EntityFileStatus EntityFileReader::ReadChunk(TFunction<void(EntityReader&)> onReadPools)
+	{
+		if (!file || status != EntityFileStatus::Read)
+		{
+			return status;
 		}
+		if (numChunksRead == numChunks)
+		{
+			status = EntityFileStatus::End;
+			return status;
+		}
+
+		u32 size = 0;
+		if (!ReadFileU32(file, size) || size > u32(Limits<i32>::Max()))
+		{
+			status = EntityFileStatus::Truncated;
+			return status;
+		}
+		chunk.Resize(i32(size), Shrink::No);
+		if (std::fread(chunk.Data(), 1, size, file) != size)
+		{
+			status = EntityFileStatus::Truncated;
+			return status;
+		}
+		++numChunksRead;
+		format.Reset(chunk);
+		reader.SerializeChunk(onReadPools);
+		return EntityFileStatus::Read;
+	}
+
+	EntityFileStatus EntityFileReader::ReadAll(TFunction<void(EntityReader&)> onReadPools)
+	{
+		EntityFileStatus result;
+		do
+		{
+			result = ReadChunk(onReadPools);
+		} while (result == EntityFileStatus::Read);
+		return result;
 	}
 
 	void Read(Reader& r, Id& val)
@@ -365,8 +822,7 @@ namespace p
 		auto* entityWriter = p::Cast<EntityWriter>(&w);
 		if (P_EnsureMsg(entityWriter, "Serializing an ecs Id without an EntityWriter")) [[likely]]
 		{
-			const i32* dataId = entityWriter->GetIdToIndexes().Find(val);
-			entityWriter->Serialize(dataId ? *dataId : -1);
+			entityWriter->Serialize(entityWriter->GetSerializedIndex(val));
 		}
 	}
 
@@ -405,15 +861,36 @@ namespace p
 		return rend();
 	}
 
+	void IPool::HasIds(TView<const Id> ids, BitArray& results) const
+	{
+		results.Resize(ids.Size(), Shrink::No);
+		u32* const words = results.Data();
+		for (i32 i = 0; i < ids.Size(); i += 32)
+		{
+			const i32 count = Min(32, ids.Size() - i);
+			u32 word        = 0;
+			for (i32 b = 0; b < count; ++b)
+			{
+				word |= u32(Has(ids[i + b])) << b;
+			}
+			words[i >> 5] = word;
+		}
+	}
+
 
 	ComponentPool::ComponentPool(TypeId typeId, PoolRemovePolicy removePolicy, Arena& arena)
-	    : IPool(typeId), idIndices{arena}, idList{arena}, arena{&arena}, removePolicy{removePolicy}
+	    : IPool(typeId)
+	    , idIndices{arena}
+	    , idList{arena}
+	    , arena{&arena}
+	    , removePolicy{removePolicy}
+	    , idBits{arena}
 	{
 		BindOnPageAllocated();
 	}
 
 	ComponentPool::ComponentPool(const ComponentPool& other)
-	    : IPool(other.typeId), idIndices{*other.arena}, idList{*other.arena}
+	    : IPool(other.typeId), idIndices{*other.arena}, idList{*other.arena}, idBits{*other.arena}
 	{
 		arena        = other.arena;
 		removePolicy = other.removePolicy;
@@ -432,11 +909,20 @@ namespace p
 	}
 
 	ComponentPool::ComponentPool(ComponentPool&& other) noexcept
-	    : IPool(other.typeId), idIndices{Move(other.idIndices)}, idList{Move(other.idList)}
+	    : IPool(other.typeId)
+	    , idIndices{Move(other.idIndices)}
+	    , idList{Move(other.idList)}
+	    , idBits{Move(other.idBits)}
 	{
 		BindOnPageAllocated();
 		arena            = other.arena;
 		lastRemovedIndex = Exchange(other.lastRemovedIndex, NO_INDEX);
+		numRemoved       = Exchange(other.numRemoved, 0);
+		compactIndex     = Exchange(other.compactIndex, 0);
+		trackWrites      = Exchange(other.trackWrites, false);
+		writeEpoch       = other.writeEpoch;
+		pageEpochs       = Move(other.pageEpochs);
+		snapshotEpoch    = Exchange(other.snapshotEpoch, 0);
 		removePolicy     = other.removePolicy;
 		typeId           = other.typeId;
 	}
@@ -446,9 +932,17 @@ namespace p
 		typeId       = other.typeId;
 		idIndices    = {*other.arena};
 		idList       = {*other.arena};
+		idBits       = BitArray{*other.arena};
 		arena        = other.arena;
 		removePolicy = other.removePolicy;
 		typeId       = other.typeId;
+		// Removed slots and snapshot state are not copied
+		lastRemovedIndex = NO_INDEX;
+		numRemoved       = 0;
+		compactIndex     = 0;
+		trackWrites      = false;
+		pageEpochs.Clear();
+		snapshotEpoch = 0;
 		BindOnPageAllocated();
 		idList.Reserve(other.idList.Size());
 		idIndices.Reserve(other.idIndices.Capacity());
@@ -460,6 +954,7 @@ namespace p
 				EmplaceId(id, true);
 			}
 		}
+		RebuildQueries();
 		return *this;
 	}
 
@@ -468,10 +963,18 @@ namespace p
 		typeId           = other.typeId;
 		idIndices        = Move(other.idIndices);
 		idList           = Move(other.idList);
+		idBits           = Move(other.idBits);
 		arena            = other.arena;
 		lastRemovedIndex = Exchange(other.lastRemovedIndex, NO_INDEX);
+		numRemoved       = Exchange(other.numRemoved, 0);
+		compactIndex     = Exchange(other.compactIndex, 0);
+		trackWrites      = Exchange(other.trackWrites, false);
+		writeEpoch       = other.writeEpoch;
+		pageEpochs       = Move(other.pageEpochs);
+		snapshotEpoch    = Exchange(other.snapshotEpoch, 0);
 		removePolicy     = other.removePolicy;
 		typeId           = other.typeId;
+		RebuildQueries();
 		return *this;
 	}
 
@@ -480,42 +983,244 @@ namespace p
 		P_CheckMsg(!Has(id), "Set already contains entity");
 		const auto idIndex = id.GetIndex();
 
+		Index index;
 		if (lastRemovedIndex != NO_INDEX && !forceBack)
 		{
-			const i32 index = lastRemovedIndex;
+			index = lastRemovedIndex;
 			idIndices.Insert(idIndex, i32(index));
 			idList[index]    = id;
 			lastRemovedIndex = NO_INDEX;
-			return index;
+			--numRemoved;
 		}
 		else
 		{
 			idIndices.Reserve(idIndex + 1);
 			idIndices.Insert(idIndex, idList.Size());
 			idList.Add(id);
-			return idList.Size() - 1;
+			index = idList.Size() - 1;
 		}
-	}
+		if (i32(idIndex) >= idBits.Size())
+		{
+			idBits.Resize(i32(idIndex) + 1, false, Shrink::No);
+		}
+		idBits.SetTrue(idIndex);
 
-	void ComponentPool::PopId(Id id)
-	{
-		const Index index = id.GetIndex();
-		i32& idIndex      = idIndices[index];
+		MarkWritten(i32(index));
 
-		idList[idIndex]  = MakeId(index, NoIdVersion);    // Mark invalid but keep index
-		lastRemovedIndex = idIndex;
-		idIndex          = NO_INDEX;
+		for (IdQuery* query : queries)
+		{
+			query->OnIdAdded(id);
+		}
+		return index;
 	}
 
-	void ComponentPool::PopSwapId(Id id)
+	i32 ComponentPool::EmplaceIdsBack(TView<const Id> ids)
 	{
-		i32& idIndex = idIndices[id.GetIndex()];
-		idList.RemoveAtSwapUnsafe(idIndex);
+		i32 maxIndex = -1;
+		for (Id id : ids)
+		{
+			maxIndex = Max(maxIndex, i32(id.GetIndex()));
+		}
+		idIndices.Reserve(maxIndex + 1);
+		if (maxIndex >= idBits.Size())
+		{
+			idBits.Resize(maxIndex + 1, false, Shrink::No);
+		}
 
-		i32& lastIndex = idIndices[idList.Last().GetIndex()];
+		const i32 first = idList.Size();
+		idList.Append(ids.Data(), ids.Size());
+		i32 last = first;
+		for (Id id : ids)
+		{
+			if (Has(id)) [[unlikely]]
+			{
+				continue;
+			}
+			const Index idIndex = id.GetIndex();
+			idIndices.Insert(idIndex, last);
+			idList[last++] = id;
+			idBits.SetTrue(idIndex);
+		}
+		const i32 numSkipped = ids.Size() - (last - first);
+		if (numSkipped > 0)
+		{
+			idList.RemoveLast(numSkipped, Shrink::No);
+		}
+
+		if (trackWrites && last > first)
+		{
+			for (i32 page = first / pageSize; page <= (last - 1) / pageSize; ++page)
+			{
+				MarkPageWritten(page);
+			}
+		}
+		for (IdQuery* query : queries)
+		{
+			for (i32 i = first; i < last; ++i)
+			{
+				query->OnIdAdded(idList[i]);
+			}
+		}
+		return numSkipped;
+	}
+
+	void ComponentPool::PopId(Id id)
+	{
+		const Index index = id.GetIndex();
+		i32& idIndex      = idIndices[index];
+
+		MarkWritten(idIndex);
+		idList[idIndex]  = MakeId(index, NoIdVersion);    // Mark invalid but keep index
+		lastRemovedIndex = idIndex;
+		compactIndex     = Min(compactIndex, idIndex);
+		idIndex          = NO_INDEX;
+		++numRemoved;
+		idBits.SetFalse(index);
+
+		for (IdQuery* query : queries)
+		{
+			query->OnIdRemoved(id);
+		}
+	}
+
+	i32 ComponentPool::RemoveMasked(TView<const Id> ids, const BitArray& mask)
+	{
+		if (idList.Size() >= ids.Size())
+		{
+			return Remove(ids);
+		}
+
+		// Less ids than removals. Find them first, since removing can reorder grouped ids.
+		TArray<Id> contained;
+		const u32* const words = mask.Data();
+		const Index maskSize   = Index(mask.Size());
+		for (Id id : idList)
+		{
+			const Index index = id.GetIndex();
+			if (!IsNone(id) && index < maskSize && (words[index >> 5] >> (index & 31)) & 1u)
+			{
+				contained.Add(id);
+			}
+		}
+		RemoveUnsafe(contained);
+		return contained.Size();
+	}
+
+	void ComponentPool::TrimRemoved()
+	{
+		i32 size = idList.Size();
+		for (; size > 0 && IsNone(idList[size - 1]); --size)
+		{
+			--numRemoved;
+		}
+		idList.Resize(size, Shrink::No);
+		compactIndex = Min(compactIndex, size);
+		if (lastRemovedIndex >= size)
+		{
+			lastRemovedIndex = NO_INDEX;
+		}
+	}
+
+	bool ComponentPool::CompactStep(i32 maxMoves)
+	{
+		TrimRemoved();
+		for (i32 moves = 0; numRemoved > 0 && moves < maxMoves; ++moves)
+		{
+			// Trimmed, so the first removed slot is before the last id
+			while (!IsNone(idList[compactIndex]))
+			{
+				++compactIndex;
+			}
+			// Grouped ids are at the front and never removed, so only ungrouped ids move
+			SwapIndices(idList.Size() - 1, compactIndex);
+			TrimRemoved();
+		}
+		return numRemoved == 0;
+	}
+
+	void ComponentPool::GetWrittenPages(const ComponentPool& snapshot, TArray<i32>& pages) const
+	{
+		const i32 numPages         = (Size() + pageSize - 1) / pageSize;
+		const i32 numSnapshotPages = (snapshot.Size() + pageSize - 1) / pageSize;
+		const bool all             = !trackWrites || snapshot.snapshotEpoch == 0;
+		for (i32 page = 0; page < Max(numPages, numSnapshotPages); ++page)
+		{
+			// Pages past the end were cleared, and pages without epoch were not written yet
+			if (all || page >= numPages || page >= pageEpochs.Size()
+			    || pageEpochs[page] > snapshot.snapshotEpoch)
+			{
+				pages.Add(page);
+			}
+		}
+	}
+
+	void ComponentPool::UnlinkIds(i32 first, i32 last)
+	{
+		for (i32 i = first; i < last; ++i)
+		{
+			const Id id = idList[i];
+			if (!IsNone(id))
+			{
+				idIndices[id.GetIndex()] = NO_INDEX;
+				idBits.SetFalse(id.GetIndex());
+			}
+		}
+	}
+
+	void ComponentPool::CopyIds(const ComponentPool& source, i32 first, i32 last)
+	{
+		for (i32 i = first; i < last; ++i)
+		{
+			const Id id = source.idList[i];
+			idList[i]   = id;
+			if (IsNone(id))
+			{
+				continue;
+			}
+			const Index index = id.GetIndex();
+			idIndices.Reserve(index + 1);
+			idIndices.Insert(index, i);
+			if (i32(index) >= idBits.Size())
+			{
+				idBits.Resize(i32(index) + 1, false, Shrink::No);
+			}
+			idBits.SetTrue(index);
+		}
+	}
+
+	void ComponentPool::FinishSnapshot(ComponentPool& snapshot)
+	{
+		snapshot.lastRemovedIndex = lastRemovedIndex;
+		snapshot.numRemoved       = numRemoved;
+		snapshot.compactIndex     = compactIndex;
+		snapshot.snapshotEpoch    = writeEpoch;
+
+		// Writes from now on are newer than the snapshot
+		++writeEpoch;
+		if (!trackWrites)
+		{
+			trackWrites = true;
+			pageEpochs.Resize((Size() + pageSize - 1) / pageSize, 0u);
+		}
+	}
+
+	void ComponentPool::PopSwapId(Id id)
+	{
+		i32& idIndex = idIndices[id.GetIndex()];
+		MarkWritten(idIndex);
+		MarkWritten(idList.Size() - 1);
+		idList.RemoveAtSwapUnsafe(idIndex);
+
+		i32& lastIndex = idIndices[idList.Last().GetIndex()];
 		// Move last element to current index
 		idIndex   = lastIndex;
 		lastIndex = NO_INDEX;
+		idBits.SetFalse(id.GetIndex());
+
+		for (IdQuery* query : queries)
+		{
+			query->OnIdRemoved(id);
+		}
 	}
 
 	void ComponentPool::ClearIds()
@@ -539,7 +1244,20 @@ namespace p
 		}
 
 		lastRemovedIndex = NO_INDEX;
+		numRemoved       = 0;
+		compactIndex     = 0;
 		idList.Clear();
+		idBits.Clear();
+
+		// No id can match a query or group if one of its pools is empty
+		for (IdQuery* query : queries)
+		{
+			query->Clear();
+		}
+		if (group)
+		{
+			group->Clear();
+		}
 	}
 
 	void ComponentPool::BindOnPageAllocated()
@@ -550,6 +1268,263 @@ namespace p
 		};
 	}
 
+	u32 ComponentPool::FilterIdsWord(const Id* ids, u32 word) const
+	{
+		const u32* const words = idBits.Data();
+		const Index numBits    = Index(idBits.Size());
+		for (u32 rest = word; rest != 0; rest &= rest - 1)
+		{
+			const i32 b       = std::countr_zero(rest);
+			const Id id       = ids[b];
+			const Index index = id.GetIndex();
+			// Like Has, only ids with their bit set check the version
+			if (index >= numBits || !((words[index >> 5] >> (index & 31)) & 1u)
+			    || idList[idIndices[index]] != id)
+			{
+				word &= ~(1u << b);
+			}
+		}
+		return word;
+	}
+
+	void ComponentPool::HasIds(TView<const Id> ids, BitArray& results) const
+	{
+		results.Resize(ids.Size(), Shrink::No);
+		u32* const words = results.Data();
+		for (i32 i = 0; i < ids.Size(); i += 32)
+		{
+			const i32 count = Min(32, ids.Size() - i);
+			words[i >> 5]   = FilterIdsWord(ids.Data() + i, count < 32 ? (1u << count) - 1 : ~0u);
+		}
+	}
+
+	void ComponentPool::RebuildQueries()
+	{
+		for (IdQuery* query : queries)
+		{
+			query->Rebuild();
+		}
+		if (group)
+		{
+			group->Rebuild();
+		}
+	}
+
+
+	IdQuery::IdQuery(TView<ComponentPool* const> inPools, Arena& arena)
+	    : ids{arena}, idIndices{arena}
+	{
+		idIndices.onPageAllocated = [](i32 index, i32* page, i32 size)
+		{
+			std::uninitialized_fill_n(page, size, NO_INDEX);
+		};
+
+		pools.Append(inPools);
+		for (ComponentPool* pool : pools)
+		{
+			P_Check(pool);
+			typeIds.Add(pool->GetTypeId());
+			pool->queries.Add(this);
+		}
+		typeIds.Sort();
+		Rebuild();
+	}
+
+	IdQuery::~IdQuery()
+	{
+		for (ComponentPool* pool : pools)
+		{
+			pool->queries.RemoveSwap(this, Shrink::No);
+		}
+	}
+
+	void IdQuery::Rebuild()
+	{
+		Clear();
+
+		TArray<const IPool*> constPools;
+		constPools.Reserve(pools.Size());
+		for (const ComponentPool* pool : pools)
+		{
+			constPools.Add(pool);
+		}
+		FindAllIdsWith(constPools, ids);
+
+		if (!ids.IsEmpty())
+		{
+			Id::Index maxIndex = 0;
+			for (Id id : ids)
+			{
+				maxIndex = Max(maxIndex, id.GetIndex());
+			}
+			idIndices.Reserve(maxIndex + 1);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				idIndices.Insert(ids[i].GetIndex(), i);
+			}
+		}
+	}
+
+	bool IdQuery::Matches(TView<const TypeId> sortedTypeIds) const
+	{
+		if (sortedTypeIds.Size() != typeIds.Size())
+		{
+			return false;
+		}
+		for (i32 i = 0; i < typeIds.Size(); ++i)
+		{
+			if (sortedTypeIds[i] != typeIds[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void IdQuery::OnIdAdded(Id id)
+	{
+		for (const ComponentPool* pool : pools)
+		{
+			if (!pool->Has(id))
+			{
+				return;
+			}
+		}
+
+		const Id::Index index = id.GetIndex();
+		idIndices.Reserve(index + 1);
+		idIndices.Insert(index, ids.Size());
+		ids.Add(id);
+	}
+
+	void IdQuery::OnIdRemoved(Id id)
+	{
+		i32* const index = idIndices.At(id.GetIndex());
+		if (!index || *index == NO_INDEX)
+		{
+			return;
+		}
+
+		const i32 removedIndex = Exchange(*index, NO_INDEX);
+		ids.RemoveAtSwapUnsafe(removedIndex, Shrink::No);
+		if (removedIndex < ids.Size())
+		{
+			// The last id was moved into the removed slot
+			idIndices[ids[removedIndex].GetIndex()] = removedIndex;
+		}
+	}
+
+	void IdQuery::Clear()
+	{
+		for (Id id : ids)
+		{
+			idIndices[id.GetIndex()] = NO_INDEX;
+		}
+		ids.Clear(Shrink::No);
+	}
+
+
+	IdGroup::IdGroup(const IdContext& context, TView<ComponentPool* const> inPools)
+	    : context{&context}
+	{
+		pools.Append(inPools);
+		for (ComponentPool* pool : pools)
+		{
+			P_Check(pool && !pool->group);
+			typeIds.Add(pool->GetTypeId());
+			pool->group = this;
+		}
+		typeIds.Sort();
+		Rebuild();
+	}
+
+	IdGroup::~IdGroup()
+	{
+		for (ComponentPool* pool : pools)
+		{
+			pool->group = nullptr;
+		}
+	}
+
+	void IdGroup::Rebuild()
+	{
+		size = 0;
+		const ComponentPool* smallest = pools.First();
+		for (const ComponentPool* pool : pools)
+		{
+			if (pool->Size() < smallest->Size())
+			{
+				smallest = pool;
+			}
+		}
+
+		// Ids are moved to the front as they are found. Ids moved back were already visited.
+		const TArray<Id>& ids = smallest->GetIdList();
+		for (i32 i = 0; i < ids.Size(); ++i)
+		{
+			if (ids[i].GetVersion() != NoIdVersion)
+			{
+				OnIdAdded(ids[i]);
+			}
+		}
+	}
+
+	bool IdGroup::Matches(TView<const TypeId> sortedTypeIds) const
+	{
+		if (sortedTypeIds.Size() != typeIds.Size())
+		{
+			return false;
+		}
+		for (i32 i = 0; i < typeIds.Size(); ++i)
+		{
+			if (sortedTypeIds[i] != typeIds[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void IdGroup::OnIdAdded(Id id)
+	{
+		for (const ComponentPool* pool : pools)
+		{
+			if (!pool->Has(id))
+			{
+				return;
+			}
+		}
+
+		for (ComponentPool* pool : pools)
+		{
+			const i32 index = pool->GetIndexFromId(id);
+			if (index != size)
+			{
+				pool->SwapIndices(index, size);
+			}
+		}
+		++size;
+	}
+
+	void IdGroup::OnIdRemoved(Id id)
+	{
+		if (!Has(id))
+		{
+			return;
+		}
+
+		// Swap with the last id of the group, then shrink the group
+		const i32 index = pools.First()->GetIndexFromId(id);
+		const i32 last  = --size;
+		if (index != last)
+		{
+			for (ComponentPool* pool : pools)
+			{
+				pool->SwapIndices(index, last);
+			}
+		}
+	}
+
 	TPool<CRemoved>::TPool(p::IdContext& ctx, Arena& arena)
 	    : IPool(p::GetTypeId<CRemoved>()), idRegistry{&ctx.GetIdRegistry()}
 	{}
@@ -705,12 +1680,24 @@ namespace p
 	void IdContext::CopyFrom(const IdContext& other)
 	{
 		// Copy entities
-		idRegistry = other.idRegistry;
+		idRegistry        = other.idRegistry;
+		changeTick        = other.changeTick;
+		autoCompactRatio  = other.autoCompactRatio;
+		autoCompactBudget = other.autoCompactBudget;
 
 		// Copy component pools. Assume already sorted
 		for (const PoolInstance& otherInstance : other.pools)
 		{
-			if (otherInstance.pool->Size() > 0)
+			// Pools used by queries or groups are kept even if empty
+			const bool usedByQuery = other.queries.ContainsIf([&otherInstance](const auto& query)
+			{
+				return query->GetTypeIds().ContainsSorted(otherInstance.GetId());
+			});
+			const bool usedByGroup = other.groups.ContainsIf([&otherInstance](const auto& group)
+			{
+				return group->GetTypeIds().ContainsSorted(otherInstance.GetId());
+			});
+			if (otherInstance.pool->Size() > 0 || usedByQuery || usedByGroup)
 			{
 				pools.Add(PoolInstance{otherInstance});
 			}
@@ -718,15 +1705,78 @@ namespace p
 
 		AssurePool<CRemoved>().idRegistry = &idRegistry;
 
-		// TODO: Copy statics
-		// TODO: Cache pools
-	}
+		// Queries are not copied, they are created again for the new pools
+		TArray<IPool*> typePools;
+		TArray<ComponentPool*> queryPools;
+		for (const auto& otherQuery : other.queries)
+		{
+			typePools.Clear(Shrink::No);
+			GetPools(otherQuery->GetTypeIds(), typePools);
+			queryPools.Clear(Shrink::No);
+			for (IPool* pool : typePools)
+			{
+				queryPools.Add(static_cast<ComponentPool*>(pool));
+			}
+			queries.Add(MakeUnique<IdQuery>(TView<ComponentPool* const>{queryPools}));
+		}
+		// Copied pools keep the order of their ids, so groups are already sorted
+		TArray<ComponentPool*> groupPools;
+		for (const auto& otherGroup : other.groups)
+		{
+			typePools.Clear(Shrink::No);
+			GetPools(otherGroup->GetTypeIds(), typePools);
+			groupPools.Clear(Shrink::No);
+			for (IPool* pool : typePools)
+			{
+				groupPools.Add(static_cast<ComponentPool*>(pool));
+			}
+			groups.Add(MakeUnique<IdGroup>(*this, TView<ComponentPool* const>{groupPools}));
+		}
+
+		// TODO: Copy statics
+		// TODO: Cache pools
+	}
+
+	void IdContext::UpdateSnapshot(IdContext& source)
+	{
+		idRegistry.UpdateSnapshot(source.idRegistry);
+		changeTick = source.changeTick;
+
+		for (PoolInstance& sourceInstance : source.pools)
+		{
+			const TypeId typeId = sourceInstance.GetId();
+			i32 index           = pools.LowerBound(PoolInstance{typeId, {}});
+			if (index == NO_INDEX)
+			{
+				index = pools.Add(PoolInstance{typeId, {}});
+			}
+			else if (pools[index].GetId() != typeId)
+			{
+				pools.Insert(index, PoolInstance{typeId, {}});
+			}
+
+			sourceInstance.GetPool()->UpdateSnapshot(*this, pools[index].pool);
+			if (!pools[index].pool)    // Pool can't be copied
+			{
+				pools.RemoveAt(index);
+			}
+		}
+	}
 
 	void IdContext::MoveFrom(IdContext&& other)
 	{
-		idRegistry = Move(other.idRegistry);
-		pools      = Move(other.pools);
-		statics    = Move(other.statics);
+		idRegistry        = Move(other.idRegistry);
+		pools             = Move(other.pools);
+		statics           = Move(other.statics);
+		queries           = Move(other.queries);
+		groups            = Move(other.groups);
+		changeTick        = other.changeTick;
+		autoCompactRatio  = other.autoCompactRatio;
+		autoCompactBudget = other.autoCompactBudget;
+		for (const auto& group : groups)
+		{
+			group->context = this;
+		}
 
 		AssurePool<CRemoved>().idRegistry = &idRegistry;
 
@@ -781,9 +1831,88 @@ namespace p
 		return false;
 	}
 
+	IdQuery* IdContext::FindQuery(TView<const TypeId> sortedTypeIds) const
+	{
+		for (const auto& query : queries)
+		{
+			if (query->Matches(sortedTypeIds))
+			{
+				return query.Get();
+			}
+		}
+		return nullptr;
+	}
+
+	bool IdContext::RemoveQuery(const IdQuery& query)
+	{
+		const i32 index = queries.FindIndexIf([&query](const auto& other)
+		{
+			return other.Get() == &query;
+		});
+		if (index != NO_INDEX)
+		{
+			queries.RemoveAt(index);
+			return true;
+		}
+		return false;
+	}
+
+	IdGroup* IdContext::FindGroup(TView<const TypeId> sortedTypeIds) const
+	{
+		for (const auto& group : groups)
+		{
+			if (group->Matches(sortedTypeIds))
+			{
+				return group.Get();
+			}
+		}
+		return nullptr;
+	}
+
+	bool IdContext::RemoveGroup(const IdGroup& group)
+	{
+		const i32 index = groups.FindIndexIf([&group](const auto& other)
+		{
+			return other.Get() == &group;
+		});
+		if (index != NO_INDEX)
+		{
+			groups.RemoveAt(index);
+			return true;
+		}
+		return false;
+	}
+
+	void IdContext::AddLinkedTypeIds(TypeId typeId, TArray<TypeId>& sortedTypeIds) const
+	{
+		for (const auto& query : queries)
+		{
+			if (query->GetTypeIds().ContainsSorted(typeId))
+			{
+				for (TypeId linkedId : query->GetTypeIds())
+				{
+					sortedTypeIds.AddUniqueSorted(linkedId);
+				}
+			}
+		}
+		for (const auto& group : groups)
+		{
+			if (group->GetTypeIds().ContainsSorted(typeId))
+			{
+				for (TypeId linkedId : group->GetTypeIds())
+				{
+					sortedTypeIds.AddUniqueSorted(linkedId);
+				}
+			}
+		}
+	}
+
 	void IdContext::Reset(bool keepStatics)
 	{
 		idRegistry = {};
+		// Queries and groups reference pools, so they are released first
+		queries.Clear();
+		groups.Clear();
 		pools.Clear();
 		if (!keepStatics)
 		{
@@ -813,97 +1942,268 @@ namespace p
 	}
 
 
-	void ExcludeIdsWith(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+#pragma region Intersection
+	using AndWordsFunc = bool (*)(u32* words, const u32* other, i32 count);
+
+	static bool AndWordsScalar(u32* words, const u32* other, i32 count)
 	{
-		for (i32 i = ids.Size() - 1; i >= 0; --i)
+		u32 any = 0;
+		for (i32 i = 0; i < count; ++i)
 		{
-			if (pool->Has(ids[i]))
-			{
-				ids.RemoveAtSwapUnsafe(i);
-			}
+			words[i] &= other[i];
+			any |= words[i];
 		}
-		if (shouldShrink == Shrink::Yes)
+		return any != 0;
+	}
+
+#if P_ECS_SSE2
+	static bool AndWordsSSE2(u32* words, const u32* other, i32 count)
+	{
+		__m128i any = _mm_setzero_si128();
+		i32 i       = 0;
+		for (; i + 4 <= count; i += 4)
 		{
-			ids.Shrink();
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i));
+			const __m128i r = _mm_and_si128(a, b);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(words + i), r);
+			any = _mm_or_si128(any, r);
 		}
+		const bool anySet = _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xFFFF;
+		return AndWordsScalar(words + i, other + i, count - i) || anySet;
 	}
 
-	void ExcludeIdsWithStable(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	P_ECS_TARGET_AVX2 static bool AndWordsAVX2(u32* words, const u32* other, i32 count)
 	{
-		ids.RemoveIf([pool](Id id)
+		__m256i any = _mm256_setzero_si256();
+		i32 i       = 0;
+		for (; i + 8 <= count; i += 8)
 		{
-			return pool->Has(id);
-		}, shouldShrink);
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i));
+			const __m256i r = _mm256_and_si256(a, b);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), r);
+			any = _mm256_or_si256(any, r);
+		}
+		const bool anySet = !_mm256_testz_si256(any, any);
+		return AndWordsScalar(words + i, other + i, count - i) || anySet;
 	}
 
-	void ExcludeIdsWithout(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	static bool SupportsAVX2()
 	{
-		for (i32 i = ids.Size() - 1; i >= 0; --i)
+	#if defined(_MSC_VER)
+		i32 info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx     = (info[2] & (1 << 28)) != 0;
+		// The OS must also save the AVX registers
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+#endif
+
+	/**
+	 * ANDs other into words. Uses the widest instructions supported by the CPU.
+	 * @return true if any bit is still set
+	 */
+	static bool AndWords(u32* words, const u32* other, i32 count)
+	{
+#if P_ECS_SSE2
+		static const AndWordsFunc func = SupportsAVX2() ? &AndWordsAVX2 : &AndWordsSSE2;
+#else
+		static const AndWordsFunc func = &AndWordsScalar;
+#endif
+		return func(words, other, count);
+	}
+
+	/**
+	 * Adds ids from source contained in all pools. Source is read once, 32 ids at a time, and
+	 * each word is tested against the id bits of every pool while it is in registers. Only pools
+	 * without id bits are checked with HasIds, in blocks.
+	 */
+	static void AddIdsWithAll(
+	    TView<const IPool* const> pools, TView<const Id> source, TArray<Id>& results)
+	{
+		TArray<const ComponentPool*> bitPools;
+		TArray<const IPool*> otherPools;
+		for (const IPool* pool : pools)
 		{
-			if (!pool->Has(ids[i]))
+			if (pool->GetIdBits())
 			{
-				ids.RemoveAtSwapUnsafe(i);
+				// Only component pools have id bits
+				bitPools.Add(static_cast<const ComponentPool*>(pool));
+			}
+			else
+			{
+				otherPools.Add(pool);
 			}
 		}
-		if (shouldShrink == Shrink::Yes)
+
+		constexpr i32 blockSize  = 1024;
+		constexpr i32 blockWords = blockSize / 32;
+		u32 mask[blockWords];
+		BitArray poolMask;
+		for (i32 first = 0; first < source.Size(); first += blockSize)
 		{
-			ids.Shrink();
+			const TView<const Id> block{source.Data() + first, Min(blockSize, source.Size() - first)};
+			const i32 numWords = (block.Size() + 31) >> 5;
+
+			bool anySet = false;
+			for (i32 w = 0; w < numWords; ++w)
+			{
+				const Id* const ids = block.Data() + (w << 5);
+				const i32 count     = Min(32, block.Size() - (w << 5));
+				// Removed slots of a pool have no version
+				u32 word = 0;
+				for (i32 b = 0; b < count; ++b)
+				{
+					word |= u32(!IsNone(ids[b])) << b;
+				}
+				for (i32 i = 0; i < bitPools.Size() && word != 0; ++i)
+				{
+					word = bitPools[i]->FilterIdsWord(ids, word);
+				}
+				mask[w] = word;
+				anySet |= word != 0;
+			}
+
+			for (i32 i = 0; i < otherPools.Size() && anySet; ++i)
+			{
+				otherPools[i]->HasIds(block, poolMask);
+				anySet = AndWords(mask, poolMask.Data(), numWords);
+			}
+			if (!anySet)
+			{
+				continue;
+			}
+
+			for (i32 w = 0; w < numWords; ++w)
+			{
+				for (u32 word = mask[w]; word != 0; word &= word - 1)
+				{
+					results.Add(block[(w << 5) + std::countr_zero(word)]);
+				}
+			}
 		}
 	}
+#pragma endregion Intersection
 
-	void ExcludeIdsWithoutStable(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+
+	static bool IsMaskSet(const u32* words, i32 index)
 	{
-		ids.RemoveIf([pool](Id id)
-		{
-			return !pool->Has(id);
-		}, shouldShrink);
+		return (words[index >> 5] >> (index & 0x1f)) & 1u;
 	}
 
-	void ExcludeIdsWithoutAny(TView<const IPool* const> pools, TArray<Id>& ids, Shrink shouldShrink)
+	// Keeps ids that have 'value' on the mask. Guarantees order.
+	static void KeepIdsMasked(TArray<Id>& ids, const BitArray& mask, bool value, Shrink shouldShrink)
 	{
-		BitArray hasCounts(ids.Size());
-		for (auto* pool : pools)
+		const u32* const words = mask.Data();
+		Id* const data         = ids.Data();
+		i32 last               = 0;
+		for (i32 i = 0; i < ids.Size(); ++i)
 		{
-			for (i32 i = 0; i < ids.Size(); ++i)
+			if (IsMaskSet(words, i) == value)
 			{
-				if (!hasCounts.IsSet(i) && pool->Has(ids[i]))
-				{
-					hasCounts.SetTrue(i);
-				}
+				data[last++] = data[i];
 			}
 		}
+		ids.Resize(last, Shrink::No);
+		if (shouldShrink == Shrink::Yes)
+		{
+			ids.Shrink();
+		}
+	}
 
-		for (i32 i = ids.Size() - 1; i >= 0; --i)
+	// Adds ids from source that have 'value' on the mask to results
+	static void AddIdsMasked(
+	    TView<const Id> source, const BitArray& mask, bool value, TArray<Id>& results)
+	{
+		const u32* const words = mask.Data();
+		for (i32 i = 0; i < source.Size(); ++i)
 		{
-			if (hasCounts.IsSet(i))
+			if (IsMaskSet(words, i) == value)
 			{
-				ids.RemoveAtSwapUnsafe(i);
+				results.Add(source[i]);
 			}
 		}
 	}
 
-	void ExcludeIdsWithoutAnyStable(
-	    TView<const IPool* const> pools, TArray<Id>& ids, Shrink shouldShrink)
+	// Moves ids from source that have 'value' on the mask to results. Guarantees order.
+	static void ExtractIdsMasked(TArray<Id>& source, const BitArray& mask, bool value,
+	    TArray<Id>& results, Shrink shouldShrink)
 	{
-		BitArray hasCounts(ids.Size());
-		for (auto* pool : pools)
+		const u32* const words = mask.Data();
+		Id* const data         = source.Data();
+		i32 last               = 0;
+		for (i32 i = 0; i < source.Size(); ++i)
 		{
-			for (i32 i = 0; i < ids.Size(); ++i)
+			if (IsMaskSet(words, i) == value)
 			{
-				if (!hasCounts.IsSet(i) && pool->Has(ids[i]))
-				{
-					hasCounts.SetTrue(i);
-				}
+				results.Add(data[i]);
+			}
+			else
+			{
+				data[last++] = data[i];
 			}
 		}
+		source.Resize(last, Shrink::No);
+		if (shouldShrink == Shrink::Yes)
+		{
+			source.Shrink();
+		}
+	}
 
-		for (i32 i = ids.Size() - 1; i >= 0; --i)
+
+	void ExcludeIdsWith(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		ExcludeIdsWithStable(pool, ids, shouldShrink);
+	}
+
+	void ExcludeIdsWithStable(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		BitArray mask;
+		pool->HasIds(ids, mask);
+		KeepIdsMasked(ids, mask, false, shouldShrink);
+	}
+
+	void ExcludeIdsWithout(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		ExcludeIdsWithoutStable(pool, ids, shouldShrink);
+	}
+
+	void ExcludeIdsWithoutStable(const IPool* pool, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		BitArray mask;
+		pool->HasIds(ids, mask);
+		KeepIdsMasked(ids, mask, true, shouldShrink);
+	}
+
+	void ExcludeIdsWithoutAny(TView<const IPool* const> pools, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		ExcludeIdsWithoutAnyStable(pools, ids, shouldShrink);
+	}
+
+	void ExcludeIdsWithoutAnyStable(
+	    TView<const IPool* const> pools, TArray<Id>& ids, Shrink shouldShrink)
+	{
+		BitArray hasAny(ids.Size(), false);
+		BitArray mask;
+		for (auto* pool : pools)
 		{
-			if (hasCounts.IsSet(i))
+			if (pool)
 			{
-				ids.RemoveAtUnsafe(i);
+				pool->HasIds(ids, mask);
+				hasAny |= mask;
 			}
 		}
+		KeepIdsMasked(ids, hasAny, true, shouldShrink);
 	}
 
 	void FindIdsWith(const IPool* pool, TView<const Id> source, TArray<Id>& results)
@@ -911,28 +2211,21 @@ namespace p
 		if (pool) [[likely]]
 		{
 			results.ReserveMore(Min(i32(pool->Size()), source.Size()));
-			for (Id id : source)
-			{
-				if (pool->Has(id))
-				{
-					results.Add(id);
-				}
-			}
+			BitArray mask;
+			pool->HasIds(source, mask);
+			AddIdsMasked(source, mask, true, results);
 		}
 	}
 
 	void FindIdsWith(TView<const IPool* const> pools, TView<const Id> source, TArray<Id>& results)
 	{
-		const i32 smallestIdx     = GetSmallestPool(pools);
-		const IPool* smallestPool = pools[smallestIdx];
-		FindIdsWith(smallestPool, source, results);
-		for (i32 i = 0; i < pools.Size(); ++i)
+		const i32 smallestIdx = GetSmallestPool(pools);
+		if (smallestIdx == NO_INDEX || !pools[smallestIdx])
 		{
-			if (i != smallestIdx)
-			{
-				ExcludeIdsWithout(pools[i], results, Shrink::No);
-			}
+			return;
 		}
+		results.ReserveMore(Min(pools[smallestIdx]->Size(), source.Size()));
+		AddIdsWithAll(pools, source, results);
 	}
 
 	void FindIdsWithout(const IPool* pool, TView<const Id> source, TArray<Id>& results)
@@ -940,13 +2233,9 @@ namespace p
 		if (pool) [[likely]]
 		{
 			results.ReserveMore(source.Size());
-			for (Id id : source)
-			{
-				if (!pool->Has(id))
-				{
-					results.Add(id);
-				}
-			}
+			BitArray mask;
+			pool->HasIds(source, mask);
+			AddIdsMasked(source, mask, false, results);
 		}
 		else
 		{
@@ -958,69 +2247,94 @@ namespace p
 	void ExtractIdsWith(
 	    const IPool* pool, TArray<Id>& source, TArray<Id>& results, Shrink shouldShrink)
 	{
-		results.ReserveMore(Min(i32(pool->Size()), source.Size()));
-		for (i32 i = source.Size() - 1; i >= 0; --i)
-		{
-			const Id id = source[i];
-			if (pool->Has(id))
-			{
-				source.RemoveAtSwapUnsafe(i);
-				results.Add(id);
-			}
-		}
-		if (shouldShrink == Shrink::Yes)
-		{
-			source.Shrink();
-		}
+		ExtractIdsWithStable(pool, source, results, shouldShrink);
 	}
 
 	void ExtractIdsWithStable(
 	    const IPool* pool, TArray<Id>& source, TArray<Id>& results, Shrink shouldShrink)
 	{
 		results.ReserveMore(Min(i32(pool->Size()), source.Size()));
-		source.RemoveIf([pool, &results](Id id)
-		{
-			if (pool->Has(id))
-			{
-				results.Add(id);
-				return true;
-			}
-			return false;
-		}, shouldShrink);
+		BitArray mask;
+		pool->HasIds(source, mask);
+		ExtractIdsMasked(source, mask, true, results, shouldShrink);
 	}
 
 	void ExtractIdsWithout(
 	    const IPool* pool, TArray<Id>& source, TArray<Id>& results, Shrink shouldShrink)
+	{
+		ExtractIdsWithoutStable(pool, source, results, shouldShrink);
+	}
+
+	void ExtractIdsWithoutStable(
+	    const IPool* pool, TArray<Id>& source, TArray<Id>& results, Shrink shouldShrink)
 	{
 		results.ReserveMore(source.Size());
-		for (i32 i = source.Size() - 1; i >= 0; --i)
+		BitArray mask;
+		pool->HasIds(source, mask);
+		ExtractIdsMasked(source, mask, false, results, shouldShrink);
+	}
+
+	// Intersects the id bits of all pools a word at a time. Returns false if there are not enough
+	// pools with id bits or they are too sparse to be faster than iterating the smallest pool.
+	static bool FindAllIdsWithBits(
+	    TView<const IPool* const> pools, const IPool* iterablePool, TArray<Id>& ids)
+	{
+		TArray<const ComponentPool*> bitPools;
+		i32 numWords = Limits<i32>::Max();
+		for (const IPool* pool : pools)
 		{
-			const Id id = source[i];
-			if (!pool->Has(id))
+			if (const BitArray* bits = pool->GetIdBits())
 			{
-				source.RemoveAtSwapUnsafe(i);
-				results.Add(id);
+				// Only component pools have id bits
+				bitPools.Add(static_cast<const ComponentPool*>(pool));
+				numWords = Min(numWords, (bits->Size() + 31) >> 5);
 			}
 		}
-		if (shouldShrink == Shrink::Yes)
+		if (bitPools.Size() < 2 || numWords > iterablePool->Size())
 		{
-			source.Shrink();
+			return false;
 		}
-	}
 
-	void ExtractIdsWithoutStable(
-	    const IPool* pool, TArray<Id>& source, TArray<Id>& results, Shrink shouldShrink)
-	{
-		results.ReserveMore(Min(i32(pool->Size()), source.Size()));
-		source.RemoveIf([pool, &results](Id id)
+		TArray<u32> mask{bitPools[0]->GetIdBits()->Data(), numWords};
+		for (i32 i = 1; i < bitPools.Size(); ++i)
 		{
-			if (!pool->Has(id))
+			if (!AndWords(mask.Data(), bitPools[i]->GetIdBits()->Data(), numWords))
 			{
-				results.Add(id);
 				return true;
 			}
-			return false;
-		}, shouldShrink);
+		}
+
+		TArray<const IPool*> otherPools;
+		for (const IPool* pool : pools)
+		{
+			if (!pool->GetIdBits())
+			{
+				otherPools.Add(pool);
+			}
+		}
+		TArray<Id> bitIds;
+		TArray<Id>& candidates = otherPools.IsEmpty() ? ids : bitIds;
+
+		// Versions are taken from any of the pools. Components are removed with their ids, so all
+		// pools with the bit of an index set contain the same version.
+		const ComponentPool* idPool = bitPools[0];
+		const TArray<Id>& idList    = idPool->GetIdList();
+		candidates.Reserve(iterablePool->Size());
+		for (i32 w = 0; w < numWords; ++w)
+		{
+			for (u32 word = mask[w]; word != 0; word &= word - 1)
+			{
+				const Id::Index index = (w << 5) + std::countr_zero(word);
+				candidates.Add(idList[idPool->GetIndexFromId(index)]);
+			}
+		}
+
+		if (!otherPools.IsEmpty())
+		{
+			ids.Reserve(candidates.Size());
+			AddIdsWithAll(otherPools, candidates, ids);
+		}
+		return true;
 	}
 
 	void FindAllIdsWith(TView<const IPool* const> pools, TArray<Id>& ids)
@@ -1040,25 +2354,22 @@ namespace p
 			return;
 		}
 
-		ids.Reserve(iterablePool->Size());
-		for (Id id : *iterablePool)
+		if (FindAllIdsWithBits(pools, iterablePool, ids))
 		{
-			if (!IsNone(id)) [[likely]]
-			{
-				ids.Add(id);
-			}
+			return;
 		}
-		// Faster but doesn't exclude invalid ids.
-		// ids.Append(iterablePool->begin(), iterablePool->end());
 
+		TArray<const IPool*> otherPools;
+		otherPools.Reserve(pools.Size() - 1);
 		for (i32 i = 0; i < pools.Size(); ++i)
 		{
 			if (i != smallestIdx)
 			{
-				const IPool* pool = pools[i];
-				ExcludeIdsWithout(pool, ids, Shrink::No);
+				otherPools.Add(pools[i]);
 			}
 		}
+		ids.Reserve(iterablePool->Size());
+		AddIdsWithAll(otherPools, iterablePool->GetIdList(), ids);
 	}
 
 	void FindAllIdsWithAny(TView<const IPool* const> pools, TArray<Id>& ids)
@@ -1155,13 +2466,77 @@ namespace p
 	}
 
 
-	Id AddId(IdContext& ctx)
-	{
-		return ctx.GetIdRegistry().Create();
-	}
-	void AddId(IdContext& ctx, TView<Id> ids)
+	// Marks the hierarchy index dirty if it contains any of the ids
+	static void MarkIdHierarchyDirty(IdContext& ctx, TView<const Id> ids)
 	{
-		ctx.GetIdRegistry().Create(ids);
+		IdHierarchyIndex* hierarchy = ctx.TryGetStatic<IdHierarchyIndex>();
+		if (hierarchy && !hierarchy->IsDirty())
+		{
+			for (Id id : ids)
+			{
+				if (hierarchy->Has(id))
+				{
+					hierarchy->MarkDirty();
+					break;
+				}
+			}
+		}
+	}
+
+	// Removes ids from all pools. Big removals run isolated pools in parallel.
+	static void RemoveIdsFromPools(IdContext& ctx, TView<const Id> ids)
+	{
+		static constexpr i32 minParallelIds = 4096;
+		if (ids.IsEmpty())
+		{
+			return;
+		}
+		// The index may have been rebuilt since deferred ids were removed
+		MarkIdHierarchyDirty(ctx, ids);
+
+		Id::Index maxIndex = 0;
+		for (Id id : ids)
+		{
+			maxIndex = Max(maxIndex, id.GetIndex());
+		}
+		BitArray mask;
+		mask.Resize(i32(maxIndex) + 1, false);
+		for (Id id : ids)
+		{
+			mask.SetTrue(id.GetIndex());
+		}
+
+		TArray<IPool*> isolatedPools;
+		for (auto& instance : ctx.GetPools())
+		{
+			IPool* pool = instance.GetPool();
+			if (pool->Size() == 0)
+			{
+				continue;
+			}
+			if (ids.Size() >= minParallelIds && pool->IsIsolated())
+			{
+				isolatedPools.Add(pool);
+			}
+			else
+			{
+				pool->RemoveMasked(ids, mask);
+			}
+		}
+		GetDefaultWorkerPool().ParallelFor(
+		    isolatedPools.Size(), [&isolatedPools, ids, &mask](i32 i)
+		{
+			isolatedPools[i]->RemoveMasked(ids, mask);
+		});
+	}
+
+	Id AddId(IdContext& ctx)
+	{
+		return ctx.GetIdRegistry().Create();
+	}
+	void AddId(IdContext& ctx, TView<Id> ids)
+	{
+		ctx.GetIdRegistry().Create(ids);
 	}
 
 	bool RmId(IdContext& ctx, TView<const Id> ids, RmIdFlags flags)
@@ -1177,31 +2552,206 @@ namespace p
 
 		if (HasFlag(flags, p::RmIdFlags::Instant))
 		{
-			for (auto& pool : ctx.GetPools())
-			{
-				pool.GetPool()->Remove(ids);
-			}
+			RemoveIdsFromPools(ctx, ids);
 			return ctx.GetIdRegistry().RemoveInstant(ids);
 		}
 		else
 		{
+			MarkIdHierarchyDirty(ctx, ids);
 			return ctx.GetIdRegistry().Remove(ids);
 		}
 	}
 
 	bool FlushDeferredRemovals(IdContext& ctx)
 	{
-		TView<Id> ids = ctx.GetIdRegistry().GetDeferredRemovals();
-		for (auto& pool : ctx.GetPools())
+		RemoveIdsFromPools(ctx, ctx.GetIdRegistry().GetDeferredRemovals());
+		const bool flushed = ctx.GetIdRegistry().FlushDeferredRemovals();
+		if (ctx.GetAutoCompactRatio() > 0.f)
+		{
+			CompactPools(ctx, ctx.GetAutoCompactBudget(), ctx.GetAutoCompactRatio());
+		}
+		return flushed;
+	}
+
+	bool CompactPools(IdContext& ctx, Microseconds budget, float minRemovedRatio)
+	{
+		// Moves per step, so that the clock is not checked for every id
+		static constexpr i32 movesPerStep = 256;
+		const auto deadline = Chrono::steady_clock::now() + budget;
+		for (auto& instance : ctx.GetPools())
 		{
-			pool.GetPool()->Remove(ids);
+			IPool* pool = instance.GetPool();
+			if (pool->GetRemovedRatio() < minRemovedRatio)
+			{
+				continue;
+			}
+			while (!pool->CompactStep(movesPerStep))
+			{
+				if (Chrono::steady_clock::now() >= deadline)
+				{
+					return false;
+				}
+			}
 		}
-		return ctx.GetIdRegistry().FlushDeferredRemovals();
+		return true;
 	}
 
 
+	IdHierarchyIndex::IdHierarchyIndex(Arena& arena)
+	    : ids{arena}, parents{arena}, ends{arena}, levels{arena}, positions{arena}
+	{
+		positions.onPageAllocated = [](i32 index, i32* page, i32 size)
+		{
+			std::uninitialized_fill_n(page, size, NO_INDEX);
+		};
+	}
+
+	void IdHierarchyIndex::Update(TIdScopeRef<CParent> scope)
+	{
+		if (IsDirty())
+		{
+			std::unique_lock lock{rebuildMutex};
+			if (IsDirty())
+			{
+				Rebuild(scope);
+				dirty.store(false, std::memory_order_release);
+			}
+		}
+	}
+
+	void IdHierarchyIndex::Rebuild(TIdScopeRef<CParent> scope)
+	{
+		for (Id id : ids)
+		{
+			positions[id.GetIndex()] = NO_INDEX;
+		}
+		ids.Clear(Shrink::No);
+		parents.Clear(Shrink::No);
+		ends.Clear(Shrink::No);
+		levels.Clear(Shrink::No);
+		levelOrder.Clear(Shrink::No);
+		levelStarts.Clear(Shrink::No);
+
+		const auto* parentPool = scope.GetPool<const CParent>();
+		if (!parentPool)
+		{
+			return;
+		}
+
+		// Parents that are not children of another id are roots
+		BitArray isChild;
+		for (Id id : *parentPool)
+		{
+			if (IsNone(id))
+			{
+				continue;
+			}
+			for (Id child : parentPool->Get(id).children)
+			{
+				const i32 index = child.GetIndex();
+				if (index >= isChild.Size())
+				{
+					isChild.Resize(index + 1, false, Shrink::No);
+				}
+				isChild.SetTrue(index);
+			}
+		}
+
+		struct Pending
+		{
+			Id id;
+			i32 parent;
+		};
+		TArray<Pending> pending;
+		ids.Reserve(parentPool->Size());
+		for (Id root : *parentPool)
+		{
+			const i32 rootIndex = root.GetIndex();
+			if (IsNone(root) || (rootIndex < isChild.Size() && isChild.IsSet(rootIndex)))
+			{
+				continue;
+			}
+
+			// Children are pushed in reverse, so that each id is followed by its subtree
+			pending.Add({root, NO_INDEX});
+			while (!pending.IsEmpty())
+			{
+				const Pending next = pending.Last();
+				pending.RemoveLast(1, Shrink::No);
+				if (!P_EnsureMsg(!Has(next.id), "Found a cycle in the hierarchy"))
+				{
+					continue;
+				}
+
+				const i32 position = ids.Size();
+				positions.Reserve(next.id.GetIndex() + 1);
+				positions.Insert(next.id.GetIndex(), position);
+				ids.Add(next.id);
+				parents.Add(next.parent);
+				ends.Add(position + 1);
+				levels.Add(next.parent != NO_INDEX ? levels[next.parent] + 1 : 0);
+
+				if (const CParent* cParent = parentPool->TryGet(next.id))
+				{
+					for (i32 i = cParent->children.Size() - 1; i >= 0; --i)
+					{
+						pending.Add({cParent->children[i], position});
+					}
+				}
+			}
+		}
+
+		// Descendants are after their parents, so ends propagate backwards
+		for (i32 i = ids.Size() - 1; i >= 0; --i)
+		{
+			if (parents[i] != NO_INDEX)
+			{
+				ends[parents[i]] = Max(ends[parents[i]], ends[i]);
+			}
+		}
+
+		// Counting sort of positions by level
+		for (u32 level : levels)
+		{
+			if (i32(level) + 2 > levelStarts.Size())
+			{
+				levelStarts.Resize(level + 2, 0);
+			}
+			++levelStarts[level + 1];
+		}
+		for (i32 i = 1; i < levelStarts.Size(); ++i)
+		{
+			levelStarts[i] += levelStarts[i - 1];
+		}
+		TArray<i32> next{levelStarts};
+		levelOrder.Resize(ids.Size());
+		for (i32 i = 0; i < ids.Size(); ++i)
+		{
+			levelOrder[next[levels[i]]++] = i;
+		}
+	}
+
+	const IdHierarchyIndex* GetIdHierarchyIndex(TIdScopeRef<CParent> scope)
+	{
+		IdHierarchyIndex* index = scope.GetContext().TryGetStatic<IdHierarchyIndex>();
+		if (index)
+		{
+			index->Update(scope);
+		}
+		return index;
+	}
+
+	static void MarkIdHierarchyDirty(IdContext& ctx)
+	{
+		if (IdHierarchyIndex* index = ctx.TryGetStatic<IdHierarchyIndex>())
+		{
+			index->MarkDirty();
+		}
+	}
+
 	void AttachId(TIdScopeRef<Writes<CChild, CParent>> access, Id parent, TView<const Id> children)
 	{
+		MarkIdHierarchyDirty(access.GetContext());
 		// Assign parent to children
 		children.Each([&access, parent](Id childId)
 		{
@@ -1227,6 +2777,7 @@ namespace p
 	void AttachIdAfter(
 	    TIdScopeRef<Writes<CChild, CParent>> access, Id parent, TView<Id> childrenIds, Id prevChild)
 	{
+		MarkIdHierarchyDirty(access.GetContext());
 		// Assign parent to children
 		childrenIds.Each([&access, parent](Id child)
 		{
@@ -1260,6 +2811,7 @@ namespace p
 	void DetachIdParent(TIdScopeRef<Writes<CParent, CChild>> access, TView<const Id> childrenIds,
 	    bool keepComponents)
 	{
+		MarkIdHierarchyDirty(access.GetContext());
 		TArray<Id> parents;
 		parents.Reserve(childrenIds.Size());
 
@@ -1325,6 +2877,7 @@ namespace p
 	void DetachIdChildren(
 	    TIdScopeRef<Writes<CParent, CChild>> access, TView<const Id> parents, bool keepComponents)
 	{
+		MarkIdHierarchyDirty(access.GetContext());
 		if (keepComponents)
 		{
 			parents.Each([&access](Id parent)
@@ -1378,6 +2931,41 @@ namespace p
 	{
 		P_Check(depth > 0);
 
+		// A clean hierarchy index finds children without looking up pools. A dirty index is not
+		// rebuilt here, since many removals in a row would rebuild it each time.
+		const IdHierarchyIndex* index = access.GetContext().TryGetStatic<IdHierarchyIndex>();
+		if (index && !index->IsDirty())
+		{
+			// Same breadth-first order as walking the tree. The first child of a position is
+			// next to it, and each sibling starts where the subtree of the previous one ends.
+			const TView<const Id> ids   = index->GetIds();
+			const TView<const i32> ends = index->GetEndPositions();
+			TArray<i32> currentLinked{};
+			TArray<i32> pendingInspection;
+			for (Id parentId : parentIds)
+			{
+				const i32 position = index->GetPosition(parentId);
+				if (position != NO_INDEX)
+				{
+					pendingInspection.Add(position);
+				}
+			}
+			while (pendingInspection.Size() > 0 && depth > 0)
+			{
+				--depth;
+				for (i32 parent : pendingInspection)
+				{
+					for (i32 child = parent + 1; child < ends[parent]; child = ends[child])
+					{
+						outChildrenIds.Add(ids[child]);
+						currentLinked.Add(child);
+					}
+				}
+				pendingInspection = Move(currentLinked);
+			}
+			return;
+		}
+
 		TArray<Id> currentLinked{};
 		TArray<Id> pendingInspection;
 		pendingInspection.Append(parentIds);
@@ -1582,4 +3170,832 @@ namespace p
 		outRoots = FindAllIdsWith<CParent>(access);
 		ExcludeIdsWith<CChild>(access, outRoots);
 	}
+
+
+	static Box Union(const Box& a, const Box& b)
+	{
+		Box result = a;
+		result.Merge(b);
+		return result;
+	}
+
+	static float GetArea(const Box& box)
+	{
+		const v3 size = box.max - box.min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static bool Encloses(const Box& outer, const Box& inner)
+	{
+		return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y
+		    && outer.min.z <= inner.min.z && inner.max.x <= outer.max.x
+		    && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+	}
+
+	IdSpatialIndex::IdSpatialIndex(float margin, Arena& arena)
+	    : nodes{arena}, leafIds{arena}, leafBounds{arena}, leaves{arena}, margin{margin}
+	{
+		leaves.onPageAllocated = [](i32 index, i32* page, i32 size)
+		{
+			std::uninitialized_fill_n(page, size, NO_INDEX);
+		};
+	}
+
+	void IdSpatialIndex::Set(Id id, const Box& bounds)
+	{
+		const Id::Index index = id.GetIndex();
+		const i32 leaf        = GetLeaf(id);
+		if (leaf != NO_INDEX)
+		{
+			leafBounds[leaf] = bounds;
+			if (Encloses(nodes[leaf].bounds, bounds))
+			{
+				return;    // Moved inside its margin
+			}
+			RemoveLeaf(leaf);
+			nodes[leaf].bounds = bounds;
+			nodes[leaf].bounds.Expand(margin);
+			InsertLeaf(leaf);
+			return;
+		}
+
+		// An older version of the id may still be in the index
+		if (const i32* const oldLeaf = leaves.At(index); oldLeaf && *oldLeaf != NO_INDEX)
+		{
+			Remove(leafIds[*oldLeaf]);
+		}
+
+		const i32 newLeaf       = AllocateNode();
+		leafIds[newLeaf]        = id;
+		leafBounds[newLeaf]     = bounds;
+		nodes[newLeaf].bounds   = bounds;
+		nodes[newLeaf].bounds.Expand(margin);
+		leaves.Reserve(index + 1);
+		leaves.Insert(index, newLeaf);
+		InsertLeaf(newLeaf);
+		++numLeaves;
+	}
+
+	bool IdSpatialIndex::Remove(Id id)
+	{
+		const i32 leaf = GetLeaf(id);
+		if (leaf == NO_INDEX)
+		{
+			return false;
+		}
+		RemoveLeaf(leaf);
+		FreeNode(leaf);
+		leaves[id.GetIndex()] = NO_INDEX;
+		--numLeaves;
+		return true;
+	}
+
+	// Spreads the lower 10 bits of a value to every third bit
+	static u32 SpreadMortonBits(u32 value)
+	{
+		value = (value * 0x00010001u) & 0xFF0000FFu;
+		value = (value * 0x00000101u) & 0x0F00F00Fu;
+		value = (value * 0x00000011u) & 0xC30C30C3u;
+		value = (value * 0x00000005u) & 0x49249249u;
+		return value;
+	}
+
+	// Sorts keys by their higher 32 bits
+	static void RadixSortHigh(TArray<u64>& keys)
+	{
+		TArray<u64> buffer;
+		buffer.Resize(keys.Size());
+		u64* from = keys.Data();
+		u64* to   = buffer.Data();
+		for (u32 shift = 32; shift < 64; shift += 8)
+		{
+			i32 offsets[256]{};
+			for (i32 i = 0; i < keys.Size(); ++i)
+			{
+				++offsets[(from[i] >> shift) & 0xFF];
+			}
+			for (i32 i = 0, offset = 0; i < 256; ++i)
+			{
+				offset += Exchange(offsets[i], offset);
+			}
+			for (i32 i = 0; i < keys.Size(); ++i)
+			{
+				to[offsets[(from[i] >> shift) & 0xFF]++] = from[i];
+			}
+			Swap(from, to);
+		}
+	}
+
+	void IdSpatialIndex::Build(TView<const Id> ids, TView<const Box> bounds)
+	{
+		P_Check(ids.Size() == bounds.Size());
+		Clear();
+		if (ids.IsEmpty())
+		{
+			return;
+		}
+
+		// Leaves are sorted by the morton code of their center, so that leaves close in space are
+		// close in the tree and in memory
+		Box centers{bounds[0].GetCenter(), bounds[0].GetCenter()};
+		for (const Box& box : bounds)
+		{
+			centers.Merge(box.GetCenter());
+		}
+		const v3 size = centers.GetSize();
+		const v3 scale{1023.f / Max(size.x, smallNumber), 1023.f / Max(size.y, smallNumber),
+		    1023.f / Max(size.z, smallNumber)};
+		TArray<u64> keys;
+		keys.Reserve(ids.Size());
+		for (i32 i = 0; i < ids.Size(); ++i)
+		{
+			const v3 cell  = (bounds[i].GetCenter() - centers.min) * scale;
+			const u32 code = (SpreadMortonBits(u32(cell.x)) << 2)
+			               | (SpreadMortonBits(u32(cell.y)) << 1) | SpreadMortonBits(u32(cell.z));
+			keys.Add((u64(code) << 32) | u32(i));
+		}
+		RadixSortHigh(keys);
+
+		// A tree of N leaves has N - 1 inner nodes. Leaves go first, in the order of their keys.
+		const i32 numNodes = ids.Size() * 2 - 1;
+		nodes.Resize(numNodes);
+		leafIds.Resize(numNodes, NoId);
+		leafBounds.Resize(numNodes);
+		for (i32 leaf = 0; leaf < keys.Size(); ++leaf)
+		{
+			const i32 i        = i32(u32(keys[leaf]));
+			leafIds[leaf]      = ids[i];
+			leafBounds[leaf]   = bounds[i];
+			nodes[leaf].bounds = bounds[i];
+			nodes[leaf].bounds.Expand(margin);
+			const Id::Index index = ids[i].GetIndex();
+			leaves.Reserve(index + 1);
+			leaves.Insert(index, leaf);
+		}
+		numLeaves    = ids.Size();
+		i32 nextNode = numLeaves;
+		root         = BuildRange(keys.Data(), 0, keys.Size(), NO_INDEX, nextNode);
+	}
+
+	void IdSpatialIndex::Clear()
+	{
+		nodes.Clear();
+		leafIds.Clear();
+		leafBounds.Clear();
+		leaves.Clear();
+		root      = NO_INDEX;
+		freeNode  = NO_INDEX;
+		numLeaves = 0;
+	}
+
+	template<typename NodeTest, typename LeafTest>
+	void IdSpatialIndex::Find(NodeTest&& nodeTest, LeafTest&& leafTest, TArray<Id>& outIds) const
+	{
+		if (root == NO_INDEX)
+		{
+			return;
+		}
+		TArray<i32, 64> stack;
+		stack.Add(root);
+		while (!stack.IsEmpty())
+		{
+			const i32 index = stack.Last();
+			stack.RemoveLast(1, Shrink::No);
+			const Node& node = nodes[index];
+			if (!nodeTest(node.bounds))
+			{
+				continue;
+			}
+			if (node.height == 0)
+			{
+				if (leafTest(leafBounds[index]))
+				{
+					outIds.Add(leafIds[index]);
+				}
+			}
+			else
+			{
+				stack.Add(node.children[0]);
+				stack.Add(node.children[1]);
+			}
+		}
+	}
+
+	void IdSpatialIndex::FindOverlapping(const Box& bounds, TArray<Id>& outIds) const
+	{
+		auto overlaps = [&bounds](const Box& other)
+		{
+			return bounds.Overlaps(other);
+		};
+		Find(overlaps, overlaps, outIds);
+	}
+
+	void IdSpatialIndex::FindOverlapping(
+	    TView<const Box> bounds, TArray<TArray<Id>>& outIds, WorkerPool& workers) const
+	{
+		outIds.Resize(bounds.Size());
+		workers.ParallelFor(bounds.Size(), [this, bounds, &outIds](i32 i)
+		{
+			outIds[i].Clear(Shrink::No);
+			FindOverlapping(bounds[i], outIds[i]);
+		});
+	}
+
+	void IdSpatialIndex::FindInRadius(const v3& center, float radius, TArray<Id>& outIds) const
+	{
+		const float radiusSquared = radius * radius;
+		auto inRadius = [&center, radiusSquared](const Box& bounds)
+		{
+			float distanceSquared = 0.f;
+			for (u32 i = 0; i < 3; ++i)
+			{
+				const float offset =
+				    Max(Max(bounds.min[i] - center[i], center[i] - bounds.max[i]), 0.f);
+				distanceSquared += offset * offset;
+			}
+			return distanceSquared <= radiusSquared;
+		};
+		Find(inRadius, inRadius, outIds);
+	}
+
+	void IdSpatialIndex::FindOnRay(
+	    const v3& origin, const v3& direction, float maxDistance, TArray<Id>& outIds) const
+	{
+		const v3 inverse{1.f / direction.x, 1.f / direction.y, 1.f / direction.z};
+		auto hits = [&origin, &inverse, maxDistance](const Box& bounds)
+		{
+			float near = 0.f;
+			float far  = maxDistance;
+			for (u32 i = 0; i < 3; ++i)
+			{
+				const float t0 = (bounds.min[i] - origin[i]) * inverse[i];
+				const float t1 = (bounds.max[i] - origin[i]) * inverse[i];
+				near           = Max(near, Min(t0, t1));
+				far            = Min(far, Max(t0, t1));
+			}
+			return near <= far;
+		};
+		Find(hits, hits, outIds);
+	}
+
+	i32 IdSpatialIndex::AllocateNode()
+	{
+		i32 index;
+		if (freeNode != NO_INDEX)
+		{
+			index    = freeNode;
+			freeNode = nodes[index].parent;
+			nodes[index] = {};
+		}
+		else
+		{
+			index = nodes.Add({});
+			leafIds.Add(NoId);
+			leafBounds.Add({});
+		}
+		return index;
+	}
+
+	void IdSpatialIndex::FreeNode(i32 node)
+	{
+		nodes[node].parent = freeNode;
+		nodes[node].height = -1;
+		leafIds[node]      = NoId;
+		freeNode           = node;
+	}
+
+	void IdSpatialIndex::InsertLeaf(i32 leaf)
+	{
+		if (root == NO_INDEX)
+		{
+			root                = leaf;
+			nodes[leaf].parent = NO_INDEX;
+			return;
+		}
+
+		// Descend to the sibling that increases the total area the least
+		const Box bounds = nodes[leaf].bounds;
+		i32 sibling      = root;
+		while (nodes[sibling].height > 0)
+		{
+			const Node& node         = nodes[sibling];
+			const float area         = GetArea(node.bounds);
+			const float combinedArea = GetArea(Union(node.bounds, bounds));
+			// Cost of a new parent for this node and the leaf, and the cost pushed down to children
+			const float cost        = 2.f * combinedArea;
+			const float inheritance = 2.f * (combinedArea - area);
+			float childCosts[2];
+			for (i32 i = 0; i < 2; ++i)
+			{
+				const Box& childBounds = nodes[node.children[i]].bounds;
+				childCosts[i]          = GetArea(Union(childBounds, bounds)) + inheritance;
+				if (nodes[node.children[i]].height > 0)
+				{
+					childCosts[i] -= GetArea(childBounds);
+				}
+			}
+			if (cost < childCosts[0] && cost < childCosts[1])
+			{
+				break;
+			}
+			sibling = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+		}
+
+		const i32 oldParent = nodes[sibling].parent;
+		const i32 newParent = AllocateNode();
+		Node& parent        = nodes[newParent];
+		parent.parent       = oldParent;
+		parent.bounds       = Union(bounds, nodes[sibling].bounds);
+		parent.height       = nodes[sibling].height + 1;
+		parent.children[0]  = sibling;
+		parent.children[1]  = leaf;
+		if (oldParent != NO_INDEX)
+		{
+			i32* children = nodes[oldParent].children;
+			children[children[0] == sibling ? 0 : 1] = newParent;
+		}
+		else
+		{
+			root = newParent;
+		}
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent    = newParent;
+		Refit(nodes[newParent].parent);
+	}
+
+	void IdSpatialIndex::RemoveLeaf(i32 leaf)
+	{
+		if (leaf == root)
+		{
+			root = NO_INDEX;
+			return;
+		}
+
+		const i32 parent      = nodes[leaf].parent;
+		const i32 grandParent = nodes[parent].parent;
+		const i32* children   = nodes[parent].children;
+		const i32 sibling     = children[0] == leaf ? children[1] : children[0];
+		FreeNode(parent);
+		nodes[sibling].parent = grandParent;
+		if (grandParent != NO_INDEX)
+		{
+			i32* grandChildren = nodes[grandParent].children;
+			grandChildren[grandChildren[0] == parent ? 0 : 1] = sibling;
+			Refit(grandParent);
+		}
+		else
+		{
+			root = sibling;
+		}
+	}
+
+	void IdSpatialIndex::Refit(i32 index)
+	{
+		while (index != NO_INDEX)
+		{
+			index       = Balance(index);
+			Node& node  = nodes[index];
+			const Node& a = nodes[node.children[0]];
+			const Node& b = nodes[node.children[1]];
+			node.height   = 1 + Max(a.height, b.height);
+			node.bounds   = Union(a.bounds, b.bounds);
+			index         = node.parent;
+		}
+	}
+
+	i32 IdSpatialIndex::Balance(i32 iA)
+	{
+		// Rotates the taller child of A up when its height differs by more than 1 with the other
+		Node& a = nodes[iA];
+		if (a.height < 2)
+		{
+			return iA;
+		}
+
+		const i32 iB      = a.children[0];
+		const i32 iC      = a.children[1];
+		const i32 balance = nodes[iC].height - nodes[iB].height;
+		if (balance >= -1 && balance <= 1)
+		{
+			return iA;
+		}
+
+		// Side of A where the taller child (up) is, and the other child (stays)
+		const i32 side  = balance > 1 ? 1 : 0;
+		const i32 iUp   = a.children[side];
+		const i32 iStay = a.children[1 - side];
+		Node& up        = nodes[iUp];
+		const i32 iF    = up.children[0];
+		const i32 iG    = up.children[1];
+
+		// Up replaces A in its parent, and A becomes a child of up
+		up.children[0] = iA;
+		up.parent      = a.parent;
+		a.parent       = iUp;
+		if (up.parent != NO_INDEX)
+		{
+			i32* children = nodes[up.parent].children;
+			children[children[0] == iA ? 0 : 1] = iUp;
+		}
+		else
+		{
+			root = iUp;
+		}
+
+		// The taller grandchild stays with up, the shorter one moves to A
+		const bool fTaller = nodes[iF].height > nodes[iG].height;
+		const i32 iKeep    = fTaller ? iF : iG;
+		const i32 iMove    = fTaller ? iG : iF;
+		up.children[1]     = iKeep;
+		a.children[side]   = iMove;
+		nodes[iMove].parent = iA;
+
+		a.bounds  = Union(nodes[iStay].bounds, nodes[iMove].bounds);
+		a.height  = 1 + Max(nodes[iStay].height, nodes[iMove].height);
+		up.bounds = Union(a.bounds, nodes[iKeep].bounds);
+		up.height = 1 + Max(a.height, nodes[iKeep].height);
+		return iUp;
+	}
+
+	i32 IdSpatialIndex::BuildRange(
+	    const u64* keys, i32 first, i32 count, i32 parent, i32& nextNode)
+	{
+		if (count == 1)
+		{
+			nodes[first].parent = parent;    // Leaf nodes are sorted like keys
+			return first;
+		}
+
+		// Split where the highest bit that differs between codes of the range changes
+		const u32 firstCode = u32(keys[first] >> 32);
+		const u32 lastCode  = u32(keys[first + count - 1] >> 32);
+		i32 half            = count / 2;
+		if (firstCode != lastCode)
+		{
+			const u64 bit    = u64(1) << (31 + std::bit_width(firstCode ^ lastCode));
+			const u64* split = std::partition_point(
+			    keys + first, keys + first + count, [bit](u64 key)
+			{
+				return (key & bit) == 0;
+			});
+			half = i32(split - (keys + first));
+		}
+
+		const i32 index  = nextNode++;
+		const i32 a      = BuildRange(keys, first, half, index, nextNode);
+		const i32 b      = BuildRange(keys, first + half, count - half, index, nextNode);
+		Node& node       = nodes[index];
+		node.parent      = parent;
+		node.children[0] = a;
+		node.children[1] = b;
+		node.bounds      = Union(nodes[a].bounds, nodes[b].bounds);
+		node.height      = 1 + Max(nodes[a].height, nodes[b].height);
+		return index;
+	}
+
+
+	// Checks if two sorted lists share any type
+	static bool Intersect(TView<const TypeId> a, TView<const TypeId> b)
+	{
+		i32 i = 0, j = 0;
+		while (i < a.Size() && j < b.Size())
+		{
+			if (a[i] == b[j])
+			{
+				return true;
+			}
+			a[i] < b[j] ? ++i : ++j;
+		}
+		return false;
+	}
+
+	static bool Conflict(TView<const TypeId> aReads, TView<const TypeId> aWrites,
+	    TView<const TypeId> bReads, TView<const TypeId> bWrites)
+	{
+		return Intersect(aWrites, bWrites) || Intersect(aWrites, bReads)
+		    || Intersect(aReads, bWrites);
+	}
+
+	bool SystemScheduler::Conflict(const System& a, const System& b)
+	{
+		return p::Conflict(a.reads, a.writes, b.reads, b.writes);
+	}
+
+	i32 SystemScheduler::AddSystem(System&& system)
+	{
+		system.reads.Sort();
+		system.writes.Sort();
+		system.dependents.Clear();
+		system.numDependencies = 0;
+
+		const i32 index = systems.Size();
+		for (i32 i = 0; i < index; ++i)
+		{
+			System& other = systems[i];
+			if (Conflict(other, system))
+			{
+				other.dependents.Add(index);
+				++system.numDependencies;
+			}
+		}
+		systems.Add(Move(system));
+		return index;
+	}
+
+	void SystemScheduler::Run(IdContext& ctx, WorkerPool& workers)
+	{
+		if (systems.IsEmpty())
+		{
+			return;
+		}
+
+		// Pools can't be created while systems run in parallel
+		for (System& system : systems)
+		{
+			system.prepare(ctx);
+		}
+
+		TArray<i32> remainingDependencies;
+		remainingDependencies.Reserve(systems.Size());
+		for (const System& system : systems)
+		{
+			remainingDependencies.Add(system.numDependencies);
+		}
+
+		// Writes to pools of queries or groups are extended to all their pools. Systems that
+		// only conflict because of them depend on each other here.
+		TArray<TArray<TypeId>> linkedWrites;
+		linkedWrites.Resize(systems.Size());
+		bool anyLinked = false;
+		for (i32 i = 0; i < systems.Size(); ++i)
+		{
+			linkedWrites[i] = systems[i].writes;
+			for (TypeId typeId : systems[i].writes)
+			{
+				ctx.AddLinkedTypeIds(typeId, linkedWrites[i]);
+			}
+			anyLinked |= linkedWrites[i].Size() != systems[i].writes.Size();
+		}
+		TArray<TArray<i32>> linkedDependents;
+		linkedDependents.Resize(systems.Size());
+		if (anyLinked)
+		{
+			for (i32 i = 0; i < systems.Size(); ++i)
+			{
+				for (i32 j = i + 1; j < systems.Size(); ++j)
+				{
+					if (!Conflict(systems[i], systems[j])
+					    && p::Conflict(systems[i].reads, linkedWrites[i], systems[j].reads,
+					        linkedWrites[j]))
+					{
+						linkedDependents[i].Add(j);
+						++remainingDependencies[j];
+					}
+				}
+			}
+		}
+
+		std::atomic<i32> pending{systems.Size()};
+		std::function<void(i32)> runSystem;
+		// Pending is decremented once runSystem returned, so it outlives all calls to it
+		auto enqueueSystem = [&workers, &runSystem, &pending](i32 index)
+		{
+			workers.Enqueue([&workers, &runSystem, &pending, index]()
+			{
+				runSystem(index);
+				workers.CompleteTask(pending);
+			});
+		};
+		runSystem = [this, &ctx, &remainingDependencies, &linkedDependents, &enqueueSystem](
+		                i32 index)
+		{
+			auto releaseDependent = [&remainingDependencies, &enqueueSystem](i32 dependent)
+			{
+				std::atomic_ref<i32> remaining{remainingDependencies[dependent]};
+				if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					enqueueSystem(dependent);
+				}
+			};
+
+			System& system = systems[index];
+			system.run(ctx);
+			for (i32 dependent : system.dependents)
+			{
+				releaseDependent(dependent);
+			}
+			for (i32 dependent : linkedDependents[index])
+			{
+				releaseDependent(dependent);
+			}
+		};
+
+		// Running systems update remainingDependencies, so roots are found before enqueuing
+		TArray<i32> roots;
+		for (i32 i = 0; i < systems.Size(); ++i)
+		{
+			if (remainingDependencies[i] == 0)
+			{
+				roots.Add(i);
+			}
+		}
+		for (i32 root : roots)
+		{
+			enqueueSystem(root);
+		}
+		workers.WaitUntilDone(pending);
+	}
+
+
+	void IdCommandBuffer::PoolCommands::SortAndCollapse()
+	{
+		p::Sort(commands.Data(), commands.Size(), [](const Command& a, const Command& b)
+		{
+			return a.id < b.id || (a.id == b.id && a.order < b.order);
+		});
+
+		// Keep the last command of each id
+		i32 last = 0;
+		for (i32 i = 1; i < commands.Size(); ++i)
+		{
+			if (commands[i].id != commands[last].id)
+			{
+				++last;
+			}
+			commands[last] = commands[i];
+		}
+		commands.Resize(last + 1, Shrink::No);
+	}
+
+	void IdCommandBuffer::Apply()
+	{
+		for (auto& commands : pools)
+		{
+			commands->Apply(*context);
+		}
+
+		if (rmIds.IsEmpty())
+		{
+			return;
+		}
+
+		// Ids are grouped by flags to remove each group at once
+		p::Sort(rmIds.Data(), rmIds.Size(), [](const RmIdCommand& a, const RmIdCommand& b)
+		{
+			return a.flags < b.flags || (a.flags == b.flags && a.id < b.id);
+		});
+		const IdRegistry& registry = context->GetIdRegistry();
+		TArray<Id> ids;
+		ids.Reserve(rmIds.Size());
+		for (i32 i = 0; i < rmIds.Size();)
+		{
+			const RmIdFlags flags = rmIds[i].flags;
+			ids.Clear(Shrink::No);
+			for (; i < rmIds.Size() && rmIds[i].flags == flags; ++i)
+			{
+				const Id id = rmIds[i].id;
+				// Ids may have been removed by other commands
+				if ((ids.IsEmpty() || ids.Last() != id) && registry.IsValid(id))
+				{
+					ids.Add(id);
+				}
+			}
+			p::RmId(*context, ids, flags);
+		}
+		rmIds.Clear(Shrink::No);
+	}
+
+	void IdCommandBuffer::Apply(TView<IdCommandBuffer* const> buffers)
+	{
+		if (buffers.IsEmpty())
+		{
+			return;
+		}
+
+		// Merge all commands into the first buffer so that each pool is touched once
+		IdCommandBuffer& target = *buffers[0];
+		for (i32 i = 1; i < buffers.Size(); ++i)
+		{
+			P_Check(buffers[i]->context == target.context);
+			target.Append(*buffers[i]);
+		}
+		target.Apply();
+	}
+
+	void IdCommandBuffer::Clear()
+	{
+		for (auto& commands : pools)
+		{
+			commands->Clear();
+		}
+		rmIds.Clear(Shrink::No);
+	}
+
+	bool IdCommandBuffer::IsEmpty() const
+	{
+		for (const auto& commands : pools)
+		{
+			if (!commands->commands.IsEmpty())
+			{
+				return false;
+			}
+		}
+		return rmIds.IsEmpty();
+	}
+
+	void IdCommandBuffer::Append(IdCommandBuffer& other)
+	{
+		for (i32 i = 0; i < other.pools.Size(); ++i)
+		{
+			PoolCommands& otherCommands = *other.pools[i].Get();
+			if (otherCommands.commands.IsEmpty())
+			{
+				continue;
+			}
+
+			const i32 index = pools.FindIndexIf([&otherCommands](const auto& commands)
+			{
+				return commands->typeId == otherCommands.typeId;
+			});
+			if (index != NO_INDEX)
+			{
+				pools[index]->Append(otherCommands);
+			}
+			else
+			{
+				pools.Add(Move(other.pools[i]));
+				other.pools.RemoveAtSwapUnsafe(i, Shrink::No);
+				--i;
+			}
+		}
+
+		rmIds.Append(other.rmIds);
+		other.rmIds.Clear(Shrink::No);
+	}
+
+
+	IdCommandBuffers::IdCommandBuffers(IdContext& ctx) : context{&ctx}
+	{
+		static std::atomic<u64> lastUniqueId{0};
+		uniqueId = ++lastUniqueId;
+	}
+
+	IdCommandBuffer& IdCommandBuffers::Get()
+	{
+		struct CachedBuffer
+		{
+			u64 ownerId             = 0;
+			IdCommandBuffer* buffer = nullptr;
+		};
+		// Avoids locking when a thread records many times on the same buffers
+		static thread_local CachedBuffer cached;
+		if (cached.ownerId == uniqueId)
+		{
+			return *cached.buffer;
+		}
+
+		std::unique_lock lock{buffersMutex};
+		const std::thread::id threadId = std::this_thread::get_id();
+		i32 index = threadIds.FindIndex(threadId);
+		if (index == NO_INDEX)
+		{
+			threadIds.Add(threadId);
+			index = buffers.Add(MakeUnique<IdCommandBuffer>(*context));
+		}
+		cached = {uniqueId, buffers[index].Get()};
+		return *cached.buffer;
+	}
+
+	void IdCommandBuffers::Apply()
+	{
+		std::unique_lock lock{buffersMutex};
+		TArray<IdCommandBuffer*> allBuffers;
+		allBuffers.Reserve(buffers.Size());
+		for (auto& buffer : buffers)
+		{
+			allBuffers.Add(buffer.Get());
+		}
+		IdCommandBuffer::Apply(allBuffers);
+	}
+
+	void IdCommandBuffers::Clear()
+	{
+		std::unique_lock lock{buffersMutex};
+		for (auto& buffer : buffers)
+		{
+			buffer->Clear();
+		}
+	}
+
+	bool IdCommandBuffers::IsEmpty() const
+	{
+		for (const auto& buffer : buffers)
+		{
+			if (!buffer->IsEmpty())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
 }    // namespace p
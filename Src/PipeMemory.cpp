@@ -10,6 +10,10 @@
 
 #if P_PLATFORM_WINDOWS
 	#include <malloc.h>    // _aligned_malloc, _aligned_free, _aligned_realloc
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
 #endif
 
 
@@ -103,8 +107,12 @@ namespace p
 
 
 #pragma region Allocation
-	static Arena* currentArena = nullptr;
-	static TArray<Arena*> arenaStack;
+	// Each thread has its own stack of current arenas. The heap arena is used when empty.
+	// A fixed array, since a TArray would allocate from the current arena itself.
+	// Pushes past its size are counted but not stored, keeping the last stored arena current.
+	static constexpr i32 maxArenaStackSize = 64;
+	static thread_local Arena* arenaStack[maxArenaStackSize];
+	static thread_local i32 arenaStackSize = 0;
 
 	void InitializeMemory()
 	{
@@ -152,6 +160,106 @@ namespace p
 #endif
 	}
 
+	sizet GetVirtualPageSize()
+	{
+#if P_PLATFORM_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+#else
+		static const sizet pageSize = sizet(sysconf(_SC_PAGESIZE));
+		return pageSize;
+#endif
+	}
+
+	void* ReserveVirtualMem(sizet size, sizet align)
+	{
+#if P_PLATFORM_WINDOWS
+		// Reservations are always aligned to the allocation granularity
+		if (align <= GetVirtualPageSize())
+		{
+			return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+		}
+		// Find an aligned address and reserve it. Another thread could take it in between.
+		for (i32 attempt = 0; attempt < 8; ++attempt)
+		{
+			void* ptr = VirtualAlloc(nullptr, size + align, MEM_RESERVE, PAGE_NOACCESS);
+			if (!ptr)
+			{
+				return nullptr;
+			}
+			VirtualFree(ptr, 0, MEM_RELEASE);
+			u8* const aligned = static_cast<u8*>(ptr) + GetAlignmentPadding(ptr, align);
+			if (void* result = VirtualAlloc(aligned, size, MEM_RESERVE, PAGE_NOACCESS))
+			{
+				return result;
+			}
+		}
+		return nullptr;
+#else
+		if (align <= GetVirtualPageSize())
+		{
+			void* ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			    -1, 0);
+			return ptr != MAP_FAILED ? ptr : nullptr;
+		}
+
+		// Reserve extra space and unmap what is outside the aligned range
+		void* ptr = mmap(nullptr, size + align, PROT_NONE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (ptr == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		u8* const start   = static_cast<u8*>(ptr);
+		u8* const aligned = start + GetAlignmentPadding(start, align);
+		if (aligned > start)
+		{
+			munmap(start, aligned - start);
+		}
+		munmap(aligned + size, (start + size + align) - (aligned + size));
+		return aligned;
+#endif
+	}
+
+	bool CommitVirtualMem(void* ptr, sizet size, bool hugePages)
+	{
+#if P_PLATFORM_WINDOWS
+		return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+		if (mprotect(ptr, size, PROT_READ | PROT_WRITE) != 0)
+		{
+			return false;
+		}
+	#if defined(MADV_HUGEPAGE)
+		if (hugePages)
+		{
+			madvise(ptr, size, MADV_HUGEPAGE);
+		}
+	#endif
+		return true;
+#endif
+	}
+
+	void DecommitVirtualMem(void* ptr, sizet size)
+	{
+#if P_PLATFORM_WINDOWS
+		VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+		madvise(ptr, size, MADV_DONTNEED);
+		mprotect(ptr, size, PROT_NONE);
+#endif
+	}
+
+	void FreeVirtualMem(void* ptr, sizet size)
+	{
+#if P_PLATFORM_WINDOWS
+		VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+		munmap(ptr, size);
+#endif
+	}
+
 
 	HeapArena& GetHeapArena()
 	{
@@ -161,28 +269,25 @@ namespace p
 
 	Arena& GetCurrentArena()
 	{
-		return currentArena ? *currentArena : GetHeapArena();
+		return arenaStackSize > 0 ? *arenaStack[Min(arenaStackSize, maxArenaStackSize) - 1]
+		                          : GetHeapArena();
 	}
 
 	void PushCurrentArena(Arena& arena)
 	{
-		if (currentArena)
+		if (P_EnsureMsg(arenaStackSize < maxArenaStackSize, "Too many current arenas pushed"))
 		{
-			arenaStack.Add(currentArena);
+			arenaStack[arenaStackSize] = &arena;
 		}
-		currentArena = &arena;
+		// Still counted, so that its pop doesn't remove another arena
+		++arenaStackSize;
 	}
 
 	void PopCurrentArena()
 	{
-		if (!arenaStack.IsEmpty())
-		{
-			currentArena = arenaStack.Last();
-			arenaStack.RemoveLast();
-		}
-		else
+		if (arenaStackSize > 0)
 		{
-			currentArena = nullptr;
+			--arenaStackSize;
 		}
 	}
 
@@ -2,10 +2,300 @@
 
 #include "PipeMemoryArenas.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <mutex>
+
 
 namespace p
 {
 #pragma region Heap Arena
+	// Small allocations of all heap arenas are cached per thread, by size class.
+	// Classes are 16 bytes apart up to 128, then 4 classes per power of two up to 2048.
+	static constexpr i32 numHeapClasses = 24;
+	// Bytes carved from the heap at once when a class has no free blocks
+	static constexpr sizet heapSpanSize = 16 * 1024;
+	// Bytes of each class a thread keeps before returning half to the central lists
+	static constexpr sizet maxThreadCachedSize = 64 * 1024;
+
+	struct HeapBlock
+	{
+		HeapBlock* next;
+	};
+
+	static constexpr sizet GetHeapClassSize(i32 index)
+	{
+		if (index < 8)
+		{
+			return sizet(index + 1) * 16;
+		}
+		const i32 group = (index - 8) / 4;
+		return (sizet(128) << group) + sizet((index - 8) % 4 + 1) * (sizet(32) << group);
+	}
+	static_assert(GetHeapClassSize(numHeapClasses - 1) == HeapArena::maxCachedSize);
+
+	// Blocks of each class a thread keeps, to avoid dividing on every free
+	static constexpr auto heapClassMaxCounts = []() {
+		std::array<u32, numHeapClasses> counts{};
+		for (i32 index = 0; index < numHeapClasses; ++index)
+		{
+			counts[index] = u32(maxThreadCachedSize / GetHeapClassSize(index));
+		}
+		return counts;
+	}();
+
+	static i32 GetHeapClass(sizet size)
+	{
+		if (size <= 128)
+		{
+			return size > 0 ? i32((size + 15) / 16) - 1 : 0;
+		}
+		const sizet last  = size - 1;
+		const i32 highBit = i32(std::bit_width(last)) - 1;
+		return 8 + (highBit - 7) * 4 + i32((last >> (highBit - 2)) & 3);
+	}
+
+	// Blocks freed by threads that cached too many, or that finished.
+	// Lists are pushed with a CAS, and taken whole with an exchange, so that there is no ABA.
+	static std::atomic<HeapBlock*> heapCentralLists[numHeapClasses];
+
+	static void PushHeapCentralList(i32 index, HeapBlock* first, HeapBlock* last)
+	{
+		HeapBlock* head = heapCentralLists[index].load(std::memory_order_relaxed);
+		do
+		{
+			last->next = head;
+		} while (!heapCentralLists[index].compare_exchange_weak(
+		    head, first, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// Spans carved from the heap for each class, so that Trim() can find the ones fully free.
+	// Never destroyed, since memory can be freed after static destruction.
+	struct HeapSpans
+	{
+		u8** data    = nullptr;
+		i32 size     = 0;
+		i32 capacity = 0;
+	};
+	static HeapSpans heapSpans[numHeapClasses];
+
+	static std::mutex& GetHeapSpansMutex()
+	{
+		alignas(std::mutex) static u8 storage[sizeof(std::mutex)];
+		static std::mutex* mutex = new (storage) std::mutex();
+		return *mutex;
+	}
+
+	static u8* AllocHeapSpan(i32 index)
+	{
+		const sizet blockSize = GetHeapClassSize(index);
+		u8* const span        = static_cast<u8*>(p::HeapAlloc(heapSpanSize / blockSize * blockSize));
+		std::scoped_lock lock{GetHeapSpansMutex()};
+		HeapSpans& spans = heapSpans[index];
+		if (spans.size == spans.capacity)
+		{
+			const i32 newCapacity = Max(spans.capacity * 2, 16);
+			auto** const newData  = static_cast<u8**>(p::HeapAlloc(newCapacity * sizeof(u8*)));
+			std::copy_n(spans.data, spans.size, newData);
+			p::HeapFree(spans.data);
+			spans.data     = newData;
+			spans.capacity = newCapacity;
+		}
+		spans.data[spans.size++] = span;
+		return span;
+	}
+
+	struct HeapThreadCache
+	{
+		HeapBlock* lists[numHeapClasses]{};
+		u32 counts[numHeapClasses]{};
+		// Set when the thread finishes. Blocks are then freed directly to the central lists.
+		bool flushed = false;
+
+		~HeapThreadCache()
+		{
+			Flush();
+			flushed = true;
+		}
+
+		// Returns all blocks to the central lists
+		void Flush()
+		{
+			for (i32 index = 0; index < numHeapClasses; ++index)
+			{
+				if (counts[index] > 0)
+				{
+					Release(index, counts[index]);
+				}
+			}
+		}
+
+		void* Pop(i32 index)
+		{
+			HeapBlock* block = lists[index];
+			if (!block) [[unlikely]]
+			{
+				if (flushed)
+				{
+					return p::HeapAlloc(GetHeapClassSize(index));
+				}
+				block = Refill(index);
+			}
+			lists[index] = block->next;
+			--counts[index];
+			return block;
+		}
+
+		void Push(i32 index, void* ptr)
+		{
+			auto* block = static_cast<HeapBlock*>(ptr);
+			if (flushed) [[unlikely]]
+			{
+				PushHeapCentralList(index, block, block);
+				return;
+			}
+			block->next  = lists[index];
+			lists[index] = block;
+			if (++counts[index] > heapClassMaxCounts[index]) [[unlikely]]
+			{
+				Release(index, counts[index] / 2);
+			}
+		}
+
+		// Takes all blocks freed to the central list, or carves a new span
+		HeapBlock* Refill(i32 index);
+
+		void Release(i32 index, u32 count)
+		{
+			HeapBlock* const first = lists[index];
+			HeapBlock* last        = first;
+			for (u32 i = 1; i < count; ++i)
+			{
+				last = last->next;
+			}
+			lists[index] = last->next;
+			counts[index] -= count;
+			PushHeapCentralList(index, first, last);
+		}
+	};
+
+	// Built with -ftls-model=initial-exec (see CMakeLists.txt)
+	static thread_local HeapThreadCache heapThreadCache;
+
+	HeapBlock* HeapThreadCache::Refill(i32 index)
+	{
+		HeapBlock* first = heapCentralLists[index].exchange(nullptr, std::memory_order_acquire);
+		u32 count = 0;
+		if (first)
+		{
+			for (HeapBlock* block = first; block; block = block->next)
+			{
+				++count;
+			}
+		}
+		else
+		{
+			const sizet blockSize = GetHeapClassSize(index);
+			count                 = u32(heapSpanSize / blockSize);
+			u8* const span        = AllocHeapSpan(index);
+			for (u32 i = 0; i < count; ++i)
+			{
+				reinterpret_cast<HeapBlock*>(span + i * blockSize)->next =
+				    i + 1 < count ? reinterpret_cast<HeapBlock*>(span + (i + 1) * blockSize)
+				                  : nullptr;
+			}
+			first = reinterpret_cast<HeapBlock*>(span);
+		}
+		lists[index] = first;
+		counts[index] += count;
+		return first;
+	}
+
+	// Frees the spans of a class with all their blocks in the central list
+	static sizet TrimHeapClass(i32 index)
+	{
+		HeapBlock* first = heapCentralLists[index].exchange(nullptr, std::memory_order_acquire);
+		if (!first)
+		{
+			return 0;
+		}
+		i32 numBlocks = 0;
+		for (HeapBlock* block = first; block; block = block->next)
+		{
+			++numBlocks;
+		}
+		auto** const blocks = static_cast<HeapBlock**>(p::HeapAlloc(numBlocks * sizeof(void*)));
+		numBlocks           = 0;
+		for (HeapBlock* block = first; block; block = block->next)
+		{
+			blocks[numBlocks++] = block;
+		}
+		std::sort(blocks, blocks + numBlocks, TLess<>());
+
+		const sizet blockSize = GetHeapClassSize(index);
+		const i32 spanBlocks  = i32(heapSpanSize / blockSize);
+		HeapSpans& spans      = heapSpans[index];
+		std::sort(spans.data, spans.data + spans.size, TLess<>());
+
+		// Blocks that are kept are linked again while walking the sorted spans
+		HeapBlock* kept = nullptr;
+		auto keep       = [&kept](HeapBlock* block)
+		{
+			block->next = kept;
+			kept        = block;
+		};
+		sizet freedSize = 0;
+		i32 numSpans    = 0;
+		i32 next        = 0;
+		for (i32 i = 0; i < spans.size; ++i)
+		{
+			u8* const span = spans.data[i];
+			for (; next < numBlocks && reinterpret_cast<u8*>(blocks[next]) < span; ++next)
+			{
+				keep(blocks[next]);
+			}
+			const i32 spanFirst = next;
+			u8* const spanEnd   = span + spanBlocks * blockSize;
+			while (next < numBlocks && reinterpret_cast<u8*>(blocks[next]) < spanEnd)
+			{
+				++next;
+			}
+
+			if (next - spanFirst == spanBlocks)
+			{
+				p::HeapFree(span);
+				freedSize += spanBlocks * blockSize;
+			}
+			else
+			{
+				for (i32 b = spanFirst; b < next; ++b)
+				{
+					keep(blocks[b]);
+				}
+				spans.data[numSpans++] = span;
+			}
+		}
+		spans.size = numSpans;
+		for (; next < numBlocks; ++next)
+		{
+			keep(blocks[next]);
+		}
+		p::HeapFree(blocks);
+
+		if (kept)
+		{
+			HeapBlock* last = kept;
+			while (last->next)
+			{
+				last = last->next;
+			}
+			PushHeapCentralList(index, kept, last);
+		}
+		return freedSize;
+	}
+
+
 	HeapArena::HeapArena()
 	{
 		stats.name = "Heap";
@@ -14,13 +304,28 @@ namespace p
 
 	void* HeapArena::Alloc(const sizet size)
 	{
-		void* ptr = p::HeapAlloc(size);
+		void* ptr = size <= maxCachedSize ? heapThreadCache.Pop(GetHeapClass(size))
+		                                  : p::HeapAlloc(size);
 		stats.Add(ptr, size);
 		return ptr;
 	}
 	void* HeapArena::Alloc(const sizet size, const sizet align)
 	{
-		void* ptr = p::HeapAlloc(size, align);
+		void* ptr;
+		if (size > maxCachedSize)
+		{
+			ptr = p::HeapAlloc(size, align);
+		}
+		else if (align <= maxCachedAlign)
+		{
+			ptr = heapThreadCache.Pop(GetHeapClass(size));
+		}
+		else
+		{
+			// Freed blocks are cached by size only, so they need to fit their class
+			const sizet classSize = GetHeapClassSize(GetHeapClass(size));
+			ptr = p::HeapAlloc((classSize + align - 1) & ~(align - 1), align);
+		}
 		stats.Add(ptr, size);
 		return ptr;
 	}
@@ -31,7 +336,26 @@ namespace p
 	void HeapArena::Free(void* ptr, sizet size)
 	{
 		stats.Remove(ptr, size);
-		p::HeapFree(ptr);
+		if (ptr && size <= maxCachedSize)
+		{
+			heapThreadCache.Push(GetHeapClass(size), ptr);
+		}
+		else
+		{
+			p::HeapFree(ptr);
+		}
+	}
+
+	sizet HeapArena::Trim()
+	{
+		heapThreadCache.Flush();
+		std::scoped_lock lock{GetHeapSpansMutex()};
+		sizet freedSize = 0;
+		for (i32 index = 0; index < numHeapClasses; ++index)
+		{
+			freedSize += TrimHeapClass(index);
+		}
+		return freedSize;
 	}
 #pragma endregion Heap Arena
 
@@ -110,6 +434,67 @@ namespace p
 	}
 #pragma endregion Mono Linear
 
+#pragma region Virtual Linear
+	VirtualLinearArena::VirtualLinearArena(
+	    sizet reserveSize, bool useHugePages, sizet minCommitSize)
+	    : hugePages{useHugePages}
+	{
+		stats.name = "Virtual Linear Arena";
+		Interface<VirtualLinearArena>();
+
+		const sizet pageSize = hugePages ? hugePageSize : GetVirtualPageSize();
+		commitSize           = (Max(minCommitSize, pageSize) + pageSize - 1) & ~(pageSize - 1);
+		reservedSize         = (reserveSize + commitSize - 1) / commitSize * commitSize;
+		// Huge pages can only back ranges aligned to their size
+		data = static_cast<u8*>(ReserveVirtualMem(reservedSize, hugePages ? hugePageSize : 0));
+		P_EnsureMsg(data, "Couldn't reserve virtual memory");
+		if (!data)
+		{
+			reservedSize = 0;
+		}
+		insert       = data;
+		committedEnd = data;
+	}
+
+	VirtualLinearArena::~VirtualLinearArena()
+	{
+		Release(false);
+		if (data)
+		{
+			FreeVirtualMem(data, reservedSize);
+		}
+	}
+
+	void VirtualLinearArena::Release(bool decommit)
+	{
+		stats.Release();
+		insert = data;
+		count  = 0;
+		if (decommit && committedEnd > data)
+		{
+			DecommitVirtualMem(data, GetCommittedSize());
+			committedEnd = data;
+		}
+	}
+
+	bool VirtualLinearArena::Commit(u8* end)
+	{
+		const sizet size = sizet(end - data);
+		if (end < data || size > reservedSize) [[unlikely]]
+		{
+			return false;
+		}
+		const sizet newSize = (size + commitSize - 1) / commitSize * commitSize;
+		u8* const newEnd    = data + Min(newSize, reservedSize);
+		if (!CommitVirtualMem(committedEnd, newEnd - committedEnd, hugePages))
+		{
+			return false;
+		}
+		committedEnd = newEnd;
+		return true;
+	}
+#pragma endregion Virtual Linear
+
 #pragma region Multi Linear
 	template<sizet blockSize>
 	void Details::LinearBasePool<blockSize>::AllocateBlock(Arena& parentArena)
@@ -268,6 +653,128 @@ namespace p
 	}
 #pragma endregion Multi Linear
 
+#pragma region Pool Arena
+	// Pages are allocated in multiples of this size
+	static constexpr sizet poolPageGranularity = 4 * Memory::KB;
+
+	void Details::PoolBucket::Init(sizet size, sizet align, sizet minPageSize)
+	{
+		slotAlign = Max(align, alignof(PoolSlot));
+		slotSize  = Max(size, sizeof(PoolSlot));
+		slotSize  = (slotSize + slotAlign - 1) & ~(slotAlign - 1);
+
+		// A page fits at least its header and one slot
+		pageSize = Max(minPageSize, sizeof(PoolPage) + slotAlign + slotSize);
+		pageSize = (pageSize + poolPageGranularity - 1) & ~(poolPageGranularity - 1);
+	}
+
+	void* Details::PoolBucket::AllocFromNewPage(Arena& parentArena)
+	{
+		auto* page = static_cast<PoolPage*>(
+		    parentArena.Alloc(pageSize, Max(slotAlign, alignof(PoolPage))));
+		page->next = lastPage;
+		lastPage   = page;
+
+		// Slots are carved when needed, so that unused memory of the page is never touched
+		u8* const first = reinterpret_cast<u8*>(page + 1);
+		insert          = first + GetAlignmentPadding(first, slotAlign) + slotSize;
+		pageEnd         = reinterpret_cast<u8*>(page) + pageSize;
+		return insert - slotSize;
+	}
+
+	void Details::PoolBucket::Release(Arena& parentArena)
+	{
+		while (lastPage != nullptr)
+		{
+			PoolPage* const page = lastPage;
+			lastPage             = page->next;
+			parentArena.Free(page, pageSize);
+		}
+		freeSlot = nullptr;
+		insert   = nullptr;
+		pageEnd  = nullptr;
+	}
+
+
+	PoolArena::PoolArena(sizet slotSize, sizet slotAlign, sizet pageSize, Arena& parentArena)
+	    : ChildArena(&parentArena)
+	{
+		bucket.Init(slotSize, slotAlign, pageSize);
+		stats.name = "Pool Arena";
+		Interface<PoolArena>();
+	}
+
+	void* PoolArena::Alloc(sizet size, sizet align)
+	{
+		void* ptr;
+		if (size > bucket.slotSize)
+		{
+			ptr = GetParentArena().Alloc(size, align);
+		}
+		else
+		{
+			P_CheckMsg(align <= bucket.slotAlign,
+			    "PoolArena can't allocate blocks aligned more than its slots");
+			ptr = bucket.Alloc(GetParentArena());
+		}
+		stats.Add(ptr, size);
+		return ptr;
+	}
+
+	void PoolArena::Release()
+	{
+		stats.Release();
+		bucket.Release(GetParentArena());
+	}
+
+
+	MultiPoolArena::MultiPoolArena(sizet pageSize, Arena& parentArena) : ChildArena(&parentArena)
+	{
+		for (i32 index = 0; index < numClasses; ++index)
+		{
+			// Slots of a class are aligned to the biggest power of two dividing its size
+			const sizet classSize = GetClassSize(index);
+			buckets[index].Init(classSize, Min(classSize & (~classSize + 1), maxPooledAlign),
+			    Max(pageSize, classSize * 8));
+		}
+		stats.name = "Multi Pool Arena";
+		Interface<MultiPoolArena>();
+	}
+
+	void* MultiPoolArena::Alloc(sizet size, sizet align)
+	{
+		void* ptr;
+		if (size > maxPooledSize)
+		{
+			ptr = GetParentArena().Alloc(size, align);
+		}
+		else
+		{
+			P_CheckMsg(align <= maxPooledAlign,
+			    "MultiPoolArena can't allocate blocks aligned more than 64 bytes");
+			// Overaligned blocks come from the next class aligned enough. When freed, they are
+			// reused by the class of their size, which they always fit.
+			i32 index = GetClass(size);
+			while (buckets[index].slotAlign < align && index < numClasses - 1)
+			{
+				++index;
+			}
+			ptr = buckets[index].Alloc(GetParentArena());
+		}
+		stats.Add(ptr, size);
+		return ptr;
+	}
+
+	void MultiPoolArena::Release()
+	{
+		stats.Release();
+		for (Details::PoolBucket& bucket : buckets)
+		{
+			bucket.Release(GetParentArena());
+		}
+	}
+#pragma endregion Pool Arena
+
 #pragma region Best Fit Arena
 	bool operator==(const BestFitArena::Slot& a, sizet b)
 	{
@@ -329,7 +836,7 @@ namespace p
 
 	BestFitArena::~BestFitArena()
 	{
-		p::Free(block.data, block.size);
+		GetParentArena().Free(block.data, block.size);
 		block.data = nullptr;
 	}
 
@@ -527,7 +1034,7 @@ namespace p
 
 	BigBestFitArena::~BigBestFitArena()
 	{
-		p::Free(block.data, block.size);
+		GetParentArena().Free(block.data, block.size);
 		block.data = nullptr;
 	}
 
@@ -703,4 +1210,310 @@ namespace p
 		return u32(static_cast<u8*>(data) - static_cast<u8*>(block));
 	}
 #pragma endregion Big Best Fit Arena
+
+#pragma region TLSF Arena
+	// Blocks are used from after prevPhysical and size. Free list links only exist on free blocks.
+	static constexpr sizet tlsfHeaderSize = offsetof(Details::TLSFBlock, nextFree);
+	static constexpr sizet tlsfMinSize    = sizeof(Details::TLSFBlock) - tlsfHeaderSize;
+	static constexpr sizet tlsfFreeBit    = 1;
+	static_assert(tlsfHeaderSize % TLSFArena::minAlign == 0);
+	static_assert(sizeof(Details::TLSFRegion) % TLSFArena::minAlign == 0);
+	// A region holds its header, the blocks and a sentinel header at the end
+	static constexpr sizet tlsfRegionOverhead = sizeof(Details::TLSFRegion) + 2 * tlsfHeaderSize;
+
+	static sizet GetTLSFSize(const Details::TLSFBlock* block)
+	{
+		return block->size & ~tlsfFreeBit;
+	}
+	static bool IsTLSFFree(const Details::TLSFBlock* block)
+	{
+		return block->size & tlsfFreeBit;
+	}
+	static Details::TLSFBlock* GetTLSFNext(Details::TLSFBlock* block)
+	{
+		return reinterpret_cast<Details::TLSFBlock*>(
+		    reinterpret_cast<u8*>(block) + tlsfHeaderSize + GetTLSFSize(block));
+	}
+	static Details::TLSFBlock* GetTLSFBlock(void* ptr)
+	{
+		return reinterpret_cast<Details::TLSFBlock*>(static_cast<u8*>(ptr) - tlsfHeaderSize);
+	}
+	static u8* GetTLSFPtr(Details::TLSFBlock* block)
+	{
+		return reinterpret_cast<u8*>(block) + tlsfHeaderSize;
+	}
+
+
+	TLSFArena::TLSFArena(sizet regionSize, Arena& parentArena)
+	    : ChildArena(&parentArena), regionSize{regionSize}
+	{
+		stats.name = "TLSF Arena";
+		Interface<TLSFArena>();
+	}
+
+	void* TLSFArena::Alloc(sizet size, sizet align)
+	{
+		align                = Max(align, minAlign);
+		const sizet usedSize = Max((size + minAlign - 1) & ~(minAlign - 1), tlsfMinSize);
+		// Aligned blocks need space for a free block before them
+		const sizet neededSize =
+		    align > minAlign ? usedSize + align + sizeof(Details::TLSFBlock) : usedSize;
+		if (RoundUpToList(neededSize) >= maxBlockSize) [[unlikely]]
+		{
+			return nullptr;
+		}
+
+		Block* block = FindFreeBlock(neededSize);
+		if (!block) [[unlikely]]
+		{
+			if (!AddRegion(RoundUpToList(neededSize)))
+			{
+				return nullptr;
+			}
+			block = FindFreeBlock(neededSize);
+		}
+		RemoveFreeBlock(block);
+
+		if (align > minAlign)
+		{
+			u8* const ptr = GetTLSFPtr(block);
+			sizet gap     = GetAlignmentPadding(ptr, align);
+			while (gap > 0 && gap < sizeof(Details::TLSFBlock))
+			{
+				gap += align;
+			}
+			if (gap > 0)
+			{
+				// Split the gap into its own free block
+				auto* const alignedBlock   = GetTLSFBlock(ptr + gap);
+				alignedBlock->prevPhysical = block;
+				alignedBlock->size         = GetTLSFSize(block) - gap;
+				GetTLSFNext(alignedBlock)->prevPhysical = alignedBlock;
+				block->size = gap - tlsfHeaderSize;
+				InsertFreeBlock(block);
+				block = alignedBlock;
+			}
+		}
+		SplitBlock(block, usedSize);
+
+		void* const ptr = GetTLSFPtr(block);
+		stats.Add(ptr, size);
+		return ptr;
+	}
+
+	void TLSFArena::Free(void* ptr, sizet size)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+		stats.Remove(ptr, size);
+
+		Block* const block = MergeFree(GetTLSFBlock(ptr));
+		Block* const next  = GetTLSFNext(block);
+		// Return regions left empty, as long as others remain
+		if (!block->prevPhysical && GetTLSFSize(next) == 0 && lastRegion->next)
+		{
+			FreeRegion(reinterpret_cast<Region*>(reinterpret_cast<u8*>(block) - sizeof(Region)));
+			return;
+		}
+		InsertFreeBlock(block);
+	}
+
+	void TLSFArena::Release()
+	{
+		stats.Release();
+		while (lastRegion)
+		{
+			Region* const region = lastRegion;
+			lastRegion           = region->next;
+			GetParentArena().Free(region, region->size);
+		}
+		flBitmap = 0;
+		for (u32 fl = 0; fl < flCount; ++fl)
+		{
+			slBitmaps[fl] = 0;
+			for (u32 sl = 0; sl < slCount; ++sl)
+			{
+				freeBlocks[fl][sl] = nullptr;
+			}
+		}
+		freeSize = 0;
+	}
+
+	void TLSFArena::GetBlocks(TArray<ArenaBlock>& outBlocks) const
+	{
+		for (Region* region = lastRegion; region != nullptr; region = region->next)
+		{
+			outBlocks.Add(ArenaBlock{region, region->size});
+		}
+	}
+
+	void TLSFArena::Mapping(sizet size, u32& fl, u32& sl)
+	{
+		if (size < smallSize)
+		{
+			fl = 0;
+			sl = u32(size / (smallSize / slCount));
+		}
+		else
+		{
+			const u32 highBit = u32(std::bit_width(size)) - 1;
+			sl                = u32(size >> (highBit - slLog2)) ^ slCount;
+			fl                = highBit - flShift + 1;
+		}
+	}
+
+	sizet TLSFArena::RoundUpToList(sizet size)
+	{
+		// Any block in the list of the rounded size will fit
+		if (size >= smallSize)
+		{
+			size += (sizet(1) << (std::bit_width(size) - 1 - slLog2)) - 1;
+		}
+		return size;
+	}
+
+	TLSFArena::Block* TLSFArena::FindFreeBlock(sizet size)
+	{
+		u32 fl, sl;
+		Mapping(RoundUpToList(size), fl, sl);
+
+		u32 slMap = slBitmaps[fl] & (~0u << sl);
+		if (!slMap)
+		{
+			// Search the next bigger first level with free blocks
+			const u32 flMap = fl + 1 < flCount ? flBitmap & (~0u << (fl + 1)) : 0;
+			if (!flMap)
+			{
+				return nullptr;
+			}
+			fl    = u32(std::countr_zero(flMap));
+			slMap = slBitmaps[fl];
+		}
+		sl = u32(std::countr_zero(slMap));
+		return freeBlocks[fl][sl];
+	}
+
+	void TLSFArena::InsertFreeBlock(Block* block)
+	{
+		const sizet size = GetTLSFSize(block);
+		u32 fl, sl;
+		Mapping(size, fl, sl);
+		Block*& head    = freeBlocks[fl][sl];
+		block->size     = size | tlsfFreeBit;
+		block->nextFree = head;
+		block->prevFree = nullptr;
+		if (head)
+		{
+			head->prevFree = block;
+		}
+		head = block;
+		flBitmap |= 1u << fl;
+		slBitmaps[fl] |= 1u << sl;
+		freeSize += size;
+	}
+
+	void TLSFArena::RemoveFreeBlock(Block* block)
+	{
+		const sizet size = GetTLSFSize(block);
+		u32 fl, sl;
+		Mapping(size, fl, sl);
+		if (block->nextFree)
+		{
+			block->nextFree->prevFree = block->prevFree;
+		}
+		if (block->prevFree)
+		{
+			block->prevFree->nextFree = block->nextFree;
+		}
+		else
+		{
+			Block*& head = freeBlocks[fl][sl];
+			head         = block->nextFree;
+			if (!head)
+			{
+				slBitmaps[fl] &= ~(1u << sl);
+				if (!slBitmaps[fl])
+				{
+					flBitmap &= ~(1u << fl);
+				}
+			}
+		}
+		block->size = size;
+		freeSize -= size;
+	}
+
+	TLSFArena::Block* TLSFArena::MergeFree(Block* block)
+	{
+		Block* const prev = block->prevPhysical;
+		if (prev && IsTLSFFree(prev))
+		{
+			RemoveFreeBlock(prev);
+			prev->size += tlsfHeaderSize + GetTLSFSize(block);
+			block = prev;
+			GetTLSFNext(block)->prevPhysical = block;
+		}
+		Block* const next = GetTLSFNext(block);
+		if (IsTLSFFree(next))
+		{
+			RemoveFreeBlock(next);
+			block->size += tlsfHeaderSize + GetTLSFSize(next);
+			GetTLSFNext(block)->prevPhysical = block;
+		}
+		return block;
+	}
+
+	void TLSFArena::SplitBlock(Block* block, sizet size)
+	{
+		const sizet blockSize = GetTLSFSize(block);
+		if (blockSize < size + sizeof(Block))
+		{
+			return;    // The rest is too small for a block
+		}
+		auto* const rest   = reinterpret_cast<Block*>(GetTLSFPtr(block) + size);
+		rest->prevPhysical = block;
+		rest->size         = blockSize - size - tlsfHeaderSize;
+		GetTLSFNext(rest)->prevPhysical = rest;
+		block->size = size;
+		// The next block is never free, since free blocks are always merged
+		InsertFreeBlock(rest);
+	}
+
+	bool TLSFArena::AddRegion(sizet minBlockSize)
+	{
+		sizet size = Max(regionSize, minBlockSize + tlsfRegionOverhead);
+		size       = (size + minAlign - 1) & ~(minAlign - 1);
+
+		auto* const region = static_cast<Region*>(GetParentArena().Alloc(size, minAlign));
+		if (!region)
+		{
+			return false;
+		}
+		region->next = lastRegion;
+		region->size = size;
+		lastRegion   = region;
+
+		auto* const block   = reinterpret_cast<Block*>(region + 1);
+		block->prevPhysical = nullptr;
+		block->size         = size - tlsfRegionOverhead;
+		// The sentinel is never free, so that blocks are not merged past the region
+		Block* const sentinel  = GetTLSFNext(block);
+		sentinel->prevPhysical = block;
+		sentinel->size         = 0;
+		InsertFreeBlock(block);
+		return true;
+	}
+
+	void TLSFArena::FreeRegion(Region* region)
+	{
+		Region** link = &lastRegion;
+		while (*link != region)
+		{
+			link = &(*link)->next;
+		}
+		*link = region->next;
+		GetParentArena().Free(region, region->size);
+	}
+#pragma endregion TLSF Arena
 }    // namespace p
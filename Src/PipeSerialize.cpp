@@ -965,6 +965,12 @@ namespace p
 
 	BinaryFormatReader::~BinaryFormatReader() {}
 
+	void BinaryFormatReader::Reset(TView<u8> newData)
+	{
+		data    = newData;
+		pointer = data.Data();
+	}
+
 	void BinaryFormatReader::BeginArray(u32& size)
 	{
 		Read(size);
@@ -1111,6 +1117,18 @@ namespace p
 		return data.Data() && !data.IsEmpty();
 	}
 
+	const u8* BinaryFormatReader::ReadBytes(u32 size)
+	{
+		if (!P_EnsureMsg(pointer + size <= data.EndData(),
+		        "The size of the bytes readen exceeds the read buffer!")) [[unlikely]]
+		{
+			return nullptr;
+		}
+		const u8* bytes = pointer;
+		pointer += size;
+		return bytes;
+	}
+
 
 	BinaryFormatWriter::BinaryFormatWriter(Arena& arena)
 	    : arena{arena}, data{static_cast<u8*>(Alloc<u8>(arena, 64))}, capacity{64}
@@ -1242,17 +1260,30 @@ namespace p
 		size += valSize;
 	}
 
+	u8* BinaryFormatWriter::WriteBytes(u32 bytesSize)
+	{
+		PreAlloc(bytesSize);
+		u8* bytes = data + size;
+		size += bytesSize;
+		return bytes;
+	}
+
 	TView<p::u8> BinaryFormatWriter::GetData()
 	{
 		return {data, i32(size)};
 	}
 
+	void BinaryFormatWriter::Reset()
+	{
+		size = 0;
+	}
+
 	void BinaryFormatWriter::PreAlloc(u32 offset)
 	{
 		if (size + offset > capacity) [[unlikely]]
 		{
 			const u32 oldCapacity = capacity;
-			capacity *= 2;    // Grow capacity exponentially
+			capacity = Max(capacity * 2, size + offset);    // Grow capacity exponentially
 			u8* oldData = data;
 
 			data = static_cast<u8*>(Alloc<u8>(arena, capacity));
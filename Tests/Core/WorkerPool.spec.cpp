@@ -0,0 +1,86 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <Pipe/Core/WorkerPool.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+go_bandit([]()
+{
+	describe("Core.WorkerPool", []()
+	{
+		it("Runs tasks without workers", [&]()
+		{
+			WorkerPool workers{0};
+			std::atomic<i32> pending{2};
+			i32 value = 0;
+			workers.Enqueue([&]()
+			{
+				value += 1;
+				workers.CompleteTask(pending);
+			});
+			workers.Enqueue([&]()
+			{
+				value += 2;
+				workers.CompleteTask(pending);
+			});
+			workers.WaitUntilDone(pending);
+			AssertThat(value, Equals(3));
+		});
+
+		it("Runs tasks on workers", [&]()
+		{
+			WorkerPool workers{4};
+			AssertThat(workers.GetNumWorkers(), Equals(4));
+
+			std::atomic<i32> pending{100};
+			std::atomic<i32> value{0};
+			for (i32 i = 0; i < 100; ++i)
+			{
+				workers.Enqueue([&]()
+				{
+					value.fetch_add(1);
+					workers.CompleteTask(pending);
+				});
+			}
+			workers.WaitUntilDone(pending);
+			AssertThat(value.load(), Equals(100));
+		});
+
+		it("Waits for tasks running on other workers", [&]()
+		{
+			WorkerPool workers{1};
+			std::atomic<i32> pending{1};
+			std::atomic<bool> done{false};
+			workers.Enqueue([&]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds{20});
+				done = true;
+				workers.CompleteTask(pending);
+			});
+			// Let the worker take the task, so that the calling thread has nothing to run
+			std::this_thread::sleep_for(std::chrono::milliseconds{5});
+			workers.WaitUntilDone(pending);
+			AssertThat(done.load(), Is().True());
+		});
+
+		it("Runs a parallel for", [&]()
+		{
+			WorkerPool workers{3};
+			TArray<i32> values;
+			values.Resize(1000, 0);
+			workers.ParallelFor(values.Size(), [&values](i32 i)
+			{
+				values[i] += i;
+			});
+			for (i32 i = 0; i < values.Size(); ++i)
+			{
+				AssertThat(values[i], Equals(i));
+			}
+		});
+	});
+});
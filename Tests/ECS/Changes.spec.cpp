@@ -0,0 +1,155 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct ChangeTypeA
+{
+	P_STRUCT(ChangeTypeA, TF_ECS_TrackChanges)
+
+	i32 value = 0;
+};
+struct ChangeTypeB
+{
+	P_STRUCT(ChangeTypeB, TF_ECS_TrackChanges)
+
+	i32 value = 0;
+};
+
+
+go_bandit([]()
+{
+	describe("ECS.Changes", []()
+	{
+		it("Finds components added or written after a tick", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(5);
+			AddId(ctx, ids);
+			for (Id id : ids)
+			{
+				ctx.Add<ChangeTypeA>(id);
+			}
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx, 0).Size(), Equals(5));
+
+			const u32 tick = ctx.GetChangeTick();
+			ctx.AdvanceChangeTick();
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx, tick).Size(), Equals(0));
+
+			ctx.Get<ChangeTypeA>(ids[1]).value = 2;
+			ctx.TryGet<ChangeTypeA>(ids[3])->value = 3;
+			AssertThat(ctx.Get<const ChangeTypeA>(ids[4]).value, Equals(0));
+			TArray<Id> changed = FindAllIdsChanged<ChangeTypeA>(ctx, tick);
+			AssertThat(changed.Size(), Equals(2));
+			AssertThat(changed.Contains(ids[1]), Is().True());
+			AssertThat(changed.Contains(ids[3]), Is().True());
+			AssertThat(ctx.GetPool<ChangeTypeA>()->GetChangeTick(ids[1]), Equals(tick + 1));
+		});
+
+		it("Keeps ticks with their ids", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(10);
+			AddId(ctx, ids);
+			ctx.AddN<ChangeTypeA>(ids);
+
+			const u32 tick = ctx.AdvanceChangeTick();
+			ctx.Get<ChangeTypeA>(ids[8]);
+			ctx.Remove<ChangeTypeA>(ids[2]);
+			ctx.Add<ChangeTypeA>(ids[2]);    // Reuses the removed slot
+			RmId(ctx, ids[5], RmIdFlags::Instant);
+
+			TArray<Id> changed = FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1);
+			AssertThat(changed.Size(), Equals(2));
+			AssertThat(changed.Contains(ids[8]), Is().True());
+			AssertThat(changed.Contains(ids[2]), Is().True());
+
+			// Copies skip removed slots
+			IdContext ctx2{ctx};
+			AssertThat(ctx2.GetChangeTick(), Equals(tick));
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx2, tick - 1).Size(), Equals(2));
+			AssertThat(ctx2.GetPool<ChangeTypeA>()->GetChangeTick(ids[9]), Equals(tick - 1));
+		});
+
+		it("Keeps ticks aligned in groups", [&]()
+		{
+			IdContext ctx;
+			ctx.AssureGroup<ChangeTypeA, ChangeTypeB>();
+			TArray<Id> ids;
+			ids.Resize(10);
+			AddId(ctx, ids);
+			ctx.AddN<ChangeTypeA>(ids);
+
+			const u32 tick = ctx.AdvanceChangeTick();
+			ctx.Add<ChangeTypeB>(ids[7]);    // Moves ids[7] to the front of ChangeTypeA
+			AssertThat(ctx.GetPool<ChangeTypeA>()->GetChangeTick(ids[7]), Equals(tick - 1));
+			TArray<Id> changed = FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1);
+			AssertThat(changed.Size(), Equals(0));
+			changed = FindAllIdsChanged<ChangeTypeB>(ctx, tick - 1);
+			AssertThat(changed.Size(), Equals(1));
+			AssertThat(changed[0], Equals(ids[7]));
+		});
+
+		it("Tracks changes written by parallel and group iteration", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<ChangeTypeB>();
+			TArray<Id> ids;
+			ids.Resize(3000);
+			AddId(ctx, ids);
+			ctx.AddN<ChangeTypeA>(ids);
+			ctx.AddN<ChangeTypeB>(ids.First(1500));
+			WorkerPool workers{4};
+
+			u32 tick = ctx.AdvanceChangeTick();
+			EachParallel<const ChangeTypeA>(ctx, [](Id id, const ChangeTypeA& a) {}, workers);
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1).Size(), Equals(0));
+			EachParallel<ChangeTypeA>(ctx, [](Id id, ChangeTypeA& a)
+			{
+				a.value = 1;
+			}, workers);
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1).Size(), Equals(3000));
+
+			tick = ctx.AdvanceChangeTick();
+			EachParallel<ChangeTypeA>(ctx, ids.First(10), [](Id, ChangeTypeA& a)
+			{
+				a.value = 2;
+			}, workers);
+			AssertThat(FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1).Size(), Equals(10));
+
+			tick = ctx.AdvanceChangeTick();
+			group.Each<const ChangeTypeB>([](Id id, const ChangeTypeB& b) {});
+			AssertThat(FindAllIdsChanged<ChangeTypeB>(ctx, tick - 1).Size(), Equals(0));
+			group.Each<ChangeTypeB>([](Id id, ChangeTypeB& b)
+			{
+				b.value = 3;
+			});
+			TArray<Id> changed = FindAllIdsChanged<ChangeTypeB>(ctx, tick - 1);
+			AssertThat(changed.Size(), Equals(1500));
+			AssertThat(changed.Contains(ids[1499]), Is().True());
+		});
+
+		it("Tracks changes applied by command buffers", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+			const u32 tick = ctx.AdvanceChangeTick();
+
+			IdCommandBuffer commands{ctx};
+			commands.Add<ChangeTypeA>(id, {4});
+			commands.Apply();
+			TArray<Id> changed = FindAllIdsChanged<ChangeTypeA>(ctx, tick - 1);
+			AssertThat(changed.Size(), Equals(1));
+		});
+	});
+});
@@ -0,0 +1,171 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct CommandTypeA
+{
+	i32 value = 0;
+};
+struct CommandTypeB
+{};
+
+
+go_bandit([]()
+{
+	describe("ECS.Commands", []()
+	{
+		it("Doesn't change the context until applied", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+
+			IdCommandBuffer commands{ctx};
+			commands.Add<CommandTypeA>(id, {3});
+			commands.Add<CommandTypeB>(id);
+			AssertThat(ctx.Has<CommandTypeA>(id), Is().False());
+			AssertThat(commands.IsEmpty(), Is().False());
+
+			commands.Apply();
+			AssertThat(commands.IsEmpty(), Is().True());
+			AssertThat(ctx.Has<CommandTypeB>(id), Is().True());
+			AssertThat(ctx.Get<CommandTypeA>(id).value, Equals(3));
+		});
+
+		it("Applies the last command of each id", [&]()
+		{
+			IdContext ctx;
+			Id id1 = AddId(ctx);
+			Id id2 = AddId(ctx);
+			Id id3 = AddId(ctx);
+			ctx.Add<CommandTypeA>(id3, {1});
+
+			IdCommandBuffer commands{ctx};
+			commands.Add<CommandTypeA>(id2, {1});
+			commands.Add<CommandTypeA>(id1, {1});
+			commands.Remove<CommandTypeA>(id1);
+			commands.Add<CommandTypeA>(id2, {2});
+			commands.Remove<CommandTypeA>(id3);
+			commands.Apply();
+
+			AssertThat(ctx.Has<CommandTypeA>(id1), Is().False());
+			AssertThat(ctx.Get<CommandTypeA>(id2).value, Equals(2));
+			AssertThat(ctx.Has<CommandTypeA>(id3), Is().False());
+		});
+
+		it("Can add lvalues", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+
+			IdCommandBuffer commands{ctx};
+			CommandTypeA value{4};
+			const CommandTypeA constValue{5};
+			commands.Add(id, value);
+			commands.Apply();
+			AssertThat(ctx.Get<CommandTypeA>(id).value, Equals(4));
+
+			commands.Add(id, constValue);
+			commands.Apply();
+			AssertThat(ctx.Get<CommandTypeA>(id).value, Equals(5));
+		});
+
+		it("Applies adds of many ids", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			for (i32 i = 0; i < 100; ++i)
+			{
+				ids.Add(AddId(ctx));
+			}
+			ctx.Add<CommandTypeA>(ids[10], {-1});
+
+			IdCommandBuffer commands{ctx};
+			for (i32 i = ids.Size() - 1; i >= 0; --i)
+			{
+				commands.Add<CommandTypeA>(ids[i], {i});
+				commands.Add<CommandTypeB>(ids[i]);
+			}
+			commands.Apply();
+
+			bool allAdded = true;
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				allAdded &= ctx.Get<CommandTypeA>(ids[i]).value == i;
+				allAdded &= ctx.Has<CommandTypeB>(ids[i]);
+			}
+			AssertThat(allAdded, Is().True());
+		});
+
+		it("Can add and remove ids", [&]()
+		{
+			IdContext ctx;
+			Id id1 = AddId(ctx);
+
+			IdCommandBuffer commands{ctx};
+			Id id2 = commands.AddId();
+			AssertThat(ctx.IsValid(id2), Is().True());
+			commands.Add<CommandTypeA>(id2, {2});
+			commands.RmId(id1, RmIdFlags::Instant);
+			commands.RmId(id1, RmIdFlags::Instant);
+			AssertThat(ctx.IsValid(id1), Is().True());
+
+			commands.Apply();
+			AssertThat(ctx.IsValid(id1), Is().False());
+			AssertThat(ctx.Get<CommandTypeA>(id2).value, Equals(2));
+		});
+
+		it("Ignores commands of removed ids", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+
+			IdCommandBuffer commands{ctx};
+			commands.Add<CommandTypeA>(id, {1});
+			RmId(ctx, id, RmIdFlags::Instant);
+			Id newId = AddId(ctx);    // Reuses the index of id
+			commands.Apply();
+			AssertThat(ctx.Has<CommandTypeA>(newId), Is().False());
+		});
+
+		it("Records from multiple threads", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(5000);
+			AddId(ctx, ids);
+
+			IdCommandBuffers commands{ctx};
+			WorkerPool workers{3};
+			workers.ParallelFor(ids.Size(), [&ids, &commands](i32 i)
+			{
+				IdCommandBuffer& buffer = commands.Get();
+				buffer.Add<CommandTypeA>(ids[i], {i});
+				if (i % 2 == 0)
+				{
+					buffer.Add<CommandTypeB>(ids[i]);
+				}
+			});
+			AssertThat(commands.IsEmpty(), Is().False());
+
+			commands.Apply();
+			AssertThat(commands.IsEmpty(), Is().True());
+			AssertThat(ctx.GetPool<CommandTypeA>()->Size(), Equals(5000));
+			AssertThat(ctx.GetPool<CommandTypeB>()->Size(), Equals(2500));
+			bool allValid = true;
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				allValid &= ctx.Get<CommandTypeA>(ids[i]).value == i;
+			}
+			AssertThat(allValid, Is().True());
+		});
+	});
+});
@@ -59,6 +59,11 @@ struct TestComponent
 };
 u32 TestComponent::destructed = 0;
 
+struct IsolatedComponent
+{
+	i32 value = 0;
+};
+
 
 go_bandit([]()
 {
@@ -113,6 +118,37 @@ go_bandit([]()
 			}
 		});
 
+		it("Can add many components to ids that have them", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids{3000};
+			AddId(ctx, ids);
+			IdQuery& query = ctx.AssureQuery<IsolatedComponent, EmptyComponent>();
+			ctx.AddN<EmptyComponent>(ids);
+			ctx.Add<IsolatedComponent>(ids[5], {-1});
+
+			TArray<Id> repeated = ids;
+			repeated.Add(ids[7]);
+			TArray<IsolatedComponent> values;
+			for (i32 i = 0; i < repeated.Size(); ++i)
+			{
+				values.Add({i});
+			}
+			ctx.AddN<IsolatedComponent>(repeated, values);
+
+			const auto& pool = *ctx.GetPool<IsolatedComponent>();
+			AssertThat(pool.Size(), Equals(3000));
+			AssertThat(query.Size(), Equals(3000));
+			AssertThat(ctx.Get<IsolatedComponent>(ids[5]).value, Equals(5));
+			AssertThat(ctx.Get<IsolatedComponent>(ids[7]).value, Equals(3000));
+			bool allSet = true;
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				allSet &= i == 7 || ctx.Get<IsolatedComponent>(ids[i]).value == i;
+			}
+			AssertThat(allSet, Is().True());
+		});
+
 		it("Can remove many components", [&]()
 		{
 			IdContext ctx;
@@ -279,6 +315,48 @@ go_bandit([]()
 			AssertThat(ctx.TryGet<NonEmptyComponent>(id), Equals(nullptr));
 		});
 
+		it("Removes many ids from all pools", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(6000);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<NonEmptyComponent>(ids[i]);
+				ctx.Add<IsolatedComponent>(ids[i], {i});
+				if (i % 100 == 0)
+				{
+					ctx.Add<EmptyComponent>(ids[i]);
+				}
+			}
+			IdQuery& query = ctx.AssureQuery<NonEmptyComponent, EmptyComponent>();
+			AssertThat(query.Size(), Equals(60));
+
+			RmId(ctx, TView<const Id>{ids.Data(), 5000}, RmIdFlags::Instant);
+			AssertThat(query.Size(), Equals(10));
+			AssertThat(ctx.Has<NonEmptyComponent>(ids[4999]), Is().False());
+			AssertThat(ctx.Has<EmptyComponent>(ids[4900]), Is().False());
+			AssertThat(ctx.Has<NonEmptyComponent>(ids[5000]), Is().True());
+			AssertThat(ctx.Has<EmptyComponent>(ids[5000]), Is().True());
+			AssertThat(ctx.Has<IsolatedComponent>(ids[0]), Is().False());
+			AssertThat(ctx.Get<IsolatedComponent>(ids[5000]).value, Equals(5000));
+
+			RmId(ctx, TView<const Id>{ids.Data() + 5000, 1000});
+			AssertThat(ctx.Has<NonEmptyComponent>(ids[5999]), Is().True());
+			FlushDeferredRemovals(ctx);
+			AssertThat(query.Size(), Equals(0));
+			AssertThat(ctx.Has<NonEmptyComponent>(ids[5999]), Is().False());
+			AssertThat(ctx.Has<EmptyComponent>(ids[5900]), Is().False());
+		});
+
+		it("Only removes trivially destructible components in parallel", [&]()
+		{
+			IdContext ctx;
+			AssertThat(ctx.AssurePool<IsolatedComponent>().IsIsolated(), Is().True());
+			AssertThat(ctx.AssurePool<TestComponent>().IsIsolated(), Is().False());
+		});
+
 		it("Can access components on recicled entities", [&]()
 		{
 			IdContext ctx;
@@ -15,6 +15,10 @@ struct ECSTypeA
 };
 struct ECSTypeB
 {};
+struct ECSTypeC
+{
+	i32 value = 0;
+};
 
 
 go_bandit([]()
@@ -70,5 +74,114 @@ go_bandit([]()
 			TPool<ECSTypeA>& pool = origin.AssurePool<ECSTypeA>();
 			AssertThat(pool.Size(), Equals(0));
 		});
+
+		it("Compacts pools in steps", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<ECSTypeC>(ids[i], {i});
+			}
+			for (i32 i = 0; i < ids.Size(); i += 2)
+			{
+				ctx.Remove<ECSTypeC>(ids[i]);
+			}
+			TPool<ECSTypeC>& pool = ctx.AssurePool<ECSTypeC>();
+			AssertThat(pool.GetNumRemoved(), Equals(50));
+			AssertThat(pool.GetRemovedRatio(), Equals(0.5f));
+
+			AssertThat(pool.CompactStep(10), Is().False());
+			AssertThat(pool.GetNumRemoved(), Equals(30));    // Trailing slots are removed too
+			AssertThat(pool.CompactStep(100), Is().True());
+			AssertThat(pool.Size(), Equals(50));
+			bool allKept = true;
+			for (i32 i = 1; i < ids.Size(); i += 2)
+			{
+				allKept &= ctx.Get<ECSTypeC>(ids[i]).value == i;
+			}
+			AssertThat(allKept, Is().True());
+
+			// Slots are reused and compacted again
+			ctx.Add<ECSTypeC>(ids[0], {0});
+			ctx.Remove<ECSTypeC>(ids[1]);
+			ctx.Remove<ECSTypeC>(ids[3]);
+			pool.Compact();
+			AssertThat(pool.Size(), Equals(49));
+			AssertThat(pool.GetNumRemoved(), Equals(0));
+			AssertThat(ctx.Get<ECSTypeC>(ids[0]).value, Equals(0));
+			AssertThat(ctx.Get<ECSTypeC>(ids[99]).value, Equals(99));
+		});
+
+		it("Compacts pools over a ratio of removed slots", [&]()
+		{
+			IdContext ctx;
+			ctx.AssureGroup<ECSTypeA, ECSTypeC>();
+			TArray<Id> ids;
+			ids.Resize(20);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<ECSTypeC>(ids[i], {i});
+				if (i < 5)
+				{
+					ctx.Add<ECSTypeA>(ids[i]);
+				}
+			}
+			ctx.Add<ECSTypeB>(ids[0]);
+			ctx.Add<ECSTypeB>(ids[1]);
+			ctx.Add<ECSTypeB>(ids[2]);
+			ctx.Remove<ECSTypeB>(ids[0]);
+			ctx.Remove<ECSTypeB>(ids[1]);
+			for (i32 i = 10; i < 18; ++i)
+			{
+				ctx.Remove<ECSTypeC>(ids[i]);
+			}
+			ctx.Remove<ECSTypeC>(ids[4]);    // Grouped
+
+			AssertThat(CompactPools(ctx, Seconds{1}, 0.6f), Is().True());
+			AssertThat(ctx.AssurePool<ECSTypeB>().GetNumRemoved(), Equals(0));
+			AssertThat(ctx.AssurePool<ECSTypeC>().GetNumRemoved(), Equals(9));
+
+			AssertThat(CompactPools(ctx, Seconds{1}), Is().True());
+			TPool<ECSTypeC>& pool = ctx.AssurePool<ECSTypeC>();
+			AssertThat(pool.GetNumRemoved(), Equals(0));
+			AssertThat(pool.Size(), Equals(11));
+			const IdGroup* group = pool.GetGroup();
+			AssertThat(group->Size(), Equals(4));
+			bool aligned = true;
+			for (i32 i = 0; i < group->Size(); ++i)
+			{
+				aligned &= ctx.AssurePool<ECSTypeA>().GetIdList()[i] == pool.GetIdList()[i];
+			}
+			AssertThat(aligned, Is().True());
+			AssertThat(ctx.Get<ECSTypeC>(ids[19]).value, Equals(19));
+			AssertThat(ctx.Get<ECSTypeC>(ids[3]).value, Equals(3));
+		});
+
+		it("Compacts pools when flushing removals", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+			ctx.AddN<ECSTypeC>(ids, {3});
+
+			RmId(ctx, ids.First(10));
+			FlushDeferredRemovals(ctx);
+			AssertThat(ctx.AssurePool<ECSTypeC>().GetNumRemoved(), Equals(10));
+
+			ctx.SetAutoCompact(0.25f, Seconds{1});
+			RmId(ctx, TView<const Id>{ids.Data() + 10, 5});
+			FlushDeferredRemovals(ctx);
+			AssertThat(ctx.AssurePool<ECSTypeC>().GetNumRemoved(), Equals(15));
+
+			RmId(ctx, TView<const Id>{ids.Data() + 15, 10});
+			FlushDeferredRemovals(ctx);
+			AssertThat(ctx.AssurePool<ECSTypeC>().GetNumRemoved(), Equals(0));
+			AssertThat(ctx.AssurePool<ECSTypeC>().Size(), Equals(75));
+		});
 	});
 });
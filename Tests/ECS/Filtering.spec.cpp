@@ -31,6 +31,14 @@ struct TypeB
 {};
 struct TypeC
 {};
+struct TypeData
+{
+	i32 value = 0;
+};
+struct TypeData2
+{
+	i32 value = 0;
+};
 
 
 go_bandit([]()
@@ -113,6 +121,47 @@ go_bandit([]()
 				AssertThat(ids.Contains(NoId), Is().False());
 				AssertThat(ids.Size(), Equals(1));
 			});
+
+			it("Matches ids of many pools", [&]()
+			{
+				TArray<Id> ids;
+				ids.Resize(5000);
+				AddId(ctx, ids);
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					ctx.Add<TypeData>(ids[i], {i});
+					if (i % 3 != 0)
+					{
+						ctx.Add<TypeData2>(ids[i], {i});
+					}
+					if (i % 7 != 0)
+					{
+						ctx.Add<TypeC>(ids[i]);
+					}
+				}
+				// Leave removed slots in the pools
+				for (i32 i = 0; i < ids.Size(); i += 10)
+				{
+					ctx.Remove<TypeData>(ids[i]);
+				}
+
+				i32 expected = 0;
+				for (Id id : ids)
+				{
+					expected += ctx.Has<TypeData, TypeData2, TypeC>(id);
+				}
+				TArray<Id> found = FindAllIdsWith<TypeData, TypeData2, TypeC>(ctx);
+				bool allMatch    = true;
+				for (Id id : found)
+				{
+					allMatch &= ctx.Has<TypeData, TypeData2, TypeC>(id);
+				}
+				AssertThat(allMatch, Is().True());
+				AssertThat(found.Size(), Equals(expected));
+
+				TArray<Id> source = FindIdsWith<TypeData2, TypeC, TypeData>(ctx, ids);
+				AssertThat(source.Size(), Equals(expected));
+			});
 		});
 
 		describe("ExcludeIdsWith", [&]()
@@ -151,6 +200,161 @@ go_bandit([]()
 			});
 		});
 
+		describe("ExcludeIdsWithoutAny", [&]()
+		{
+			it("Removes ids not containing any component", [&]()
+			{
+				TArray<Id> ids{id1, id2, id3, id4, id5};
+				ExcludeIdsWithoutAny<TypeA, TypeC>(ctx, ids);
+				AssertThat(ids.Contains(id1), Is().True());
+				AssertThat(ids.Contains(id2), Is().True());
+				AssertThat(ids.Contains(id3), Is().True());
+				AssertThat(ids.Contains(id5), Is().False());
+				AssertThat(ids.Size(), Equals(4));
+			});
+		});
+
+		describe("HasIds", [&]()
+		{
+			it("Checks many ids at once", [&]()
+			{
+				const IPool* pool = ctx.GetPool<const TypeA>();
+				TArray<Id> ids{id1, id2, id3, id5};
+				BitArray results;
+				pool->HasIds(ids, results);
+				AssertThat(results.Size(), Equals(4));
+				AssertThat(results.IsSet(0), Is().True());
+				AssertThat(results.IsSet(1), Is().True());
+				AssertThat(results.IsSet(2), Is().False());
+				AssertThat(results.IsSet(3), Is().False());
+			});
+
+			it("Checks ids across multiple pages", [&]()
+			{
+				TArray<Id> ids;
+				ids.Resize(10000);
+				AddId(ctx, ids);
+				for (i32 i = 0; i < ids.Size(); i += 3)
+				{
+					ctx.Add<TypeC>(ids[i]);
+				}
+
+				BitArray results;
+				ctx.GetPool<const TypeC>()->HasIds(ids, results);
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					AssertThat(results.IsSet(i), Equals(i % 3 == 0));
+				}
+			});
+		});
+
+		describe("Tags", [&]()
+		{
+			it("Keeps a bit per id in pools", [&]()
+			{
+				const BitArray* bits = ctx.GetPool<const TypeA>()->GetIdBits();
+				AssertThat(bits, !Equals(nullptr));
+				AssertThat(bits->IsSet(id1.GetIndex()), Is().True());
+				AssertThat(bits->IsSet(id3.GetIndex()), Is().False());
+
+				ctx.Remove<TypeA>(id1);
+				AssertThat(bits->IsSet(id1.GetIndex()), Is().False());
+				AssertThat(ctx.Has<TypeA>(id1), Is().False());
+				AssertThat(ctx.Has<TypeA>(id2), Is().True());
+
+				ctx.Add<TypeData>(id1);
+				bits = ctx.GetPool<const TypeData>()->GetIdBits();
+				AssertThat(bits->IsSet(id1.GetIndex()), Is().True());
+				ctx.Remove<TypeData>(id1);
+				AssertThat(bits->IsSet(id1.GetIndex()), Is().False());
+			});
+
+			it("Checks the version of ids", [&]()
+			{
+				const Id removed = AddId(ctx);
+				ctx.Add<TypeA>(removed);
+				RmId(ctx, removed, RmIdFlags::Instant);
+				const Id reused = AddId(ctx);
+				AssertThat(reused.GetIndex(), Equals(removed.GetIndex()));
+				ctx.Add<TypeA>(reused);
+				AssertThat(ctx.Has<TypeA>(reused), Is().True());
+				AssertThat(ctx.Has<TypeA>(removed), Is().False());
+			});
+
+			it("Checks the version of many ids", [&]()
+			{
+				const Id removed = AddId(ctx);
+				ctx.Add<TypeA>(removed);
+				ctx.Add<TypeData>(removed);
+				RmId(ctx, removed, RmIdFlags::Instant);
+				const Id reused = AddId(ctx);
+				AssertThat(reused.GetIndex(), Equals(removed.GetIndex()));
+				ctx.Add<TypeA>(reused);
+				ctx.Add<TypeData>(reused);
+
+				const TArray<Id> source{removed, reused};
+				BitArray results;
+				ctx.GetPool<const TypeData>()->HasIds(source, results);
+				AssertThat(results.IsSet(0), Is().False());
+				AssertThat(results.IsSet(1), Is().True());
+
+				TArray<Id> found;
+				FindIdsWith(ctx.GetPool<const TypeA>(), source, found);
+				AssertThat(found.Size(), Equals(1));
+				AssertThat(found[0], Equals(reused));
+
+				found.Clear();
+				const TArray<const IPool*> pools{
+				    ctx.GetPool<const TypeA>(), ctx.GetPool<const TypeData>()};
+				FindIdsWith(pools, source, found);
+				AssertThat(found.Size(), Equals(1));
+				AssertThat(found[0], Equals(reused));
+
+				TArray<Id> ids = source;
+				ExcludeIdsWith(ctx.GetPool<const TypeData>(), ids);
+				AssertThat(ids.Size(), Equals(1));
+				AssertThat(ids[0], Equals(removed));
+			});
+
+			it("Intersects tags to find ids", [&]()
+			{
+				TArray<Id> ids;
+				ids.Resize(1000);
+				AddId(ctx, ids);
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					if (i % 2 == 0)
+					{
+						ctx.Add<TypeA>(ids[i]);
+					}
+					if (i % 3 == 0)
+					{
+						ctx.Add<TypeB>(ids[i]);
+					}
+					if (i % 5 != 0)
+					{
+						ctx.Add<TypeData>(ids[i], {i});
+					}
+				}
+				RmId(ctx, ids[6], RmIdFlags::Instant);
+
+				TArray<Id> found = FindAllIdsWith<TypeA, TypeB>(ctx);
+				AssertThat(found.Contains(id2), Is().True());
+				found.Remove(id2);
+				AssertThat(found.Size(), Equals(166));
+
+				found = FindAllIdsWith<TypeA, TypeB, TypeData>(ctx);
+				bool allMatch = true;
+				for (Id id : found)
+				{
+					const i32 value = ctx.Get<const TypeData>(id).value;
+					allMatch &= value % 6 == 0 && value % 5 != 0 && ids[value] == id;
+				}
+				AssertThat(allMatch, Is().True());
+				AssertThat(found.Size(), Equals(132));
+			});
+		});
+
 		describe("FindIdsWith", [&]()
 		{
 			it("Finds ids containing a component from a list", [&]()
@@ -0,0 +1,205 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct GroupTypeA
+{
+	i32 value = 0;
+};
+struct GroupTypeB
+{
+	i32 value = 0;
+};
+struct GroupTypeC
+{};
+
+
+// All pools of the group have the same ids at the front, and components moved with their ids
+bool IsGroupAligned(const IdContext& ctx, const IdGroup& group)
+{
+	const TView<const Id> ids = group.GetIds();
+	for (const ComponentPool* pool : group.GetPools())
+	{
+		for (i32 i = 0; i < ids.Size(); ++i)
+		{
+			if (pool->GetIdList()[i] != ids[i])
+			{
+				return false;
+			}
+		}
+	}
+	for (Id id : ids)
+	{
+		if (ctx.Get<const GroupTypeA>(id).value != i32(id.GetIndex())
+		    || ctx.Get<const GroupTypeB>(id).value != i32(id.GetIndex()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+go_bandit([]()
+{
+	describe("ECS.Groups", []()
+	{
+		it("Sorts existing ids on creation", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(10);
+			AddId(ctx, ids);
+			for (Id id : ids)
+			{
+				const i32 index = id.GetIndex();
+				ctx.Add<GroupTypeA>(id, {index});
+				if (index % 3 == 0)
+				{
+					ctx.Add<GroupTypeB>(id, {index});
+				}
+			}
+			ctx.Remove<GroupTypeA>(ids[1]);
+
+			IdGroup& group = ctx.AssureGroup<GroupTypeA, GroupTypeB>();
+			IdGroup& sameGroup = ctx.AssureGroup<GroupTypeB, GroupTypeA>();
+			AssertThat(&sameGroup, Equals(&group));
+			AssertThat(group.Size(), Equals(4));
+			AssertThat(group.Has(ids[3]), Is().True());
+			AssertThat(group.Has(ids[2]), Is().False());
+			AssertThat(IsGroupAligned(ctx, group), Is().True());
+		});
+
+		it("Keeps pools aligned on changes", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<GroupTypeA, GroupTypeB>();
+			TArray<Id> ids;
+			ids.Resize(20);
+			AddId(ctx, ids);
+			for (Id id : ids)
+			{
+				ctx.Add<GroupTypeB>(id, {i32(id.GetIndex())});
+			}
+			for (i32 i = ids.Size() - 1; i >= 0; i -= 2)
+			{
+				ctx.Add<GroupTypeA>(ids[i], {i32(ids[i].GetIndex())});
+			}
+			AssertThat(group.Size(), Equals(10));
+			AssertThat(IsGroupAligned(ctx, group), Is().True());
+
+			ctx.Remove<GroupTypeB>(ids[5]);
+			ctx.Remove<GroupTypeA>(ids[19]);
+			RmId(ctx, ids[7], RmIdFlags::Instant);
+			AssertThat(group.Size(), Equals(7));
+			AssertThat(group.Has(ids[5]), Is().False());
+			AssertThat(IsGroupAligned(ctx, group), Is().True());
+
+			// Removed slots get reused
+			ctx.Add<GroupTypeA>(ids[4], {i32(ids[4].GetIndex())});
+			ctx.Add<GroupTypeA>(ids[19], {i32(ids[19].GetIndex())});
+			AssertThat(group.Size(), Equals(9));
+			AssertThat(IsGroupAligned(ctx, group), Is().True());
+
+			ctx.ClearPool<GroupTypeA>();
+			AssertThat(group.Size(), Equals(0));
+		});
+
+		it("Iterates components of the group", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<GroupTypeA, GroupTypeB, GroupTypeC>();
+			TArray<Id> ids;
+			ids.Resize(3000);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<GroupTypeA>(ids[i], {i});
+				ctx.Add<GroupTypeB>(ids[i], {i});
+				if (i % 2 == 0)
+				{
+					ctx.Add<GroupTypeC>(ids[i]);
+				}
+			}
+			AssertThat(group.Size(), Equals(1500));
+
+			i32 count   = 0;
+			bool allSet = true;
+			group.Each<GroupTypeA, const GroupTypeB>(
+			    [&count, &allSet](Id id, GroupTypeA& a, const GroupTypeB& b)
+			{
+				allSet &= a.value == b.value && a.value % 2 == 0;
+				a.value = -1;
+				++count;
+			});
+			AssertThat(count, Equals(1500));
+			AssertThat(allSet, Is().True());
+			AssertThat(ctx.Get<GroupTypeA>(ids[2]).value, Equals(-1));
+			AssertThat(ctx.Get<GroupTypeA>(ids[3]).value, Equals(3));
+
+			i32 numPages = 0;
+			count        = 0;
+			group.EachPage<GroupTypeA>([&numPages, &count](TView<const Id> ids, GroupTypeA* a)
+			{
+				++numPages;
+				count += ids.Size();
+			});
+			AssertThat(numPages, Equals(2));
+			AssertThat(count, Equals(1500));
+
+			// Scopes can only iterate components they access
+			TIdScope<Writes<GroupTypeA>, const GroupTypeB> scope{ctx};
+			count = 0;
+			scope.EachGrouped<GroupTypeA, const GroupTypeB>(
+			    group, [&count](Id id, GroupTypeA& a, const GroupTypeB& b)
+			{
+				a.value = b.value;
+				++count;
+			});
+			AssertThat(count, Equals(1500));
+			AssertThat(ctx.Get<GroupTypeA>(ids[2]).value, Equals(2));
+
+			const IdGroup& constGroup = group;
+			count                     = 0;
+			constGroup.Each<const GroupTypeA>([&count](Id id, const GroupTypeA& a)
+			{
+				++count;
+			});
+			AssertThat(count, Equals(1500));
+		});
+
+		it("Is copied with the context", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<GroupTypeA, GroupTypeB>();
+			TArray<Id> ids;
+			ids.Resize(10);
+			AddId(ctx, ids);
+			for (Id id : ids)
+			{
+				ctx.Add<GroupTypeA>(id, {i32(id.GetIndex())});
+			}
+			ctx.Add<GroupTypeB>(ids[6], {6});
+			ctx.Add<GroupTypeB>(ids[2], {2});
+
+			IdContext ctx2{ctx};
+			IdGroup* group2 = ctx2.FindGroup(group.GetTypeIds());
+			AssertThat(group2, !Equals(nullptr));
+			AssertThat(group2->Size(), Equals(2));
+			AssertThat(group2->GetIds()[0], Equals(group.GetIds()[0]));
+			AssertThat(IsGroupAligned(ctx2, *group2), Is().True());
+
+			AssertThat(ctx.RemoveGroup(group), Is().True());
+			AssertThat(ctx.GetPool<GroupTypeA>()->GetGroup(), Equals(nullptr));
+		});
+	});
+});
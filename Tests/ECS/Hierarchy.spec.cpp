@@ -24,6 +24,11 @@ namespace snowhouse
 	};
 }    // namespace snowhouse
 
+struct HierarchyValue
+{
+	i32 value = 0;
+};
+
 
 go_bandit([]()
 {
@@ -504,5 +509,186 @@ go_bandit([]()
 				AssertThat(ValidateParentIdLinks({ctx}, root), Is().False());
 			});
 		});
+
+		describe("IdHierarchyIndex", [&]()
+		{
+			before_each([&]()
+			{
+				ctx.SetStatic<IdHierarchyIndex>();
+				AttachId({ctx}, root, {child1, child2});
+				AttachId({ctx}, child1, grandchild);
+			});
+
+			it("Is null if not enabled", [&]()
+			{
+				IdContext other;
+				AssertThat(GetIdHierarchyIndex({other}), Equals(nullptr));
+			});
+
+			it("Keeps descendants contiguous", [&]()
+			{
+				const IdHierarchyIndex* index = GetIdHierarchyIndex({ctx});
+				AssertThat(index, !Equals(nullptr));
+				AssertThat(index->IsDirty(), Is().False());
+				AssertThat(index->GetIds().Size(), Equals(4));
+				AssertThat(index->GetIds()[0], Equals(root));
+
+				TView<const Id> descendants = index->GetDescendants(root);
+				AssertThat(descendants.Size(), Equals(3));
+				AssertThat(index->GetDescendants(child1).Size(), Equals(1));
+				AssertThat(index->GetDescendants(child1)[0], Equals(grandchild));
+				AssertThat(index->GetDescendants(child2).Size(), Equals(0));
+				AssertThat(index->GetDescendants(child3).Size(), Equals(0));
+
+				const i32 grandchildPos = index->GetPosition(grandchild);
+				AssertThat(index->GetLevels()[grandchildPos], Equals(2u));
+				AssertThat(index->GetIds()[index->GetParentPositions()[grandchildPos]],
+				    Equals(child1));
+			});
+
+			it("Is updated after hierarchy changes", [&]()
+			{
+				GetIdHierarchyIndex({ctx});
+				TransferIdChildren({ctx}, grandchild, child2);
+				AttachId({ctx}, child3, root);
+				const IdHierarchyIndex* index = GetIdHierarchyIndex({ctx});
+				AssertThat(index->GetIds()[0], Equals(child3));
+				AssertThat(index->GetDescendants(child3).Size(), Equals(4));
+				AssertThat(index->GetDescendants(child1).Size(), Equals(0));
+				AssertThat(index->GetDescendants(child2).Size(), Equals(1));
+			});
+
+			it("Finds all children", [&]()
+			{
+				GetIdHierarchyIndex({ctx});
+				TArray<Id> outChildren;
+				GetAllIdChildren({ctx}, root, outChildren, 1);
+				AssertThat(outChildren.Size(), Equals(2));
+				AssertThat(outChildren.Contains(grandchild), Is().False());
+
+				outChildren.Clear();
+				GetAllIdChildren({ctx}, root, outChildren, 10);
+				AssertThat(outChildren.Size(), Equals(3));
+			});
+
+			it("Finds children in the same order as the tree", [&]()
+			{
+				AttachId({ctx}, child2, child3);
+				TArray<Id> treeChildren;
+				GetAllIdChildren({ctx}, {root, child1}, treeChildren, 10);
+
+				GetIdHierarchyIndex({ctx});
+				TArray<Id> indexChildren;
+				GetAllIdChildren({ctx}, {root, child1}, indexChildren, 10);
+				AssertThat(indexChildren.Size(), Equals(5));
+				AssertThat(indexChildren[1], Equals(child2));
+				for (i32 i = 0; i < indexChildren.Size(); ++i)
+				{
+					AssertThat(indexChildren[i], Equals(treeChildren[i]));
+				}
+			});
+
+			it("Removes direct children", [&]()
+			{
+				GetIdHierarchyIndex({ctx});
+				RmId(ctx, root, RmIdFlags::Instant);
+				AssertThat(ctx.IsValid(child1), Is().False());
+				AssertThat(ctx.IsValid(child2), Is().False());
+				AssertThat(ctx.IsValid(grandchild), Is().True());
+				AssertThat(GetIdHierarchyIndex({ctx})->GetIds().Size(), Equals(0));
+			});
+
+			it("Is dirty after flushing deferred removals", [&]()
+			{
+				RmId(ctx, root);
+				// Rebuilt while the removed ids are still in the pools
+				AssertThat(GetIdHierarchyIndex({ctx})->GetIds().Size(), Equals(4));
+				FlushDeferredRemovals(ctx);
+				AssertThat(GetIdHierarchyIndex({ctx})->GetIds().Size(), Equals(0));
+			});
+
+			it("Sorts positions by level", [&]()
+			{
+				const IdHierarchyIndex* index = GetIdHierarchyIndex({ctx});
+				AssertThat(index->GetNumLevels(), Equals(3));
+				AssertThat(index->GetLevelPositions(0).Size(), Equals(1));
+				AssertThat(index->GetLevelPositions(1).Size(), Equals(2));
+				TView<const i32> lastLevel = index->GetLevelPositions(2);
+				AssertThat(lastLevel.Size(), Equals(1));
+				AssertThat(index->GetIds()[lastLevel[0]], Equals(grandchild));
+			});
+		});
+
+		describe("PropagateIdHierarchy", [&]()
+		{
+			it("Propagates values from parents to children", [&]()
+			{
+				AttachId({ctx}, root, {child1, child2});
+				AttachId({ctx}, child1, grandchild);
+				AttachId({ctx}, grandchild, child3);
+				ctx.Add<HierarchyValue>(root, {1});
+				ctx.Add<HierarchyValue>(child1, {1});
+				ctx.Add<HierarchyValue>(grandchild, {1});
+				ctx.Add<HierarchyValue>(child3, {1});
+
+				PropagateIdHierarchy<HierarchyValue>(
+				    ctx, [](const HierarchyValue& parent, HierarchyValue& child)
+				{
+					child.value += parent.value;
+				});
+				AssertThat(ctx.Get<HierarchyValue>(root).value, Equals(1));
+				AssertThat(ctx.Get<HierarchyValue>(child1).value, Equals(2));
+				AssertThat(ctx.Get<HierarchyValue>(grandchild).value, Equals(3));
+				AssertThat(ctx.Get<HierarchyValue>(child3).value, Equals(4));
+				AssertThat(ctx.Has<HierarchyValue>(child2), Is().False());
+			});
+
+			it("Skips children of ids without the component", [&]()
+			{
+				ctx.SetStatic<IdHierarchyIndex>();
+				AttachId({ctx}, root, child1);
+				AttachId({ctx}, child1, grandchild);
+				ctx.Add<HierarchyValue>(root, {5});
+				ctx.Add<HierarchyValue>(grandchild, {1});
+
+				PropagateIdHierarchy<HierarchyValue>(
+				    ctx, [](const HierarchyValue& parent, HierarchyValue& child)
+				{
+					child.value += parent.value;
+				});
+				AssertThat(ctx.Get<HierarchyValue>(grandchild).value, Equals(1));
+			});
+
+			it("Splits wide levels between threads", [&]()
+			{
+				TArray<Id> children;
+				children.Resize(3000);
+				AddId(ctx, children);
+				TArray<Id> grandchildren;
+				grandchildren.Resize(children.Size());
+				AddId(ctx, grandchildren);
+				AttachId({ctx}, root, children);
+				ctx.Add<HierarchyValue>(root, {1});
+				for (i32 i = 0; i < children.Size(); ++i)
+				{
+					AttachId({ctx}, children[i], grandchildren[i]);
+					ctx.Add<HierarchyValue>(children[i], {i});
+					ctx.Add<HierarchyValue>(grandchildren[i]);
+				}
+
+				WorkerPool workers{3};
+				PropagateIdHierarchy<HierarchyValue>(
+				    ctx, [](const HierarchyValue& parent, HierarchyValue& child)
+				{
+					child.value += parent.value;
+				}, workers);
+				bool allSet = true;
+				for (i32 i = 0; i < children.Size(); ++i)
+				{
+					allSet &= ctx.Get<HierarchyValue>(grandchildren[i]).value == i + 1;
+				}
+				AssertThat(allSet, Is().True());
+			});
+		});
 	});
 });
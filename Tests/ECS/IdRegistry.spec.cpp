@@ -1,8 +1,11 @@
 // Copyright 2015-2026 Piperift. All Rights Reserved.
 
 #include <bandit/bandit.h>
+#include <Pipe/Core/Set.h>
 #include <PipeECS.h>
 
+#include <thread>
+
 
 using namespace snowhouse;
 using namespace bandit;
@@ -174,5 +177,148 @@ go_bandit([]()
 				AssertThat(ids.IsValid(list[i]), Is().False());
 			}
 		});
+
+		it("Reuses many removed indices at once", [&]()
+		{
+			IdRegistry ids;
+			TArray<Id> list(4);
+			ids.Create(list);
+			ids.RemoveInstant(TView<const Id>{list.Data(), 2});
+
+			TArray<Id> newList(3);
+			ids.Create(newList);
+			AssertThat(newList[0].GetIndex(), !Equals(newList[1].GetIndex()));
+			AssertThat(newList[0].GetIndex() < 2u, Is().True());
+			AssertThat(newList[1].GetIndex() < 2u, Is().True());
+			AssertThat(newList[2].GetIndex(), Equals(4u));
+			AssertThat(ids.Size(), Equals(5u));
+		});
+
+		it("Can create ids from a reservation", [&]()
+		{
+			IdRegistry ids;
+			Id removed = ids.Create();
+			ids.RemoveInstant(removed);
+			{
+				IdRegistry::Reservation reservation{ids, 8};
+				Id id1 = reservation.Create();
+				AssertThat(id1.GetIndex(), Equals(removed.GetIndex()));
+				AssertThat(ids.IsValid(id1), Is().True());
+				AssertThat(reservation.Size(), Equals(7));
+				AssertThat(ids.Size(), Equals(1u));
+
+				TArray<Id> list(10);
+				reservation.Create(list);
+				AssertThat(ids.Size(), Equals(11u));
+				AssertThat(ids.IsValid(list.Last()), Is().True());
+			}
+			// Unused indices are reused after the reservation is released
+			Id id = ids.Create();
+			AssertThat(id.GetIndex() < 17u, Is().True());
+			AssertThat(ids.Size(), Equals(12u));
+		});
+
+		it("Makes reserved indices available in copies", [&]()
+		{
+			IdRegistry ids;
+			Id removed = ids.Create();
+			ids.Remove(removed);
+			IdRegistry::Reservation reservation{ids, 8};
+			Id id1 = reservation.Create();
+
+			IdRegistry copy{ids};
+			AssertThat(copy.Size(), Equals(1u));
+			AssertThat(copy.IsValid(id1), Is().True());
+			// The 7 reserved indices are reused by the copy
+			TArray<Id> list(7);
+			copy.Create(list);
+			AssertThat(copy.Size(), Equals(8u));
+			for (Id id : list)
+			{
+				AssertThat(id.GetIndex() < 9u, Is().True());
+			}
+			AssertThat(copy.Create().GetIndex(), Equals(9u));
+		});
+
+		it("Discards reserved indices when reset", [&]()
+		{
+			IdRegistry ids;
+			IdRegistry::Reservation reservation{ids, 8};
+			reservation.Create();
+
+			ids = IdRegistry{};
+			reservation.Release();
+			// Released indices were never created by the new registry
+			Id id = ids.Create();
+			AssertThat(id.GetIndex(), Equals(0u));
+			AssertThat(ids.Size(), Equals(1u));
+
+			Id reservedId = reservation.Create();
+			AssertThat(ids.IsValid(reservedId), Is().True());
+			AssertThat(reservedId.GetIndex(), Equals(1u));
+			AssertThat(ids.Size(), Equals(2u));
+		});
+
+		it("Updates snapshots", [&]()
+		{
+			IdRegistry ids;
+			TArray<Id> list(5000);
+			ids.Create(list);
+			IdRegistry snapshot;
+			snapshot.UpdateSnapshot(ids);
+			AssertThat(snapshot.Size(), Equals(5000u));
+
+			ids.RemoveInstant(list[4500]);
+			Id newId = ids.Create();
+			snapshot.UpdateSnapshot(ids);
+			AssertThat(snapshot.Size(), Equals(5000u));
+			AssertThat(snapshot.IsValid(list[4500]), Is().False());
+			AssertThat(snapshot.IsValid(newId), Is().True());
+			AssertThat(snapshot.IsValid(list[10]), Is().True());
+
+			IdRegistry::Reservation reservation{ids, 8};
+			Id reservedId = reservation.Create();
+			snapshot.UpdateSnapshot(ids);
+			AssertThat(snapshot.IsValid(reservedId), Is().True());
+			AssertThat(snapshot.Size(), Equals(5001u));
+		});
+
+		it("Can create ids from many threads", [&]()
+		{
+			IdRegistry ids;
+			constexpr i32 numThreads = 4;
+			constexpr i32 idsPerThread = 10000;
+			TArray<Id> list(numThreads * idsPerThread);
+			std::atomic<i32> numInvalid = 0;
+			TArray<std::thread> threads;
+			for (i32 t = 0; t < numThreads; ++t)
+			{
+				threads.Add(std::thread{[&ids, &list, &numInvalid, t]()
+				{
+					IdRegistry::Reservation reservation{ids};
+					for (i32 i = t * idsPerThread; i < (t + 1) * idsPerThread; ++i)
+					{
+						list[i] = reservation.Create();
+						if (!ids.IsValid(list[i]))
+						{
+							++numInvalid;
+						}
+					}
+				}});
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			AssertThat(numInvalid.load(), Equals(0));
+			AssertThat(ids.Size(), Equals(u32(list.Size())));
+
+			TSet<Id::Index> indices;
+			for (Id id : list)
+			{
+				indices.Insert(id.GetIndex());
+			}
+			AssertThat(indices.Size(), Equals(list.Size()));
+		});
 	});
 });
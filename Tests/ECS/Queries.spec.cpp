@@ -0,0 +1,145 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct QueryTypeA
+{};
+struct QueryTypeB
+{
+	i32 value = 0;
+};
+
+
+go_bandit([]()
+{
+	IdContext ctx;
+	Id id1;
+	Id id2;
+	Id id3;
+	describe("ECS.Queries", [&]()
+	{
+		before_each([&]()
+		{
+			ctx = {};
+			id1 = AddId(ctx);
+			id2 = AddId(ctx);
+			id3 = AddId(ctx);
+			ctx.Add<QueryTypeA>(id1);
+			ctx.Add<QueryTypeA, QueryTypeB>(id2);
+			ctx.Add<QueryTypeB>(id3);
+		});
+
+		it("Finds existing ids on creation", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			AssertThat(query.Size(), Equals(1));
+			AssertThat(query.Has(id1), Is().False());
+			AssertThat(query.Has(id2), Is().True());
+			AssertThat(query.Has(id3), Is().False());
+		});
+
+		it("Is reused for the same components", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			IdQuery& sameQuery = ctx.AssureQuery<QueryTypeB, QueryTypeA>();
+			AssertThat(&sameQuery, Equals(&query));
+			AssertThat(&ctx.AssureQuery<QueryTypeA>(), Is().Not().EqualTo(&query));
+		});
+
+		it("Updates when components are added", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			ctx.Add<QueryTypeB>(id1);
+			AssertThat(query.Has(id1), Is().True());
+
+			const Id id4 = AddId(ctx);
+			ctx.Add<QueryTypeA>(id4);
+			AssertThat(query.Has(id4), Is().False());
+			ctx.Add<QueryTypeB>(id4);
+			AssertThat(query.Has(id4), Is().True());
+			AssertThat(query.Size(), Equals(3));
+		});
+
+		it("Updates when components are removed", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			ctx.Add<QueryTypeB>(id1);
+			ctx.Remove<QueryTypeA>(id2);
+			AssertThat(query.Has(id2), Is().False());
+			AssertThat(query.Has(id1), Is().True());
+			AssertThat(query.Size(), Equals(1));
+
+			RmId(ctx, id1, RmIdFlags::Instant);
+			AssertThat(query.Has(id1), Is().False());
+			AssertThat(query.IsEmpty(), Is().True());
+		});
+
+		it("Updates when a pool is cleared", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			ctx.ClearPool<QueryTypeB>();
+			AssertThat(query.IsEmpty(), Is().True());
+
+			ctx.Add<QueryTypeB>(id1);
+			AssertThat(query.Has(id1), Is().True());
+		});
+
+		it("Matches FindAllIdsWith", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			for (i32 i = 0; i < 100; ++i)
+			{
+				const Id id = AddId(ctx);
+				ctx.Add<QueryTypeA>(id);
+				if (i % 3 == 0)
+				{
+					ctx.Add<QueryTypeB>(id);
+				}
+				if (i % 5 == 0)
+				{
+					ctx.Remove<QueryTypeA>(id);
+				}
+			}
+
+			TArray<Id> ids = FindAllIdsWith<QueryTypeA, QueryTypeB>(ctx);
+			AssertThat(query.Size(), Equals(ids.Size()));
+			for (Id id : ids)
+			{
+				AssertThat(query.Has(id), Is().True());
+			}
+		});
+
+		it("Is recreated when copying the context", [&]()
+		{
+			ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			IdContext other{ctx};
+			IdQuery& query = other.AssureQuery<QueryTypeA, QueryTypeB>();
+			AssertThat(query.Has(id2), Is().True());
+
+			other.Add<QueryTypeB>(id1);
+			AssertThat(query.Has(id1), Is().True());
+			IdQuery& originalQuery = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			AssertThat(originalQuery.Has(id1), Is().False());
+		});
+
+		it("Can be removed", [&]()
+		{
+			IdQuery& query = ctx.AssureQuery<QueryTypeA, QueryTypeB>();
+			TArray<TypeId> typeIds{query.GetTypeIds()};
+			AssertThat(ctx.FindQuery(typeIds), Equals(&query));
+
+			AssertThat(ctx.RemoveQuery(query), Is().True());
+			AssertThat(ctx.FindQuery(typeIds), Equals(nullptr));
+			ctx.Add<QueryTypeB>(id1);    // Removed queries are not notified
+		});
+	});
+});
@@ -0,0 +1,196 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <Pipe/Files/Files.h>
+#include <Pipe/Files/Paths.h>
+#include <Pipe/Files/PlatformPaths.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct SerializedPosition
+{
+	P_STRUCT(SerializedPosition, TF_TrivialSerialize)
+
+	P_PROP(x)
+	float x = 0.f;
+	P_PROP(y)
+	float y = 0.f;
+};
+
+struct SerializedTag
+{
+	P_STRUCT(SerializedTag)
+};
+
+
+go_bandit([]()
+{
+	describe("ECS.Serialization", []()
+	{
+		it("Can write and read pools in binary", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				if (i % 2 == 0)
+				{
+					ctx.Add<SerializedPosition>(ids[i], {float(i), float(i) * 2.f});
+				}
+				if (i % 3 == 0)
+				{
+					ctx.Add<SerializedTag>(ids[i]);
+				}
+			}
+			ctx.Add<CChild>(ids[1], {.parent = ids[4]});
+
+			BinaryFormatWriter writer;
+			{
+				EntityWriter w{writer.GetWriter(), ctx};
+				w.SerializeEntities(ids, [](EntityWriter& w) {
+					w.SerializePools<SerializedPosition, SerializedTag, CChild>();
+				}, false);
+			}
+
+			IdContext loadedCtx;
+			TArray<Id> loadedIds;
+			BinaryFormatReader reader{writer.GetData()};
+			{
+				EntityReader r{reader.GetReader(), loadedCtx};
+				r.SerializeEntities(loadedIds, [](EntityReader& r) {
+					r.SerializePools<SerializedPosition, SerializedTag, CChild>();
+				});
+				loadedIds = r.GetIds();
+			}
+
+			AssertThat(loadedIds.Size(), Equals(100));
+			AssertThat(loadedCtx.AssurePool<SerializedPosition>().Size(), Equals(50));
+			AssertThat(loadedCtx.AssurePool<SerializedTag>().Size(), Equals(34));
+			bool allLoaded = true;
+			for (i32 i = 0; i < loadedIds.Size(); ++i)
+			{
+				const Id id = loadedIds[i];
+				if (i % 2 == 0)
+				{
+					const auto* position = loadedCtx.TryGet<const SerializedPosition>(id);
+					allLoaded &= position && position->x == float(i)
+					          && position->y == float(i) * 2.f;
+				}
+				allLoaded &= loadedCtx.Has<SerializedTag>(id) == (i % 3 == 0);
+			}
+			AssertThat(allLoaded, Is().True());
+			AssertThat(loadedCtx.Get<const CChild>(loadedIds[1]).parent, Equals(loadedIds[4]));
+		});
+
+		it("Can write and read files in chunks", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(1000);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SerializedPosition>(ids[i], {float(i), 0.f});
+			}
+			// Points to an id in the last chunk
+			ctx.Add<CChild>(ids[0], {.parent = ids[999]});
+
+			const String path =
+			    JoinPaths(PlatformPaths::GetUserTempPath(), "PipeTests_Entities.bin");
+			{
+				EntityFileWriter writer{ctx, path, 100};
+				AssertThat(writer.IsValid(), Is().True());
+				AssertThat(writer.Write(ids, [](EntityWriter& w) {
+					w.SerializePools<SerializedPosition, CChild>();
+				}, false), Is().True());
+			}
+
+			IdContext loadedCtx;
+			{
+				EntityFileReader reader{loadedCtx, path};
+				AssertThat(reader.IsValid(), Is().True());
+				AssertThat(reader.GetIds().Size(), Equals(1000));
+				auto onReadPools = [](EntityReader& r) {
+					r.SerializePools<SerializedPosition, CChild>();
+				};
+
+				i32 numChunks = 0;
+				while (reader.ReadChunk(onReadPools) == EntityFileStatus::Read)
+				{
+					++numChunks;
+					AssertThat(loadedCtx.AssurePool<SerializedPosition>().Size(),
+					    Equals(numChunks * 100));
+				}
+				AssertThat(numChunks, Equals(10));
+				AssertThat(reader.ReadChunk(onReadPools), Equals(EntityFileStatus::End));
+
+				const TArray<Id>& loadedIds = reader.GetIds();
+				AssertThat(loadedCtx.Get<const SerializedPosition>(loadedIds[567]).x, Equals(567.f));
+				AssertThat(
+				    loadedCtx.Get<const CChild>(loadedIds[0]).parent, Equals(loadedIds[999]));
+			}
+			Delete(path);
+		});
+
+		it("Doesn't create ids of broken files", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(1000);
+			AddId(ctx, ids);
+			ctx.AddN<SerializedPosition>(ids, {1.f, 2.f});
+
+			const String path =
+			    JoinPaths(PlatformPaths::GetUserTempPath(), "PipeTests_BrokenEntities.bin");
+			auto onWritePools = [](EntityWriter& w)
+			{
+				w.SerializePools<SerializedPosition>();
+			};
+			auto onReadPools = [](EntityReader& r)
+			{
+				r.SerializePools<SerializedPosition>();
+			};
+			{
+				EntityFileWriter writer{ctx, path, 100};
+				AssertThat(writer.Write(ids, onWritePools, false), Is().True());
+			}
+			String data;
+			AssertThat(LoadStringFile(path, data), Is().True());
+
+			// Missing the end of the last chunk
+			SaveStringFile(path, StringView{data}.substr(0, data.size() - 10));
+			{
+				IdContext loadedCtx;
+				EntityFileReader reader{loadedCtx, path};
+				AssertThat(reader.IsValid(), Is().False());
+				AssertThat(reader.GetIds().Size(), Equals(0));
+				AssertThat(reader.ReadAll(onReadPools), Equals(EntityFileStatus::Truncated));
+			}
+
+			// More ids than the chunks in the file
+			data[9] = 0x10;    // numIds is the third u32
+			SaveStringFile(path, data);
+			{
+				IdContext loadedCtx;
+				EntityFileReader reader{loadedCtx, path};
+				AssertThat(reader.IsValid(), Is().False());
+				AssertThat(reader.ReadAll(onReadPools), Equals(EntityFileStatus::Truncated));
+			}
+
+			SaveStringFile(path, "PECS");
+			{
+				IdContext loadedCtx;
+				EntityFileReader reader{loadedCtx, path};
+				AssertThat(reader.ReadChunk(onReadPools), Equals(EntityFileStatus::Invalid));
+			}
+			Delete(path);
+		});
+	});
+});
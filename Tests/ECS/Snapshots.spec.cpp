@@ -0,0 +1,166 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct SnapshotTypeA
+{
+	P_STRUCT(SnapshotTypeA, TF_ECS_TrackChanges)
+
+	i32 value = 0;
+};
+struct SnapshotTypeB
+{
+	TArray<i32> values;
+};
+struct SnapshotTypeC
+{};
+
+
+// Same ids and components in the same slots
+template<typename T>
+bool IsSnapshotEqual(const IdContext& ctx, const IdContext& snapshot)
+{
+	const TPool<T>* pool         = ctx.GetPool<const T>();
+	const TPool<T>* snapshotPool = snapshot.GetPool<const T>();
+	if (!pool || !snapshotPool || pool->GetIdList() != snapshotPool->GetIdList())
+	{
+		return false;
+	}
+	for (Id id : pool->GetIdList())
+	{
+		if (!IsNone(id) && !snapshotPool->Has(id))
+		{
+			return false;
+		}
+		if constexpr (!p::IsEmpty<T>)
+		{
+			if (!IsNone(id) && snapshotPool->Get(id).values != pool->Get(id).values)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+go_bandit([]()
+{
+	describe("ECS.Snapshots", []()
+	{
+		it("Copies the context", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(3000);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SnapshotTypeA>(ids[i], {i});
+				if (i % 3 == 0)
+				{
+					ctx.Add<SnapshotTypeC>(ids[i]);
+				}
+			}
+			ctx.Remove<SnapshotTypeA>(ids[5]);
+
+			IdContext snapshot;
+			snapshot.UpdateSnapshot(ctx);
+			AssertThat(snapshot.IsValid(ids[5]), Is().True());
+			AssertThat(snapshot.Has<SnapshotTypeA>(ids[5]), Is().False());
+			AssertThat(snapshot.Get<const SnapshotTypeA>(ids[2999]).value, Equals(2999));
+			AssertThat(snapshot.Has<SnapshotTypeC>(ids[3]), Is().True());
+			AssertThat(snapshot.Has<SnapshotTypeC>(ids[4]), Is().False());
+			TArray<Id> found = FindAllIdsWith<SnapshotTypeA, SnapshotTypeC>(snapshot);
+			AssertThat(found.Size(), Equals(1000));
+			const bool sameSlots = snapshot.GetPool<const SnapshotTypeA>()->GetIdList()
+			                    == ctx.GetPool<const SnapshotTypeA>()->GetIdList();
+			AssertThat(sameSlots, Is().True());
+		});
+
+		it("Copies only written pages", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(3000);
+			AddId(ctx, ids);
+			ctx.AddN<SnapshotTypeA>(ids);
+			IdContext snapshot;
+			snapshot.UpdateSnapshot(ctx);
+
+			ctx.Get<SnapshotTypeA>(ids[10]).value = 1;
+			ctx.GetPool<SnapshotTypeA>()->GetPageData(2)[0].value = 2;
+			// Written without the pool knowing. Only copied if its page is.
+			const_cast<SnapshotTypeA&>(ctx.Get<const SnapshotTypeA>(ids[20])).value = 3;
+			const_cast<SnapshotTypeA&>(ctx.Get<const SnapshotTypeA>(ids[1500])).value = 4;
+
+			snapshot.UpdateSnapshot(ctx);
+			AssertThat(snapshot.Get<const SnapshotTypeA>(ids[10]).value, Equals(1));
+			AssertThat(snapshot.Get<const SnapshotTypeA>(ids[2048]).value, Equals(2));
+			AssertThat(snapshot.Get<const SnapshotTypeA>(ids[20]).value, Equals(3));
+			AssertThat(snapshot.Get<const SnapshotTypeA>(ids[1500]).value, Equals(0));
+		});
+
+		it("Follows added, removed and moved ids", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(2500);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SnapshotTypeB>(ids[i], {{i, i}});
+				ctx.Add<SnapshotTypeC>(ids[i]);
+			}
+			IdContext snapshot;
+			snapshot.UpdateSnapshot(ctx);
+
+			RmId(ctx, TView<const Id>{ids.Data() + 100, 1000}, RmIdFlags::Instant);
+			ctx.Add<SnapshotTypeB>(ids[0], {{-1}});
+			CompactPools(ctx, Seconds{1}, 0.1f);
+			snapshot.UpdateSnapshot(ctx);
+			AssertThat(IsSnapshotEqual<SnapshotTypeB>(ctx, snapshot), Is().True());
+			AssertThat(IsSnapshotEqual<SnapshotTypeC>(ctx, snapshot), Is().True());
+			AssertThat(snapshot.IsValid(ids[100]), Is().False());
+			AssertThat(snapshot.Has<SnapshotTypeC>(ids[100]), Is().False());
+			AssertThat(snapshot.Has<SnapshotTypeC>(ids[2000]), Is().True());
+
+			ctx.SortPool<SnapshotTypeB>([](const SnapshotTypeB& a, const SnapshotTypeB& b)
+			{
+				return a.values[0] > b.values[0];
+			});
+			ctx.ClearPool<SnapshotTypeC>();
+			snapshot.UpdateSnapshot(ctx);
+			AssertThat(IsSnapshotEqual<SnapshotTypeB>(ctx, snapshot), Is().True());
+			AssertThat(snapshot.GetPool<const SnapshotTypeC>()->Size(), Equals(0));
+			AssertThat(snapshot.Has<SnapshotTypeC>(ids[2000]), Is().False());
+		});
+
+		it("Can be updated from many snapshots", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+			ctx.Add<SnapshotTypeA>(id, {1});
+			IdContext snapshot1;
+			IdContext snapshot2;
+			snapshot1.UpdateSnapshot(ctx);
+
+			ctx.Get<SnapshotTypeA>(id).value = 2;
+			snapshot2.UpdateSnapshot(ctx);
+			snapshot1.UpdateSnapshot(ctx);
+			AssertThat(snapshot1.Get<const SnapshotTypeA>(id).value, Equals(2));
+			AssertThat(snapshot2.Get<const SnapshotTypeA>(id).value, Equals(2));
+			AssertThat(snapshot2.GetPool<const SnapshotTypeA>()->GetChangeTick(id),
+			    Equals(ctx.GetChangeTick()));
+		});
+	});
+});
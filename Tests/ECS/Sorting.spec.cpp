@@ -0,0 +1,130 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct SortTypeA
+{
+	P_STRUCT(SortTypeA, TF_ECS_TrackChanges)
+
+	i32 value = 0;
+};
+struct SortTypeB
+{
+	i32 value = 0;
+};
+struct SortTypeC
+{};
+
+
+go_bandit([]()
+{
+	describe("ECS.Sorting", []()
+	{
+		it("Sorts a pool by value", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SortTypeA>(ids[i], {(i * 37) % 100});
+			}
+			const u32 tick = ctx.AdvanceChangeTick();
+			ctx.Get<SortTypeA>(ids[5]);
+			ctx.Remove<SortTypeA>(ids[10]);
+
+			ctx.SortPool<SortTypeA>([](const SortTypeA& a, const SortTypeA& b)
+			{
+				return a.value < b.value;
+			});
+			const TPool<SortTypeA>& pool = *ctx.GetPool<const SortTypeA>();
+			AssertThat(pool.Size(), Equals(99));
+			bool sorted = true;
+			for (i32 i = 1; i < pool.Size(); ++i)
+			{
+				sorted &= ctx.Get<const SortTypeA>(pool.GetIdList()[i - 1]).value
+				        < ctx.Get<const SortTypeA>(pool.GetIdList()[i]).value;
+			}
+			AssertThat(sorted, Is().True());
+			AssertThat(ctx.Get<const SortTypeA>(ids[7]).value, Equals(59));
+			AssertThat(pool.GetChangeTick(ids[5]), Equals(tick));
+			AssertThat(pool.GetChangeTick(ids[6]), Equals(tick - 1));
+		});
+
+		it("Sorts a pool as another", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(50);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SortTypeA>(ids[i], {i});
+			}
+			for (i32 i = ids.Size() - 1; i >= 0; i -= 3)
+			{
+				ctx.Add<SortTypeB>(ids[i], {i});
+				ctx.Add<SortTypeC>(ids[i]);
+			}
+			ctx.Add<SortTypeB>(AddId(ctx));    // Not in SortTypeA
+
+			ctx.SortPoolAs<SortTypeA, SortTypeB>();
+			ctx.SortPoolAs<SortTypeC, SortTypeB>();
+			const TArray<Id>& idsA = ctx.GetPool<const SortTypeA>()->GetIdList();
+			const TArray<Id>& idsB = ctx.GetPool<const SortTypeB>()->GetIdList();
+			const TArray<Id>& idsC = ctx.GetPool<const SortTypeC>()->GetIdList();
+			bool lockstep = true;
+			for (i32 i = 0; i < 17; ++i)
+			{
+				lockstep &= idsA[i] == idsB[i] && idsC[i] == idsB[i];
+				lockstep &= ctx.Get<const SortTypeA>(idsA[i]).value == i32(idsA[i].GetIndex());
+			}
+			AssertThat(lockstep, Is().True());
+			AssertThat(idsA.Size(), Equals(50));
+			AssertThat(ctx.Has<SortTypeC>(ids[49]), Is().True());
+			AssertThat(ctx.Has<SortTypeC>(ids[48]), Is().False());
+		});
+
+		it("Keeps grouped ids in place", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<SortTypeA, SortTypeC>();
+			TArray<Id> ids;
+			ids.Resize(20);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				ctx.Add<SortTypeA>(ids[i], {-i});
+				if (i % 2 == 0)
+				{
+					ctx.Add<SortTypeC>(ids[i]);
+				}
+			}
+			const TArray<Id> groupIds{group.GetIds()};
+
+			ctx.SortPool<SortTypeA>([](const SortTypeA& a, const SortTypeA& b)
+			{
+				return a.value < b.value;
+			});
+			const TArray<Id>& idsA = ctx.GetPool<const SortTypeA>()->GetIdList();
+			bool kept = true;
+			for (i32 i = 0; i < group.Size(); ++i)
+			{
+				kept &= idsA[i] == groupIds[i];
+			}
+			AssertThat(kept, Is().True());
+			AssertThat(idsA[group.Size()], Equals(ids[19]));
+			AssertThat(idsA.Last(), Equals(ids[1]));
+		});
+	});
+});
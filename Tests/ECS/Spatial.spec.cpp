@@ -0,0 +1,193 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+#include <random>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct SpatialBounds : public Box
+{
+	P_STRUCT(SpatialBounds, TF_ECS_ModifyOnEdit)
+};
+
+
+Box MakeRandomBox(std::mt19937& random, float worldSize, float maxSize)
+{
+	std::uniform_real_distribution<float> position{0.f, worldSize};
+	std::uniform_real_distribution<float> size{0.1f, maxSize};
+	const v3 min{position(random), position(random), position(random)};
+	return {min, min + v3{size(random), size(random), size(random)}};
+}
+
+// Same ids, in any order
+bool SameIds(TArray<Id> a, TArray<Id> b)
+{
+	if (a.Size() != b.Size())
+	{
+		return false;
+	}
+	a.Sort();
+	b.Sort();
+	for (i32 i = 0; i < a.Size(); ++i)
+	{
+		if (a[i] != b[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+go_bandit([]()
+{
+	describe("ECS.Spatial", []()
+	{
+		it("Finds the same ids as iterating all bounds", [&]()
+		{
+			std::mt19937 random{7};
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(2000);
+			AddId(ctx, ids);
+			TArray<Box> bounds;
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				bounds.Add(MakeRandomBox(random, 100.f, 5.f));
+			}
+
+			IdSpatialIndex built;
+			built.Build(ids, bounds);
+			IdSpatialIndex inserted{0.5f};
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				inserted.Set(ids[i], bounds[i]);
+			}
+			AssertThat(built.Size(), Equals(2000));
+			AssertThat(inserted.Size(), Equals(2000));
+			AssertThat(inserted.GetHeight() < 30, Is().True());
+
+			bool allSame = true;
+			for (i32 q = 0; q < 50; ++q)
+			{
+				const Box query = MakeRandomBox(random, 100.f, 20.f);
+				TArray<Id> expected;
+				for (i32 i = 0; i < ids.Size(); ++i)
+				{
+					if (bounds[i].Overlaps(query))
+					{
+						expected.Add(ids[i]);
+					}
+				}
+				TArray<Id> found;
+				built.FindOverlapping(query, found);
+				allSame &= SameIds(found, expected);
+				found.Clear();
+				inserted.FindOverlapping(query, found);
+				allSame &= SameIds(found, expected);
+			}
+			AssertThat(allSame, Is().True());
+		});
+
+		it("Finds ids in a radius and on a ray", [&]()
+		{
+			IdSpatialIndex index;
+			const Id a = MakeId(0, 0), b = MakeId(1, 0), c = MakeId(2, 0);
+			index.Set(a, {v3{0.f, 0.f, 0.f}, v3{1.f, 1.f, 1.f}});
+			index.Set(b, {v3{5.f, 0.f, 0.f}, v3{6.f, 1.f, 1.f}});
+			index.Set(c, {v3{5.f, 5.f, 0.f}, v3{6.f, 6.f, 1.f}});
+
+			TArray<Id> found;
+			index.FindInRadius(v3{3.f, 0.5f, 0.5f}, 2.5f, found);
+			AssertThat(SameIds(found, {a, b}), Is().True());
+
+			found.Clear();
+			index.FindOnRay(v3{-1.f, 0.5f, 0.5f}, v3{1.f, 0.f, 0.f}, 100.f, found);
+			AssertThat(SameIds(found, {a, b}), Is().True());
+
+			found.Clear();
+			index.FindOnRay(v3{-1.f, 0.5f, 0.5f}, v3{1.f, 0.f, 0.f}, 3.f, found);
+			AssertThat(SameIds(found, {a}), Is().True());
+
+			TArray<Box> queries;
+			queries.Add({v3{4.f, -1.f, -1.f}, v3{7.f, 7.f, 2.f}});
+			queries.Add({v3{-1.f, -1.f, -1.f}, v3{0.5f, 0.5f, 0.5f}});
+			TArray<TArray<Id>> results;
+			index.FindOverlapping(queries, results);
+			AssertThat(results.Size(), Equals(2));
+			AssertThat(SameIds(results[0], {b, c}), Is().True());
+			AssertThat(SameIds(results[1], {a}), Is().True());
+		});
+
+		it("Moves and removes ids", [&]()
+		{
+			IdSpatialIndex index{1.f};
+			const Id id = MakeId(3, 0);
+			index.Set(id, {v3{0.f, 0.f, 0.f}, v3{1.f, 1.f, 1.f}});
+			index.Set(id, {v3{0.5f, 0.f, 0.f}, v3{1.5f, 1.f, 1.f}});    // Inside the margin
+			index.Set(id, {v3{10.f, 0.f, 0.f}, v3{11.f, 1.f, 1.f}});
+			AssertThat(index.Size(), Equals(1));
+
+			TArray<Id> found;
+			index.FindOverlapping({v3{-1.f, -1.f, -1.f}, v3{2.f, 2.f, 2.f}}, found);
+			AssertThat(found.Size(), Equals(0));
+			index.FindOverlapping({v3{9.f, -1.f, -1.f}, v3{12.f, 2.f, 2.f}}, found);
+			AssertThat(found.Size(), Equals(1));
+
+			// A new version of the id replaces the old one
+			const Id newId = MakeId(3, 1);
+			index.Set(newId, {v3{0.f, 0.f, 0.f}, v3{1.f, 1.f, 1.f}});
+			AssertThat(index.Has(id), Is().False());
+			AssertThat(index.Has(newId), Is().True());
+			AssertThat(index.Remove(newId), Is().True());
+			AssertThat(index.Size(), Equals(0));
+		});
+
+		it("Is kept in sync with a component", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+			for (i32 i = 0; i < ids.Size(); ++i)
+			{
+				SpatialBounds bounds;
+				bounds.min = v3{float(i) * 2.f, 0.f, 0.f};
+				bounds.max = bounds.min + v3{1.f, 1.f, 1.f};
+				ctx.Add<SpatialBounds>(ids[i], bounds);
+			}
+			auto& index = ctx.SetStatic<TIdSpatialIndex<SpatialBounds>>();
+			index.Update(ctx);
+			AssertThat(index.Size(), Equals(100));
+			ctx.ClearPool<CMdfd<SpatialBounds>>();
+
+			const Box query{v3{-1.f, -1.f, -1.f}, v3{0.5f, 2.f, 2.f}};
+			TArray<Id> found;
+			index.FindOverlapping(query, found);
+			AssertThat(SameIds(found, {ids[0]}), Is().True());
+
+			ctx.Get<SpatialBounds>(ids[0]).min.x = 1.f;
+			ctx.Get<SpatialBounds>(ids[0]).max.x = 2.f;
+			ctx.Get<SpatialBounds>(ids[50]).min.x = 0.f;
+			ctx.Remove<SpatialBounds>(ids[10]);
+			RmId(ctx, ids[20], RmIdFlags::Instant);
+			index.Update(ctx);
+			ctx.ClearPool<CMdfd<SpatialBounds>>();
+
+			AssertThat(index.Size(), Equals(98));
+			AssertThat(index.Has(ids[10]), Is().False());
+			AssertThat(index.Has(ids[20]), Is().False());
+			found.Clear();
+			index.FindOverlapping(query, found);
+			AssertThat(SameIds(found, {ids[50]}), Is().True());
+		});
+	});
+});
@@ -0,0 +1,220 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include "bandit/grammar.h"
+
+#include <bandit/bandit.h>
+#include <PipeECS.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+struct SystemTypeA
+{
+	i32 value = 0;
+};
+struct SystemTypeB
+{
+	i32 value = 0;
+};
+struct SystemTypeC
+{
+	i32 value = 0;
+};
+
+
+go_bandit([]()
+{
+	describe("ECS.Systems", []()
+	{
+		it("Finds conflicts from scopes", [&]()
+		{
+			SystemScheduler scheduler;
+			scheduler.Add<TIdScope<Writes<SystemTypeA>, SystemTypeB>>([](auto&) {});
+			scheduler.Add<TIdScope<SystemTypeB>>([](auto&) {});
+			scheduler.Add<TIdScope<SystemTypeA>>([](auto&) {});
+			scheduler.Add<TIdScope<Writes<SystemTypeB>>>([](auto&) {});
+
+			const auto& systems = scheduler.GetSystems();
+			// Reading B doesn't conflict with reading B
+			AssertThat(SystemScheduler::Conflict(systems[0], systems[1]), Is().False());
+			// Writing A conflicts with reading A
+			AssertThat(SystemScheduler::Conflict(systems[0], systems[2]), Is().True());
+			// Writing B conflicts with reading B
+			AssertThat(SystemScheduler::Conflict(systems[1], systems[3]), Is().True());
+			AssertThat(SystemScheduler::Conflict(systems[2], systems[3]), Is().False());
+
+			AssertThat(systems[0].numDependencies, Equals(0));
+			AssertThat(systems[1].numDependencies, Equals(0));
+			AssertThat(systems[2].numDependencies, Equals(1));
+			AssertThat(systems[3].numDependencies, Equals(2));
+		});
+
+		it("Runs conflicting systems in order", [&]()
+		{
+			IdContext ctx;
+			Id id = AddId(ctx);
+			ctx.Add<SystemTypeA>(id);
+
+			WorkerPool workers{4};
+			SystemScheduler scheduler;
+			for (i32 i = 0; i < 20; ++i)
+			{
+				scheduler.Add<TIdScope<Writes<SystemTypeA>>>([id, i](auto& scope)
+				{
+					auto& a = scope.template Get<SystemTypeA>(id);
+					a.value = a.value * 2 + i;
+				});
+			}
+			scheduler.Run(ctx, workers);
+
+			i32 expected = 0;
+			for (i32 i = 0; i < 20; ++i)
+			{
+				expected = expected * 2 + i;
+			}
+			AssertThat(ctx.Get<SystemTypeA>(id).value, Equals(expected));
+		});
+
+		it("Runs all systems", [&]()
+		{
+			IdContext ctx;
+			TArray<Id> ids;
+			ids.Resize(100);
+			AddId(ctx, ids);
+
+			WorkerPool workers{4};
+			SystemScheduler scheduler;
+			scheduler.Add<TIdScope<Writes<SystemTypeA>>>([&ids](auto& scope)
+			{
+				scope.template AddN<SystemTypeA>(ids, {1});
+			});
+			scheduler.Add<TIdScope<Writes<SystemTypeB>>>([&ids](auto& scope)
+			{
+				scope.template AddN<SystemTypeB>(ids, {2});
+			});
+			scheduler.Add<TIdScope<Writes<SystemTypeC>, SystemTypeA, SystemTypeB>>(
+			    [&ids](auto& scope)
+			{
+				for (Id id : ids)
+				{
+					const i32 value = scope.template Get<const SystemTypeA>(id).value
+					                + scope.template Get<const SystemTypeB>(id).value;
+					scope.template Add<SystemTypeC>(id, {value});
+				}
+			});
+			scheduler.Run(ctx, workers);
+
+			for (Id id : ids)
+			{
+				AssertThat(ctx.Get<SystemTypeC>(id).value, Equals(3));
+			}
+		});
+
+		it("Runs systems writing pools of the same group in order", [&]()
+		{
+			IdContext ctx;
+			IdGroup& group = ctx.AssureGroup<SystemTypeA, SystemTypeB>();
+			ctx.AssureQuery<SystemTypeB, SystemTypeC>();
+			TArray<TypeId> linked;
+			ctx.AddLinkedTypeIds(GetTypeId<SystemTypeA>(), linked);
+			AssertThat(linked.Size(), Equals(2));
+			ctx.AddLinkedTypeIds(GetTypeId<SystemTypeB>(), linked);
+			AssertThat(linked.Size(), Equals(3));
+
+			TArray<Id> ids;
+			ids.Resize(2000);
+			AddId(ctx, ids);
+			WorkerPool workers{4};
+			SystemScheduler scheduler;
+			scheduler.Add<TIdScope<Writes<SystemTypeA>>>([&ids](auto& scope)
+			{
+				scope.template AddN<SystemTypeA>(ids, {1});
+			});
+			scheduler.Add<TIdScope<Writes<SystemTypeB>>>([&ids](auto& scope)
+			{
+				scope.template AddN<SystemTypeB>(ids, {2});
+			});
+			scheduler.Run(ctx, workers);
+
+			AssertThat(group.Size(), Equals(ids.Size()));
+			bool valid = true;
+			group.Each<const SystemTypeA, const SystemTypeB>(
+			    [&valid](Id id, const SystemTypeA& a, const SystemTypeB& b)
+			{
+				valid &= a.value == 1 && b.value == 2;
+			});
+			AssertThat(valid, Is().True());
+		});
+
+		describe("EachParallel", [&]()
+		{
+			it("Iterates all components of a pool", [&]()
+			{
+				IdContext ctx;
+				TArray<Id> ids;
+				ids.Resize(5000);
+				AddId(ctx, ids);
+				ctx.AddN<SystemTypeA>(ids, {1});
+				ctx.Remove<SystemTypeA>(ids[10]);
+
+				WorkerPool workers{4};
+				TIdScope<Writes<SystemTypeA>> scope{ctx};
+				EachParallel<SystemTypeA>(scope, [](Id id, SystemTypeA& a)
+				{
+					a.value += 1;
+				}, workers);
+
+				std::atomic<i32> sum{0};
+				EachParallel<const SystemTypeA>(scope, [&sum](Id id, const SystemTypeA& a)
+				{
+					sum.fetch_add(a.value);
+				}, workers);
+				AssertThat(sum.load(), Equals(2 * 4999));
+			});
+
+			it("Iterates pages of a pool", [&]()
+			{
+				IdContext ctx;
+				TArray<Id> ids;
+				ids.Resize(3000);
+				AddId(ctx, ids);
+				ctx.AddN<SystemTypeA>(ids, {1});
+
+				WorkerPool workers{2};
+				std::atomic<i32> numPages{0};
+				std::atomic<i32> count{0};
+				EachPageParallel<const SystemTypeA>(ctx,
+				    [&](TView<const Id> pageIds, TView<const SystemTypeA> values)
+				{
+					numPages.fetch_add(1);
+					count.fetch_add(pageIds.Size() == values.Size() ? values.Size() : 0);
+				}, workers);
+				AssertThat(numPages.load(), Equals(3));
+				AssertThat(count.load(), Equals(3000));
+			});
+
+			it("Iterates a list of ids", [&]()
+			{
+				IdContext ctx;
+				TArray<Id> ids;
+				ids.Resize(3000);
+				AddId(ctx, ids);
+				for (i32 i = 0; i < ids.Size(); i += 2)
+				{
+					ctx.Add<SystemTypeB>(ids[i], {2});
+				}
+
+				WorkerPool workers{4};
+				std::atomic<i32> sum{0};
+				EachParallel<const SystemTypeB>(ctx, ids, [&sum](Id id, const SystemTypeB& b)
+				{
+					sum.fetch_add(b.value);
+				}, workers);
+				AssertThat(sum.load(), Equals(3000));
+			});
+		});
+	});
+});
@@ -0,0 +1,128 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <PipeMemoryArenas.h>
+
+#include <thread>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+go_bandit([]()
+{
+	describe("Memory.HeapArena", []()
+	{
+		it("Reuses freed small blocks", [&]()
+		{
+			HeapArena arena;
+			void* first = arena.Alloc(40);
+			arena.Free(first, 40);
+			void* second = arena.Alloc(48);    // Same size class
+			AssertThat(second == first, Is().True());
+			arena.Free(second, 48);
+		});
+
+		it("Can allocate aligned blocks", [&]()
+		{
+			HeapArena arena;
+			for (sizet align : {sizet(8), sizet(16), sizet(64), sizet(256)})
+			{
+				void* small = arena.Alloc(24, align);
+				void* big   = arena.Alloc(4096, align);
+				AssertThat(GetAlignmentPadding(small, align), Equals(0));
+				AssertThat(GetAlignmentPadding(big, align), Equals(0));
+				arena.Free(small, 24);
+				arena.Free(big, 4096);
+			}
+		});
+
+		it("Can free blocks allocated on other threads", [&]()
+		{
+			HeapArena arena;
+			// Stats read the events of each thread in turn, so frees from other threads can be
+			// found before their allocation and reported as leaks
+			arena.GetStats()->detectLeaks = false;
+			constexpr i32 numThreads = 4;
+			constexpr i32 count      = 5000;
+			TArray<u32*> blocks[numThreads];
+			TArray<std::thread> threads;
+			for (i32 t = 0; t < numThreads; ++t)
+			{
+				threads.Add(std::thread{[&arena, &blocks, t]()
+				{
+					for (i32 i = 0; i < count; ++i)
+					{
+						const sizet size = 16 + (i % 64) * 16;
+						u32* block       = static_cast<u32*>(arena.Alloc(size));
+						*block           = u32(t * count + i);
+						blocks[t].Add(block);
+					}
+				}});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+			threads.Clear();
+
+			bool valid[numThreads]{};
+			for (i32 t = 0; t < numThreads; ++t)
+			{
+				// Each thread frees blocks of the next one, and allocates again
+				threads.Add(std::thread{[&arena, &blocks, &valid, t]()
+				{
+					const TArray<u32*>& other = blocks[(t + 1) % numThreads];
+					valid[t]                  = true;
+					for (i32 i = 0; i < count; ++i)
+					{
+						valid[t] &= *other[i] == u32(((t + 1) % numThreads) * count + i);
+						arena.Free(other[i], 16 + (i % 64) * 16);
+					}
+					for (i32 i = 0; i < count; ++i)
+					{
+						arena.Free(arena.Alloc(32), 32);
+					}
+				}});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+			for (bool threadValid : valid)
+			{
+				AssertThat(threadValid, Is().True());
+			}
+		});
+
+		it("Returns free spans to the heap on trim", [&]()
+		{
+			sizet freedSize = 0;
+			bool reused     = false;
+			std::thread thread{[&freedSize, &reused]()
+			{
+				HeapArena arena;
+				TArray<void*> blocks;
+				for (i32 i = 0; i < 2000; ++i)
+				{
+					blocks.Add(arena.Alloc(1024));
+				}
+				for (void* block : blocks)
+				{
+					arena.Free(block, 1024);
+				}
+				freedSize = HeapArena::Trim();
+
+				// Trimmed classes can be used again
+				void* block = arena.Alloc(1024);
+				reused      = block != nullptr;
+				arena.Free(block, 1024);
+			}};
+			thread.join();
+			AssertThat(freedSize >= Memory::MB, Is().True());
+			AssertThat(reused, Is().True());
+		});
+	});
+});
@@ -2,6 +2,9 @@
 
 #include <bandit/bandit.h>
 #include <PipeMemory.h>
+#include <PipeMemoryArenas.h>
+
+#include <thread>
 
 
 using namespace snowhouse;
@@ -247,4 +250,44 @@ go_bandit([]()
 			AssertThat(srcMoveValues[1].value, Is().EqualTo(0));
 		});
 	});
+
+	describe("Memory.CurrentArena", []()
+	{
+		it("Is restored after a scope", [&]()
+		{
+			Arena* const previous = &GetCurrentArena();
+			MonoLinearArena arena{Memory::KB};
+			{
+				CurrentArenaScope scope{arena};
+				AssertThat(&GetCurrentArena() == &arena, Is().True());
+				{
+					MonoLinearArena other{Memory::KB};
+					CurrentArenaScope otherScope{other};
+					AssertThat(&GetCurrentArena() == &other, Is().True());
+				}
+				AssertThat(&GetCurrentArena() == &arena, Is().True());
+			}
+			AssertThat(&GetCurrentArena() == previous, Is().True());
+		});
+
+		it("Is different on each thread", [&]()
+		{
+			MonoLinearArena arena{Memory::KB};
+			CurrentArenaScope scope{arena};
+
+			Arena* threadArena = nullptr;
+			Arena* threadScopedArena = nullptr;
+			std::thread thread{[&]()
+			{
+				threadArena = &GetCurrentArena();
+				MonoLinearArena otherArena{Memory::KB};
+				CurrentArenaScope otherScope{otherArena};
+				threadScopedArena = &GetCurrentArena();
+			}};
+			thread.join();
+			AssertThat(threadArena == &GetHeapArena(), Is().True());
+			AssertThat(threadScopedArena != &arena, Is().True());
+			AssertThat(&GetCurrentArena() == &arena, Is().True());
+		});
+	});
 });
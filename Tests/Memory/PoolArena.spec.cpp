@@ -0,0 +1,160 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <Pipe/Memory/OwnPtr.h>
+#include <PipeMemoryArenas.h>
+
+#include <thread>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+go_bandit([]()
+{
+	describe("Memory.PoolArena", []()
+	{
+		it("Reuses freed slots", [&]()
+		{
+			TPoolArena<24> arena;
+			AssertThat(arena.GetSlotSize(), Equals(32));
+			void* first  = arena.Alloc(24);
+			void* second = arena.Alloc(24);
+			AssertThat(first != second, Is().True());
+			arena.Free(first, 24);
+			AssertThat(arena.Alloc(20), Equals(first));
+			arena.Free(first, 20);
+			arena.Free(second, 24);
+		});
+
+		it("Grows by pages", [&]()
+		{
+			TPoolArena<64, 64> arena{4 * Memory::KB};
+			TArray<void*> slots;
+			for (i32 i = 0; i < 200; ++i)
+			{
+				void* slot = arena.Alloc(64);
+				AssertThat(GetAlignmentPadding(slot, 64), Equals(0));
+				slots.Add(slot);
+			}
+			TArray<ArenaBlock> blocks;
+			arena.GetBlocks(blocks);
+			AssertThat(blocks.Size(), Equals(4));
+			AssertThat(blocks[0].size, Equals(4 * Memory::KB));
+
+			arena.GetStats()->CollectStats();
+			AssertThat(arena.GetStats()->used, Equals(200 * 64));
+			for (void* slot : slots)
+			{
+				arena.Free(slot, 64);
+			}
+			arena.Release();
+			blocks.Clear();
+			arena.GetBlocks(blocks);
+			AssertThat(blocks.Size(), Equals(0));
+		});
+
+		it("Allocates bigger blocks from the parent", [&]()
+		{
+			TPoolArena<16> arena;
+			void* big = arena.Alloc(1024);
+			TArray<ArenaBlock> blocks;
+			arena.GetBlocks(blocks);
+			AssertThat(blocks.Size(), Equals(0));
+			arena.Free(big, 1024);
+		});
+	});
+
+	describe("Memory.MultiPoolArena", []()
+	{
+		it("Has ordered size classes", [&]()
+		{
+			bool valid = true;
+			for (i32 index = 0; index < MultiPoolArena::numClasses; ++index)
+			{
+				const sizet size = MultiPoolArena::GetClassSize(index);
+				valid &= MultiPoolArena::GetClass(size) == index;
+				valid &= MultiPoolArena::GetClass(size - 1) == index;
+				valid &= MultiPoolArena::GetClass(size + 1) == index + 1
+				      || index == MultiPoolArena::numClasses - 1;
+			}
+			AssertThat(valid, Is().True());
+			AssertThat(MultiPoolArena::GetClassSize(MultiPoolArena::numClasses - 1),
+			    Equals(MultiPoolArena::maxPooledSize));
+		});
+
+		it("Reuses freed blocks of the same class", [&]()
+		{
+			MultiPoolArena arena;
+			void* first = arena.Alloc(100);
+			arena.Free(first, 100);
+			AssertThat(arena.Alloc(112), Equals(first));
+			arena.Free(first, 112);
+		});
+
+		it("Can allocate aligned blocks", [&]()
+		{
+			MultiPoolArena arena;
+			for (sizet align : {sizet(8), sizet(16), sizet(32), sizet(64)})
+			{
+				for (sizet size : {sizet(8), sizet(24), sizet(72), sizet(200), sizet(2000)})
+				{
+					void* ptr = arena.Alloc(size, align);
+					AssertThat(GetAlignmentPadding(ptr, align), Equals(0));
+					arena.Free(ptr, size);
+					// Reused blocks keep their alignment
+					ptr = arena.Alloc(size, align);
+					AssertThat(GetAlignmentPadding(ptr, align), Equals(0));
+					arena.Free(ptr, size);
+				}
+			}
+		});
+	});
+
+	describe("Memory.OwnPtr", []()
+	{
+		it("Reuses counters of deleted owners", [&]()
+		{
+			const void* counter;
+			{
+				TOwnPtr<i32> owner = MakeOwned<i32>(3);
+				counter            = owner.GetCounter();
+			}
+			TOwnPtr<i32> owner = MakeOwned<i32>(4);
+			AssertThat(owner.GetCounter() == counter, Is().True());
+		});
+
+		it("Allocates counters from the arena of the owner", [&]()
+		{
+			TPoolArena<64> arena;
+			CurrentArenaScope scope{arena};
+			TOwnPtr<i32> owner = MakeOwned<i32>(3);
+			TArray<ArenaBlock> blocks;
+			arena.GetBlocks(blocks);
+			AssertThat(blocks.Size(), Equals(1));
+			AssertThat(blocks[0].Contains(owner.GetCounter()), Is().True());
+		});
+
+		it("Can delete owners on other threads", [&]()
+		{
+			TArray<TOwnPtr<i32>> owners;
+			for (i32 i = 0; i < 1000; ++i)
+			{
+				owners.Add(MakeOwned<i32>(i));
+			}
+			std::thread thread{[&owners]()
+			{
+				owners.Clear();
+				for (i32 i = 0; i < 100; ++i)
+				{
+					owners.Add(MakeOwned<i32>(i));
+				}
+			}};
+			thread.join();
+			AssertThat(owners.Size(), Equals(100));
+			AssertThat(*owners.Last(), Equals(99));
+		});
+	});
+});
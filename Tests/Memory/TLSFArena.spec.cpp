@@ -0,0 +1,132 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <PipeMemoryArenas.h>
+
+#include <cstring>
+#include <random>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+go_bandit([]()
+{
+	describe("Memory.TLSFArena", []()
+	{
+		it("Reuses freed blocks", [&]()
+		{
+			TLSFArena arena{64 * Memory::KB};
+			void* first = arena.Alloc(100);
+			AssertThat(GetAlignmentPadding(first, TLSFArena::minAlign), Equals(0));
+			arena.Free(first, 100);
+			AssertThat(arena.Alloc(100), Equals(first));
+			arena.Free(first, 100);
+		});
+
+		it("Merges freed neighbors", [&]()
+		{
+			TLSFArena arena{64 * Memory::KB};
+			void* a = arena.Alloc(1000);
+			void* b = arena.Alloc(1000);
+			void* c = arena.Alloc(1000);
+			arena.Free(a, 1000);
+			arena.Free(c, 1000);
+			arena.Free(b, 1000);
+
+			// All blocks merged back into one
+			AssertThat(arena.GetFreeSize(), Equals(64 * Memory::KB - 48));
+			void* big = arena.Alloc(60 * Memory::KB);
+			AssertThat(big, Equals(a));
+			arena.Free(big, 60 * Memory::KB);
+		});
+
+		it("Grows and releases regions", [&]()
+		{
+			TLSFArena arena{16 * Memory::KB};
+			TArray<void*> blocks;
+			for (i32 i = 0; i < 64; ++i)
+			{
+				blocks.Add(arena.Alloc(1024));
+			}
+			TArray<ArenaBlock> regions;
+			arena.GetBlocks(regions);
+			AssertThat(regions.Size() > 1, Is().True());
+
+			void* huge = arena.Alloc(Memory::MB);
+			AssertThat(huge, Is().Not().Null());
+			arena.Free(huge, Memory::MB);
+			for (void* block : blocks)
+			{
+				arena.Free(block, 1024);
+			}
+			// Empty regions are returned, except one
+			regions.Clear();
+			arena.GetBlocks(regions);
+			AssertThat(regions.Size(), Equals(1));
+		});
+
+		it("Can allocate aligned blocks", [&]()
+		{
+			TLSFArena arena{64 * Memory::KB};
+			for (sizet align : {sizet(8), sizet(32), sizet(64), sizet(256), sizet(4096)})
+			{
+				void* small = arena.Alloc(24, align);
+				void* big   = arena.Alloc(5000, align);
+				AssertThat(GetAlignmentPadding(small, align), Equals(0));
+				AssertThat(GetAlignmentPadding(big, align), Equals(0));
+				arena.Free(small, 24);
+				arena.Free(big, 5000);
+			}
+		});
+
+		it("Keeps blocks intact on random allocations", [&]()
+		{
+			struct Allocation
+			{
+				u8* ptr;
+				sizet size;
+				u8 value;
+			};
+			std::mt19937 random{11};
+			std::uniform_int_distribution<sizet> sizes{1, 3000};
+
+			TLSFArena arena{32 * Memory::KB};
+			TArray<Allocation> allocations;
+			bool intact = true;
+			for (i32 i = 0; i < 20000; ++i)
+			{
+				if (allocations.Size() > 0 && random() % 3 == 0)
+				{
+					const i32 index         = i32(random() % allocations.Size());
+					const Allocation& freed = allocations[index];
+					for (sizet b = 0; b < freed.size; ++b)
+					{
+						intact &= freed.ptr[b] == freed.value;
+					}
+					arena.Free(freed.ptr, freed.size);
+					allocations.RemoveAtSwapUnsafe(index);
+				}
+				else
+				{
+					const sizet size = sizes(random);
+					const u8 value   = u8(i);
+					auto* ptr        = static_cast<u8*>(arena.Alloc(size, sizet(1) << (i % 8)));
+					std::memset(ptr, value, size);
+					allocations.Add({ptr, size, value});
+				}
+			}
+			AssertThat(intact, Is().True());
+			for (const Allocation& allocation : allocations)
+			{
+				arena.Free(allocation.ptr, allocation.size);
+			}
+			TArray<ArenaBlock> regions;
+			arena.GetBlocks(regions);
+			AssertThat(regions.Size(), Equals(1));
+			AssertThat(arena.GetFreeSize() + 48, Equals(regions[0].size));
+		});
+	});
+});
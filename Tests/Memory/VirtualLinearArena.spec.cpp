@@ -0,0 +1,80 @@
+// Copyright 2015-2026 Piperift. All Rights Reserved.
+
+#include <bandit/bandit.h>
+#include <PipeMemoryArenas.h>
+
+
+using namespace snowhouse;
+using namespace bandit;
+using namespace p;
+
+
+go_bandit([]()
+{
+	describe("Memory.VirtualLinearArena", []()
+	{
+		it("Reserves without committing", [&]()
+		{
+			VirtualLinearArena arena{Memory::GB};
+			AssertThat(arena.IsValid(), Is().True());
+			AssertThat(arena.GetReservedSize(), Equals(Memory::GB));
+			AssertThat(arena.GetCommittedSize(), Equals(0));
+			AssertThat(arena.GetAvailableMemory(), Equals(Memory::GB));
+		});
+
+		it("Commits as allocations advance", [&]()
+		{
+			VirtualLinearArena arena{Memory::GB, false, 64 * Memory::KB};
+			auto* first = static_cast<u8*>(arena.Alloc(1000));
+			AssertThat(arena.GetCommittedSize(), Equals(64 * Memory::KB));
+			AssertThat(arena.GetAvailableMemory(), Equals(Memory::GB - 1000));
+
+			auto* second = static_cast<u8*>(arena.Alloc(100 * Memory::KB, 64));
+			AssertThat(GetAlignmentPadding(second, 64), Equals(0));
+			AssertThat(second - first < 1100, Is().True());
+			AssertThat(arena.GetCommittedSize(), Equals(128 * Memory::KB));
+			second[100 * Memory::KB - 1] = 3;    // Committed memory is writable
+
+			TArray<ArenaBlock> blocks;
+			arena.GetBlocks(blocks);
+			AssertThat(blocks.Size(), Equals(1));
+			AssertThat(blocks[0].data == first, Is().True());
+			arena.Free(first, 1000);
+			arena.Free(second, 100 * Memory::KB);
+		});
+
+		it("Decommits on release", [&]()
+		{
+			VirtualLinearArena arena{Memory::GB};
+			void* first = arena.Alloc(Memory::MB);
+			arena.Release();
+			AssertThat(arena.GetCommittedSize(), Equals(0));
+			AssertThat(arena.GetUsedSize(), Equals(0));
+
+			// The same addresses are committed again
+			auto* again = static_cast<u8*>(arena.Alloc(Memory::MB));
+			AssertThat(again == first, Is().True());
+			again[Memory::MB - 1] = 1;
+			arena.Release(false);
+			AssertThat(arena.GetCommittedSize() > 0, Is().True());
+		});
+
+		it("Fails to allocate beyond the reserved memory", [&]()
+		{
+			VirtualLinearArena arena{Memory::MB};
+			AssertThat(arena.Alloc(Memory::MB / 2), Is().Not().Null());
+			AssertThat(arena.Alloc(Memory::MB), Is().Null());
+			arena.Release();
+		});
+
+		it("Can use huge pages", [&]()
+		{
+			VirtualLinearArena arena{Memory::GB, true};
+			auto* ptr = static_cast<u8*>(arena.Alloc(3 * Memory::MB));
+			AssertThat(GetAlignmentPadding(ptr, VirtualLinearArena::hugePageSize), Equals(0));
+			AssertThat(arena.GetCommittedSize(), Equals(4 * Memory::MB));
+			ptr[3 * Memory::MB - 1] = 1;
+			arena.Free(ptr, 3 * Memory::MB);
+		});
+	});
+});